@@ -39,6 +39,8 @@ MODULES=(
 "ietf-netconf-server@2019-07-02.yang -e ssh-listen -e tls-listen -e ssh-call-home -e tls-call-home"
 "ietf-subscribed-notifications@2019-09-09.yang -e encode-xml -e replay -e subtree -e xpath"
 "ietf-yang-push@2019-09-09.yang -e on-change"
+"netopeer2-yang-push@2021-11-01.yang"
+"netopeer2-server@2021-11-01.yang"
 )
 
 # functions
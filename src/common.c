@@ -19,6 +19,7 @@
 #include <assert.h>
 #include <ctype.h>
 #include <errno.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
@@ -40,9 +41,12 @@
 
 #include "common.h"
 #include "compat.h"
+#include "data_fetch.h"
+#include "err_netconf.h"
 #include "log.h"
 #include "netconf_acm.h"
 #include "netconf_monitoring.h"
+#include "strbuf.h"
 
 struct np2srv np2srv = {.unix_mode = -1, .unix_uid = -1, .unix_gid = -1};
 
@@ -113,40 +117,274 @@ np_modtimespec(const struct timespec *ts, uint32_t msec)
     return ret;
 }
 
-struct nc_session *
-np_get_nc_sess_by_sr_id(uint32_t sr_id)
-{
-    uint32_t i;
+/**
+ * @brief Session map entry, indexed both by NC SID and SR session ID.
+ */
+struct np_sess_entry {
+    uint32_t nc_id;
+    uint32_t sr_id;
     struct nc_session *ncs;
+    struct np_sess_entry *nc_next;  /* next entry in the NC SID bucket */
+    struct np_sess_entry *sr_next;  /* next entry in the SR session ID bucket */
+};
+
+/**
+ * @brief Map of all the NETCONF sessions in the pollsession.
+ */
+static struct {
+    struct np_sess_entry **nc_buckets;
+    struct np_sess_entry **sr_buckets;
+    uint32_t bits;                  /* there are 2^bits buckets */
+    uint32_t count;
+    pthread_rwlock_t lock;
+} sess_map = {.lock = PTHREAD_RWLOCK_INITIALIZER};
+
+/**
+ * @brief Index of the context modules.
+ */
+static struct {
+    struct np_mod_idx idx;
+    int valid;
+    pthread_rwlock_t lock;
+} mod_idx = {.lock = PTHREAD_RWLOCK_INITIALIZER};
+
+/**
+ * @brief Get bucket index of a session ID.
+ *
+ * @param[in] id Session ID.
+ * @return Bucket index.
+ */
+static uint32_t
+np_sess_map_bucket(uint32_t id)
+{
+    /* Fibonacci hashing */
+    return (uint32_t)(id * 2654435769U) >> (32 - sess_map.bits);
+}
+
+/**
+ * @brief Resize the session map buckets.
+ * Session map WRITE lock held.
+ *
+ * @param[in] bits New bucket count exponent.
+ * @return 0 on success, -1 on error.
+ */
+static int
+np_sess_map_resize(uint32_t bits)
+{
+    struct np_sess_entry **nc_buckets, **sr_buckets, *entry, *next;
+    uint32_t i, old_size, idx;
+
+    nc_buckets = calloc(1U << bits, sizeof *nc_buckets);
+    sr_buckets = calloc(1U << bits, sizeof *sr_buckets);
+    if (!nc_buckets || !sr_buckets) {
+        EMEM;
+        free(nc_buckets);
+        free(sr_buckets);
+        return -1;
+    }
+
+    /* rehash all the entries, each is in both the bucket arrays */
+    old_size = sess_map.nc_buckets ? (1U << sess_map.bits) : 0;
+    sess_map.bits = bits;
+    for (i = 0; i < old_size; ++i) {
+        for (entry = sess_map.nc_buckets[i]; entry; entry = next) {
+            next = entry->nc_next;
+
+            idx = np_sess_map_bucket(entry->nc_id);
+            entry->nc_next = nc_buckets[idx];
+            nc_buckets[idx] = entry;
+
+            idx = np_sess_map_bucket(entry->sr_id);
+            entry->sr_next = sr_buckets[idx];
+            sr_buckets[idx] = entry;
+        }
+    }
+
+    free(sess_map.nc_buckets);
+    free(sess_map.sr_buckets);
+    sess_map.nc_buckets = nc_buckets;
+    sess_map.sr_buckets = sr_buckets;
+    return 0;
+}
+
+int
+np_sess_map_add(struct nc_session *ncs)
+{
+    struct np_sess_entry *entry;
     struct np2_user_sess *user_sess;
+    uint32_t idx;
+    int rc = -1;
+
+    entry = malloc(sizeof *entry);
+    if (!entry) {
+        EMEM;
+        return -1;
+    }
+    user_sess = nc_session_get_data(ncs);
+    entry->nc_id = nc_session_get_id(ncs);
+    entry->sr_id = sr_session_get_id(user_sess->sess);
+    entry->ncs = ncs;
+
+    /* WRITE LOCK */
+    pthread_rwlock_wrlock(&sess_map.lock);
+
+    if (!sess_map.nc_buckets || (sess_map.count >= (1U << sess_map.bits))) {
+        /* keep the load factor at most 1 */
+        if (np_sess_map_resize(sess_map.nc_buckets ? sess_map.bits + 1 : NP2SRV_SESS_MAP_BITS)) {
+            goto cleanup;
+        }
+    }
+
+    idx = np_sess_map_bucket(entry->nc_id);
+    entry->nc_next = sess_map.nc_buckets[idx];
+    sess_map.nc_buckets[idx] = entry;
+
+    idx = np_sess_map_bucket(entry->sr_id);
+    entry->sr_next = sess_map.sr_buckets[idx];
+    sess_map.sr_buckets[idx] = entry;
+
+    ++sess_map.count;
+    entry = NULL;
+    rc = 0;
+
+cleanup:
+    /* UNLOCK */
+    pthread_rwlock_unlock(&sess_map.lock);
+
+    free(entry);
+    return rc;
+}
+
+void
+np_sess_map_del(struct nc_session *ncs)
+{
+    struct np_sess_entry **iter, *entry = NULL;
 
-    for (i = 0; (ncs = nc_ps_get_session(np2srv.nc_ps, i)); ++i) {
-        user_sess = nc_session_get_data(ncs);
-        if (sr_session_get_id(user_sess->sess) == sr_id) {
+    /* WRITE LOCK */
+    pthread_rwlock_wrlock(&sess_map.lock);
+
+    if (!sess_map.nc_buckets) {
+        goto cleanup;
+    }
+
+    /* unlink from the NC SID bucket */
+    for (iter = &sess_map.nc_buckets[np_sess_map_bucket(nc_session_get_id(ncs))]; *iter; iter = &(*iter)->nc_next) {
+        if ((*iter)->ncs == ncs) {
+            entry = *iter;
+            *iter = entry->nc_next;
             break;
         }
     }
+    if (!entry) {
+        /* was never added */
+        goto cleanup;
+    }
+
+    /* unlink from the SR session ID bucket */
+    for (iter = &sess_map.sr_buckets[np_sess_map_bucket(entry->sr_id)]; *iter != entry; iter = &(*iter)->sr_next) {}
+    *iter = entry->sr_next;
+
+    --sess_map.count;
+
+cleanup:
+    /* UNLOCK */
+    pthread_rwlock_unlock(&sess_map.lock);
+
+    free(entry);
+}
+
+void
+np_sess_map_destroy(void)
+{
+    assert(!sess_map.count);
+
+    free(sess_map.nc_buckets);
+    free(sess_map.sr_buckets);
+    sess_map.nc_buckets = NULL;
+    sess_map.sr_buckets = NULL;
+}
+
+/**
+ * @brief Find a NETCONF session in the session map.
+ * Session map lock held.
+ *
+ * @param[in] nc_id NC SID of the session.
+ * @return Found NETCONF session, NULL if not found.
+ */
+static struct nc_session *
+np_sess_map_find_nc_id(uint32_t nc_id)
+{
+    struct np_sess_entry *entry;
+
+    if (!sess_map.nc_buckets) {
+        return NULL;
+    }
+
+    for (entry = sess_map.nc_buckets[np_sess_map_bucket(nc_id)]; entry; entry = entry->nc_next) {
+        if (entry->nc_id == nc_id) {
+            return entry->ncs;
+        }
+    }
+
+    return NULL;
+}
+
+struct nc_session *
+np_get_nc_sess_by_id(uint32_t nc_id)
+{
+    struct nc_session *ncs;
+
+    /* READ LOCK */
+    pthread_rwlock_rdlock(&sess_map.lock);
+
+    ncs = np_sess_map_find_nc_id(nc_id);
+
+    /* UNLOCK */
+    pthread_rwlock_unlock(&sess_map.lock);
 
     return ncs;
 }
 
+struct nc_session *
+np_get_nc_sess_by_sr_id(uint32_t sr_id)
+{
+    struct np_sess_entry *entry = NULL;
+
+    /* READ LOCK */
+    pthread_rwlock_rdlock(&sess_map.lock);
+
+    if (sess_map.sr_buckets) {
+        for (entry = sess_map.sr_buckets[np_sess_map_bucket(sr_id)]; entry; entry = entry->sr_next) {
+            if (entry->sr_id == sr_id) {
+                break;
+            }
+        }
+    }
+
+    /* UNLOCK */
+    pthread_rwlock_unlock(&sess_map.lock);
+
+    return entry ? entry->ncs : NULL;
+}
+
 int
 np_get_user_sess(sr_session_ctx_t *ev_sess, struct nc_session **nc_sess, struct np2_user_sess **user_sess)
 {
     struct np2_user_sess *us;
-    uint32_t i, *nc_id, size;
+    uint32_t *nc_id, size;
     struct nc_session *ncs;
+    int rc = SR_ERR_OK;
 
     sr_session_get_orig_data(ev_sess, 0, &size, (const void **)&nc_id);
 
-    for (i = 0; (ncs = nc_ps_get_session(np2srv.nc_ps, i)); ++i) {
-        if (nc_session_get_id(ncs) == *nc_id) {
-            break;
-        }
-    }
+    /* READ LOCK */
+    pthread_rwlock_rdlock(&sess_map.lock);
+
+    ncs = np_sess_map_find_nc_id(*nc_id);
     if (!ncs) {
         ERR("Failed to find NETCONF session SID %u.", *nc_id);
-        return SR_ERR_INTERNAL;
+        rc = SR_ERR_INTERNAL;
+        goto cleanup;
     }
 
     /* NETCONF session */
@@ -154,15 +392,19 @@ np_get_user_sess(sr_session_ctx_t *ev_sess, struct nc_session **nc_sess, struct
         *nc_sess = ncs;
     }
     if (!user_sess) {
-        return SR_ERR_OK;
+        goto cleanup;
     }
 
-    /* user sysrepo session */
+    /* user sysrepo session, referenced while the session cannot be removed */
     us = nc_session_get_data(ncs);
     ATOMIC_INC_RELAXED(us->ref_count);
     *user_sess = us;
 
-    return SR_ERR_OK;
+cleanup:
+    /* UNLOCK */
+    pthread_rwlock_unlock(&sess_map.lock);
+
+    return rc;
 }
 
 void
@@ -178,6 +420,7 @@ np_release_user_sess(struct np2_user_sess *user_sess)
     if (ATOMIC_LOAD_RELAXED(prev_ref_count) == 1) {
         /* is 0 now, free */
         sr_session_stop(user_sess->sess);
+        free(user_sess->ncm_stats);
         free(user_sess);
     }
 }
@@ -219,6 +462,158 @@ np_ly_mod_has_data(const struct lys_module *mod, uint32_t config_mask)
     return 0;
 }
 
+/**
+ * @brief Compare module pointers for sorting.
+ */
+static int
+np_mod_idx_cmp(const void *ptr1, const void *ptr2)
+{
+    const struct lys_module *mod1 = *(const struct lys_module **)ptr1, *mod2 = *(const struct lys_module **)ptr2;
+
+    if (mod1 < mod2) {
+        return -1;
+    } else if (mod1 > mod2) {
+        return 1;
+    }
+    return 0;
+}
+
+/**
+ * @brief Free the arrays of the module index. Index WRITE lock is expected to be held.
+ */
+static void
+np_mod_idx_clear(void)
+{
+    free(mod_idx.idx.notif);
+    free(mod_idx.idx.data);
+    free(mod_idx.idx.config);
+    memset(&mod_idx.idx, 0, sizeof mod_idx.idx);
+    mod_idx.valid = 0;
+}
+
+/**
+ * @brief Create the module index. Index WRITE lock is expected to be held.
+ *
+ * @param[in] ly_ctx Context to use.
+ * @param[in] content_id Sysrepo content-id of @p ly_ctx.
+ * @return 0 on success, -1 on error.
+ */
+static int
+np_mod_idx_create(const struct ly_ctx *ly_ctx, uint32_t content_id)
+{
+    const struct lys_module *ly_mod;
+    uint32_t idx, count = 0;
+
+    np_mod_idx_clear();
+
+    /* allocate arrays for all the modules */
+    idx = 0;
+    while (ly_ctx_get_module_iter(ly_ctx, &idx)) {
+        ++count;
+    }
+    mod_idx.idx.notif = malloc(count * sizeof *mod_idx.idx.notif);
+    mod_idx.idx.data = malloc(count * sizeof *mod_idx.idx.data);
+    mod_idx.idx.config = malloc(count * sizeof *mod_idx.idx.config);
+    if (count && (!mod_idx.idx.notif || !mod_idx.idx.data || !mod_idx.idx.config)) {
+        EMEM;
+        np_mod_idx_clear();
+        return -1;
+    }
+
+    /* fill them */
+    idx = 0;
+    while ((ly_mod = ly_ctx_get_module_iter(ly_ctx, &idx))) {
+        if (!ly_mod->implemented) {
+            continue;
+        }
+
+        if (np_ly_mod_has_notif(ly_mod)) {
+            mod_idx.idx.notif[mod_idx.idx.notif_count++] = ly_mod;
+        }
+        if (np_ly_mod_has_data(ly_mod, LYS_CONFIG_MASK)) {
+            mod_idx.idx.data[mod_idx.idx.data_count++] = ly_mod;
+            if (np_ly_mod_has_data(ly_mod, LYS_CONFIG_W)) {
+                mod_idx.idx.config[mod_idx.idx.config_count++] = ly_mod;
+            }
+        }
+    }
+
+    /* sort them for searching */
+    qsort(mod_idx.idx.notif, mod_idx.idx.notif_count, sizeof *mod_idx.idx.notif, np_mod_idx_cmp);
+    qsort(mod_idx.idx.data, mod_idx.idx.data_count, sizeof *mod_idx.idx.data, np_mod_idx_cmp);
+    qsort(mod_idx.idx.config, mod_idx.idx.config_count, sizeof *mod_idx.idx.config, np_mod_idx_cmp);
+
+    mod_idx.idx.content_id = content_id;
+    mod_idx.valid = 1;
+    return 0;
+}
+
+const struct np_mod_idx *
+np_mod_idx_get(sr_conn_ctx_t *conn)
+{
+    uint32_t content_id;
+    int r;
+
+    while (1) {
+        content_id = sr_get_content_id(conn);
+
+        /* READ LOCK */
+        pthread_rwlock_rdlock(&mod_idx.lock);
+
+        if (mod_idx.valid && (mod_idx.idx.content_id == content_id)) {
+            /* up-to-date */
+            return &mod_idx.idx;
+        }
+
+        /* UNLOCK */
+        pthread_rwlock_unlock(&mod_idx.lock);
+
+        /* WRITE LOCK */
+        pthread_rwlock_wrlock(&mod_idx.lock);
+
+        r = 0;
+        if (!mod_idx.valid || (mod_idx.idx.content_id != content_id)) {
+            /* context has changed */
+            r = np_mod_idx_create(sr_get_context(conn), content_id);
+        }
+
+        /* UNLOCK */
+        pthread_rwlock_unlock(&mod_idx.lock);
+
+        if (r) {
+            return NULL;
+        }
+    }
+}
+
+void
+np_mod_idx_release(void)
+{
+    /* UNLOCK */
+    pthread_rwlock_unlock(&mod_idx.lock);
+}
+
+int
+np_mod_idx_has(const struct lys_module **mods, uint32_t count, const struct lys_module *mod)
+{
+    if (bsearch(&mod, mods, count, sizeof *mods, np_mod_idx_cmp)) {
+        return 1;
+    }
+    return 0;
+}
+
+void
+np_mod_idx_destroy(void)
+{
+    /* WRITE LOCK */
+    pthread_rwlock_wrlock(&mod_idx.lock);
+
+    np_mod_idx_clear();
+
+    /* UNLOCK */
+    pthread_rwlock_unlock(&mod_idx.lock);
+}
+
 int
 np2srv_new_session_cb(const char *UNUSED(client_name), struct nc_session *new_session)
 {
@@ -231,9 +626,6 @@ np2srv_new_session_cb(const char *UNUSED(client_name), struct nc_session *new_se
     uint32_t nc_id;
     const char *username;
 
-    /* monitor NETCONF session */
-    ncm_session_add(new_session);
-
     /* start sysrepo session for every NETCONF session (so that it can be used for notification subscriptions and
      * held lock persistence) */
     c = sr_session_start(np2srv.sr_conn, SR_DS_RUNNING, &sr_sess);
@@ -250,8 +642,12 @@ np2srv_new_session_cb(const char *UNUSED(client_name), struct nc_session *new_se
     }
     user_sess->sess = sr_sess;
     ATOMIC_STORE_RELAXED(user_sess->ref_count, 1);
+    user_sess->ncm_stats = NULL;
     nc_session_set_data(new_session, user_sess);
 
+    /* monitor NETCONF session */
+    ncm_session_add(new_session);
+
     /* set NC ID and NETCONF username for sysrepo callbacks */
     sr_session_set_orig_name(sr_sess, "netopeer2");
     nc_id = nc_session_get_id(new_session);
@@ -259,6 +655,11 @@ np2srv_new_session_cb(const char *UNUSED(client_name), struct nc_session *new_se
     username = nc_session_get_username(new_session);
     sr_session_push_orig_data(sr_sess, strlen(username) + 1, username);
 
+    /* index the session for callbacks */
+    if (np_sess_map_add(new_session)) {
+        goto error;
+    }
+
     c = 0;
     while ((c < 3) && nc_ps_add_session(np2srv.nc_ps, new_session)) {
         /* presumably timeout, give it a shot 2 times */
@@ -294,7 +695,7 @@ np2srv_new_session_cb(const char *UNUSED(client_name), struct nc_session *new_se
         if (c != SR_ERR_OK) {
             WRN("Failed to send a notification (%s).", sr_strerror(c));
         } else {
-            VRB("Generated new event (netconf-session-start).");
+            SUB_VRB(NP2LOG_SESSION, "Generated new event (netconf-session-start).");
         }
         free(event_data);
     }
@@ -302,8 +703,13 @@ np2srv_new_session_cb(const char *UNUSED(client_name), struct nc_session *new_se
     return 0;
 
 error:
+    np_sess_map_del(new_session);
     ncm_session_del(new_session);
+    nc_session_set_data(new_session, NULL);
     sr_session_stop(sr_sess);
+    if (user_sess) {
+        free(user_sess->ncm_stats);
+    }
     free(user_sess);
     return -1;
 }
@@ -410,7 +816,7 @@ url_open(const char *url)
     /* and hide it from the file system */
     unlink(url_tmp_name);
 
-    DBG("Getting file from URL: %s (via curl)", url);
+    SUB_DBG(NP2LOG_URL, "Getting file from URL: %s (via curl)", url);
 
     /* set up libcurl */
     curl_global_init(URL_INIT_FLAGS);
@@ -448,18 +854,19 @@ op_parse_url(const char *url, uint32_t parse_options, int *rc, sr_session_ctx_t
     fd = url_open(url);
     if (fd == -1) {
         *rc = SR_ERR_INVAL_ARG;
-        sr_session_set_error_message(sr_sess, "Could not open URL.");
+        np_err_msg(sr_sess, "Could not open URL.");
         return NULL;
     }
 
     /* do not validate the whole context, we just want to load the config anyxml */
     if (lyd_parse_data_fd(ly_ctx, fd, LYD_XML, LYD_PARSE_ONLY | LYD_PARSE_OPAQ | LYD_PARSE_NO_STATE, 0, &config)) {
         *rc = SR_ERR_LY;
-        sr_session_set_error_message(sr_sess, ly_errmsg(ly_ctx));
+        np_err_msg(sr_sess, "%s", ly_errmsg(ly_ctx));
         return NULL;
     }
 
-    data = op_parse_config((struct lyd_node_any *)config, parse_options, rc, sr_sess);
+    /* the parsed anyxml is freed right away, use its data tree directly */
+    data = op_parse_config((struct lyd_node_any *)config, parse_options, 1, rc, sr_sess);
     lyd_free_siblings(config);
     return data;
 }
@@ -479,7 +886,7 @@ op_export_url(const char *url, struct lyd_node *data, int options, int *rc, sr_s
     /* print the config as expected by the other end */
     if (lyd_new_path2(NULL, ly_ctx, "/ietf-netconf:config", data, 0, data ? LYD_ANYDATA_DATATREE : 0, 0, NULL, &config)) {
         *rc = SR_ERR_LY;
-        sr_session_set_error_message(sr_sess, ly_errmsg(ly_ctx));
+        np_err_msg(sr_sess, "%s", ly_errmsg(ly_ctx));
         return -1;
     }
     lyd_print_mem(&str_data, config, LYD_XML, options);
@@ -488,7 +895,7 @@ op_export_url(const char *url, struct lyd_node *data, int options, int *rc, sr_s
     ((struct lyd_node_any *)config)->value.tree = NULL;
     lyd_free_tree(config);
 
-    DBG("Uploading file to URL: %s (via curl)", url);
+    SUB_DBG(NP2LOG_URL, "Uploading file to URL: %s (via curl)", url);
 
     /* fill the structure for libcurl's READFUNCTION */
     mem_data.memory = str_data;
@@ -509,7 +916,7 @@ op_export_url(const char *url, struct lyd_node *data, int options, int *rc, sr_s
     if (res != CURLE_OK) {
         ERR("Failed to upload data (curl: %s).", curl_buffer);
         *rc = SR_ERR_SYS;
-        sr_session_set_error_message(sr_sess, curl_buffer);
+        np_err_msg(sr_sess, "%s", curl_buffer);
         return -1;
     }
 
@@ -530,11 +937,11 @@ np2srv_url_setcap(void)
 #endif
 
 struct lyd_node *
-op_parse_config(struct lyd_node_any *config, uint32_t parse_options, int *rc, sr_session_ctx_t *sr_sess)
+op_parse_config(struct lyd_node_any *config, uint32_t parse_options, int steal, int *rc, sr_session_ctx_t *sr_sess)
 {
     const struct ly_ctx *ly_ctx;
     struct lyd_node *root = NULL;
-    LY_ERR lyrc;
+    LY_ERR lyrc = LY_SUCCESS;
 
     if (!config->value.str) {
         /* nothing to do, no data */
@@ -549,7 +956,13 @@ op_parse_config(struct lyd_node_any *config, uint32_t parse_options, int *rc, sr
         lyrc = lyd_parse_data_mem(ly_ctx, config->value.str, LYD_XML, parse_options, 0, &root);
         break;
     case LYD_ANYDATA_DATATREE:
-        lyrc = lyd_dup_siblings(config->value.tree, NULL, LYD_DUP_RECURSIVE, &root);
+        if (steal) {
+            /* the value tree has no parent, it can be used directly, avoid copying large configs */
+            root = config->value.tree;
+            config->value.tree = NULL;
+        } else {
+            lyrc = lyd_dup_siblings(config->value.tree, NULL, LYD_DUP_RECURSIVE, &root);
+        }
         break;
     case LYD_ANYDATA_LYB:
         lyrc = lyd_parse_data_mem(ly_ctx, config->value.mem, LYD_LYB, parse_options, 0, &root);
@@ -561,7 +974,7 @@ op_parse_config(struct lyd_node_any *config, uint32_t parse_options, int *rc, sr
     }
     if (lyrc) {
         *rc = SR_ERR_LY;
-        sr_session_set_error_message(sr_sess, ly_errmsg(ly_ctx));
+        np_err_msg(sr_sess, "%s", ly_errmsg(ly_ctx));
     }
 
     return root;
@@ -599,67 +1012,55 @@ op_filter_xpath_add_filter(const char *new_filter, int selection, struct np2_fil
 }
 
 static int
-filter_xpath_buf_append_attrs(const struct lyd_meta *meta, char **buf, int size)
+filter_xpath_buf_append_attrs(const struct lyd_meta *meta, struct np_strbuf *sbuf)
 {
     const struct lyd_meta *next;
-    int new_size;
-    char *buf_new;
 
     LY_LIST_FOR(meta, next) {
-        new_size = size + 2 + strlen(next->annotation->module->name) + 1 + strlen(next->name) + 2 +
-                strlen(lyd_get_meta_value(next)) + 2;
-        buf_new = realloc(*buf, new_size);
-        if (!buf_new) {
-            EMEM;
+        if (np_strbuf_printf(sbuf, "[@%s:%s='%s']", next->annotation->module->name, next->name,
+                lyd_get_meta_value(next))) {
             return -1;
         }
-        *buf = buf_new;
-        sprintf((*buf) + (size - 1), "[@%s:%s='%s']", next->annotation->module->name, next->name, lyd_get_meta_value(next));
-        size = new_size;
     }
 
-    return size;
+    return 0;
 }
 
 /* top-level content node with namespace and optional attributes */
 static int
 filter_xpath_buf_add_top_content(const struct lyd_node *node, struct np2_filter *filter)
 {
-    int size;
-    char *buf;
+    struct np_strbuf sbuf = {0};
+    int rc = -1;
 
     assert(!lyd_parent(node) && node->schema);
 
-    size = 1 + strlen(node->schema->module->name) + 1 + strlen(LYD_NAME(node)) + 9 + strlen(lyd_get_value(node)) + 3;
-    buf = malloc(size);
-    if (!buf) {
-        EMEM;
-        return -1;
+    if (np_strbuf_printf(&sbuf, "/%s:%s[text()='%s']", node->schema->module->name, LYD_NAME(node),
+            lyd_get_value(node))) {
+        goto cleanup;
     }
-    sprintf(buf, "/%s:%s[text()='%s']", node->schema->module->name, LYD_NAME(node), lyd_get_value(node));
 
-    size = filter_xpath_buf_append_attrs(node->meta, &buf, size);
-    if (size < 1) {
-        free(buf);
-        return size;
+    if (filter_xpath_buf_append_attrs(node->meta, &sbuf)) {
+        goto cleanup;
     }
 
-    if (op_filter_xpath_add_filter(buf, 0, filter)) {
-        free(buf);
-        return -1;
+    if (op_filter_xpath_add_filter(sbuf.buf, 0, filter)) {
+        goto cleanup;
     }
 
-    free(buf);
-    return 0;
+    rc = 0;
+
+cleanup:
+    free(sbuf.buf);
+    return rc;
 }
 
 /* content node with optional namespace and attributes */
 static int
-filter_xpath_buf_append_content(const struct lyd_node *node, char **buf, int size)
+filter_xpath_buf_append_content(const struct lyd_node *node, struct np_strbuf *sbuf)
 {
     const struct lys_module *mod = NULL;
-    int new_size;
-    char *buf_new, quot;
+    char quot;
 
     assert(node->schema && (node->schema->nodetype & (LYS_LEAF | LYS_LEAFLIST)));
 
@@ -668,47 +1069,32 @@ filter_xpath_buf_append_content(const struct lyd_node *node, char **buf, int siz
         mod = node->schema->module;
     }
 
-    new_size = size + 1 + (mod ? strlen(mod->name) + 1 : 0) + strlen(LYD_NAME(node));
-    buf_new = realloc(*buf, new_size);
-    if (!buf_new) {
-        EMEM;
+    if (np_strbuf_printf(sbuf, "[%s%s%s", (mod ? mod->name : ""), (mod ? ":" : ""), LYD_NAME(node))) {
         return -1;
     }
-    *buf = buf_new;
-    sprintf((*buf) + (size - 1), "[%s%s%s", (mod ? mod->name : ""), (mod ? ":" : ""), LYD_NAME(node));
-    size = new_size;
 
-    size = filter_xpath_buf_append_attrs(node->meta, buf, size);
-    if (size < 1) {
-        return size;
-    }
-
-    new_size = size + 2 + strlen(lyd_get_value(node)) + 2;
-    buf_new = realloc(*buf, new_size);
-    if (!buf_new) {
-        EMEM;
+    if (filter_xpath_buf_append_attrs(node->meta, sbuf)) {
         return -1;
     }
-    *buf = buf_new;
 
     if (strchr(lyd_get_value(node), '\'')) {
         quot = '\"';
     } else {
         quot = '\'';
     }
-    sprintf((*buf) + (size - 1), "=%c%s%c]", quot, lyd_get_value(node), quot);
+    if (np_strbuf_printf(sbuf, "=%c%s%c]", quot, lyd_get_value(node), quot)) {
+        return -1;
+    }
 
-    return new_size;
+    return 0;
 }
 
-/* containment/selection node with namespace and optional attributes */
+/* containment/selection node with namespace and optional attributes, returns 1 if appended, 0 if skipped */
 static int
-filter_xpath_buf_append_node(const struct lyd_node *node, char **buf, int size)
+filter_xpath_buf_append_node(const struct lyd_node *node, struct np_strbuf *sbuf)
 {
     const struct lys_module *mod = NULL;
     const struct lyd_node_opaq *opaq;
-    int new_size;
-    char *buf_new;
 
     assert(node->schema || !((struct lyd_node_opaq *)node)->value || strws(((struct lyd_node_opaq *)node)->value));
 
@@ -732,40 +1118,37 @@ filter_xpath_buf_append_node(const struct lyd_node *node, char **buf, int size)
         }
     }
 
-    new_size = size + 1 + (mod ? strlen(mod->name) + 1 : 0) + strlen(LYD_NAME(node));
-    buf_new = realloc(*buf, new_size);
-    if (!buf_new) {
-        EMEM;
+    if (np_strbuf_printf(sbuf, "/%s%s%s", (mod ? mod->name : ""), (mod ? ":" : ""), LYD_NAME(node))) {
         return -1;
     }
-    *buf = buf_new;
-    sprintf((*buf) + (size - 1), "/%s%s%s", (mod ? mod->name : ""), (mod ? ":" : ""), LYD_NAME(node));
-    size = new_size;
 
     if (node->schema) {
-        size = filter_xpath_buf_append_attrs(node->meta, buf, size);
+        if (filter_xpath_buf_append_attrs(node->meta, sbuf)) {
+            return -1;
+        }
     } else {
         /* TODO print opaq attributes */
     }
 
-    return size;
+    return 1;
 }
 
 static int
-filter_xpath_buf_add_r(const struct lyd_node *node, char **buf, int size, struct np2_filter *filter)
+filter_xpath_buf_add_r(const struct lyd_node *node, struct np_strbuf *sbuf, struct np2_filter *filter)
 {
     const struct lyd_node *child;
-    int s, only_content_match;
+    size_t len;
+    int r, only_content_match;
 
     /* containment node or selection node */
-    size = filter_xpath_buf_append_node(node, buf, size);
-    if (size < 1) {
-        return size;
+    r = filter_xpath_buf_append_node(node, sbuf);
+    if (r < 1) {
+        return r;
     }
 
     if (!lyd_child(node)) {
         /* just a selection node */
-        if (op_filter_xpath_add_filter(*buf, 1, filter)) {
+        if (op_filter_xpath_add_filter(sbuf->buf, 1, filter)) {
             return -1;
         }
         return 0;
@@ -776,9 +1159,8 @@ filter_xpath_buf_add_r(const struct lyd_node *node, char **buf, int size, struct
     LY_LIST_FOR(lyd_child(node), child) {
         if (child->schema && lyd_get_value(child) && !strws(lyd_get_value(child))) {
             /* there is a content filter, append all of them */
-            size = filter_xpath_buf_append_content(child, buf, size);
-            if (size < 1) {
-                return size;
+            if (filter_xpath_buf_append_content(child, sbuf)) {
+                return -1;
             }
         } else {
             /* can no longer be just a content match */
@@ -788,7 +1170,7 @@ filter_xpath_buf_add_r(const struct lyd_node *node, char **buf, int size, struct
 
     if (only_content_match) {
         /* there are only content match nodes so we retrieve this filter as a subtree */
-        if (op_filter_xpath_add_filter(*buf, 0, filter)) {
+        if (op_filter_xpath_add_filter(sbuf->buf, 0, filter)) {
             return -1;
         }
 
@@ -797,24 +1179,24 @@ filter_xpath_buf_add_r(const struct lyd_node *node, char **buf, int size, struct
     /* else there are some other filters so the current filter just restricts all the nested ones, is not retrieved
      * as a standalone subtree */
 
-    /* that is it for this filter depth, now we branch with every new node */
+    /* that is it for this filter depth, now we branch with every new node from the same prefix */
+    len = sbuf->len;
     LY_LIST_FOR(lyd_child(node), child) {
         if (lyd_child(child)) {
             /* child containment node */
-            filter_xpath_buf_add_r(child, buf, size, filter);
+            if (filter_xpath_buf_add_r(child, sbuf, filter) < 0) {
+                return -1;
+            }
         } else {
             /* child selection node or content node (both should be included in the output) */
-            s = filter_xpath_buf_append_node(child, buf, size);
-            if (!s) {
-                continue;
-            } else if (s < 0) {
-                return s;
-            }
-
-            if (op_filter_xpath_add_filter(*buf, 1, filter)) {
+            r = filter_xpath_buf_append_node(child, sbuf);
+            if (r < 0) {
+                return -1;
+            } else if (r && op_filter_xpath_add_filter(sbuf->buf, 1, filter)) {
                 return -1;
             }
         }
+        np_strbuf_truncate(sbuf, len);
     }
 
     return 0;
@@ -824,7 +1206,7 @@ int
 op_filter_subtree2xpath(const struct lyd_node *node, struct np2_filter *filter)
 {
     const struct lyd_node *iter;
-    char *buf = NULL;
+    struct np_strbuf sbuf = {0};
 
     LY_LIST_FOR(node, iter) {
         if (iter->schema && lyd_get_value(iter) && !strws(lyd_get_value(iter))) {
@@ -834,17 +1216,18 @@ op_filter_subtree2xpath(const struct lyd_node *node, struct np2_filter *filter)
             }
         } else if (iter->schema || !((struct lyd_node_opaq *)iter)->value || strws(((struct lyd_node_opaq *)iter)->value)) {
             /* containment or selection node */
-            if (filter_xpath_buf_add_r(iter, &buf, 1, filter)) {
+            if (filter_xpath_buf_add_r(iter, &sbuf, filter)) {
                 goto error;
             }
+            np_strbuf_truncate(&sbuf, 0);
         }
     }
 
-    free(buf);
+    free(sbuf.buf);
     return 0;
 
 error:
-    free(buf);
+    free(sbuf.buf);
     op_filter_erase(filter);
     return -1;
 }
@@ -862,36 +1245,10 @@ op_filter_erase(struct np2_filter *filter)
     filter->count = 0;
 }
 
-static int
-np_append_str(const char *str, char **ret)
-{
-    void *mem;
-    int len;
-
-    if (!*ret) {
-        *ret = strdup(str);
-        if (!*ret) {
-            EMEM;
-            return -1;
-        }
-    } else {
-        len = strlen(*ret);
-        mem = realloc(*ret, len + strlen(str) + 1);
-        if (!mem) {
-            EMEM;
-            return -1;
-        }
-        *ret = mem;
-        strcat(*ret + len, str);
-    }
-
-    return 0;
-}
-
 int
 op_filter_filter2xpath(const struct np2_filter *filter, char **xpath)
 {
-    int rc;
+    struct np_strbuf sbuf = {0};
     uint32_t i;
 
     *xpath = NULL;
@@ -900,48 +1257,27 @@ op_filter_filter2xpath(const struct np2_filter *filter, char **xpath)
     for (i = 0; i < filter->count; ++i) {
         if (!filter->filters[i].selection && (filter->count > 1)) {
             ERR("Several top-level content match filters are not supported as they are redundant.");
-            rc = SR_ERR_UNSUPPORTED;
-            goto error;
+            free(sbuf.buf);
+            return SR_ERR_UNSUPPORTED;
         }
 
         /* put all selection filters into parentheses */
-        if (!*xpath) {
-            if (np_append_str("(", xpath)) {
-                rc = SR_ERR_NO_MEMORY;
-                goto error;
-            }
-
-            if (np_append_str(filter->filters[i].str, xpath)) {
-                rc = SR_ERR_NO_MEMORY;
-                goto error;
-            }
-        } else {
-            if (np_append_str(" | ", xpath)) {
-                rc = SR_ERR_NO_MEMORY;
-                goto error;
-            }
-
-            if (np_append_str(filter->filters[i].str, xpath)) {
-                rc = SR_ERR_NO_MEMORY;
-                goto error;
-            }
+        if (np_strbuf_append(&sbuf, sbuf.len ? " | " : "(") || np_strbuf_append(&sbuf, filter->filters[i].str)) {
+            free(sbuf.buf);
+            return SR_ERR_NO_MEMORY;
         }
     }
 
-    if (*xpath) {
+    if (sbuf.len) {
         /* finish parentheses */
-        if (np_append_str(")", xpath)) {
-            rc = SR_ERR_NO_MEMORY;
-            goto error;
+        if (np_strbuf_append(&sbuf, ")")) {
+            free(sbuf.buf);
+            return SR_ERR_NO_MEMORY;
         }
     }
 
+    *xpath = sbuf.buf;
     return SR_ERR_OK;
-
-error:
-    free(*xpath);
-    *xpath = NULL;
-    return rc;
 }
 
 int
@@ -953,13 +1289,18 @@ op_filter_data_get(sr_session_ctx_t *session, uint32_t max_depth, sr_get_oper_op
     uint32_t i;
     int rc;
 
+    if ((NP2SRV_DATA_FETCH_MAX_FANOUT > 1) && (filter->count > 1)) {
+        /* retrieve the data of all the filters concurrently */
+        return np_data_fetch(session, max_depth, get_opts, filter, ev_sess, data);
+    }
+
     for (i = 0; i < filter->count; ++i) {
         /* get the selected data */
         rc = sr_get_data(session, filter->filters[i].str, max_depth, np2srv.sr_timeout, get_opts, &node);
         if (rc) {
             ERR("Getting data \"%s\" from sysrepo failed (%s).", filter->filters[i].str, sr_strerror(rc));
             sr_session_get_error(session, &err_info);
-            sr_session_set_error_message(ev_sess, err_info->err[0].message);
+            np_err_msg(ev_sess, "%s", err_info->err[0].message);
             return rc;
         }
 
@@ -41,26 +41,49 @@
 struct np2_user_sess {
     sr_session_ctx_t *sess;
     ATOMIC_T ref_count;
+    struct ncm_session_stats *ncm_stats;    /* netconf-monitoring counters, NULL if not monitored */
 };
 
+/* sysrepo RPC subscription contexts, each with its own thread so that the RPC classes do not block each other */
+#define NP_RPC_SUB_WRITE 0      /**< RPCs modifying datastores and locks */
+#define NP_RPC_SUB_NTF 1        /**< subscription RPCs */
+#define NP_RPC_SUB_READ 2       /**< first of the contexts for read RPCs */
+#define NP_RPC_SUB_COUNT (NP_RPC_SUB_READ + NP2SRV_RPC_READ_THREAD_COUNT)
+
+/* sysrepo notification subscription context of a NETCONF session */
+#define NP_NOTIF_SUB(nc_id) (&np2srv.sr_notif_sub[(nc_id) % NP2SRV_NOTIF_THREAD_COUNT])
+
 /* server internal data */
 struct np2srv {
     sr_conn_ctx_t *sr_conn;         /**< sysrepo connection */
     sr_session_ctx_t *sr_sess;      /**< sysrepo server session */
-    sr_subscription_ctx_t *sr_rpc_sub;  /**< sysrepo RPC subscription context */
+    sr_subscription_ctx_t *sr_rpc_sub[NP_RPC_SUB_COUNT];    /**< sysrepo RPC subscription contexts */
     sr_subscription_ctx_t *sr_data_sub; /**< sysrepo data subscription context */
-    sr_subscription_ctx_t *sr_notif_sub;    /**< sysrepo notification subscription context */
+    sr_subscription_ctx_t *sr_notif_sub[NP2SRV_NOTIF_THREAD_COUNT]; /**< sysrepo notification subscription contexts */
+    sr_subscription_ctx_t *sr_yp_sub[NP2SRV_YANG_PUSH_THREAD_COUNT];    /**< sysrepo yang-push subscription contexts */
 
     const char *unix_path;          /**< path to the UNIX socket to listen on, if any */
     mode_t unix_mode;               /**< UNIX socket mode */
     uid_t unix_uid;                 /**< UNIX socket UID */
     gid_t unix_gid;                 /**< UNIX socket GID */
+    const char *metrics_path;       /**< path to the metrics UNIX socket to listen on, if any */
     uint32_t sr_timeout;            /**< timeout in ms for all sysrepo functions */
 
     struct nc_pollsession *nc_ps;   /**< libnetconf2 pollsession structure */
     pthread_t workers[NP2SRV_THREAD_COUNT]; /**< worker threads handling sessions */
 };
 
+/* index of the implemented modules of the context, sorted by their pointers */
+struct np_mod_idx {
+    uint32_t content_id;                /**< sysrepo content-id the index was created for */
+    const struct lys_module **notif;    /**< modules with notifications */
+    uint32_t notif_count;
+    const struct lys_module **data;     /**< modules with any data */
+    uint32_t data_count;
+    const struct lys_module **config;   /**< modules with configuration data */
+    uint32_t config_count;
+};
+
 extern struct np2srv np2srv;
 extern ATOMIC_T skip_nacm_nc_sid;
 
@@ -74,6 +97,28 @@ void np_addtimespec(struct timespec *ts, uint32_t msec);
 
 struct timespec np_modtimespec(const struct timespec *ts, uint32_t msec);
 
+/**
+ * @brief Add a new NETCONF session into the session map used for finding sessions by their IDs.
+ *
+ * @param[in] ncs NETCONF session with its user session set.
+ * @return 0 on success, -1 on error.
+ */
+int np_sess_map_add(struct nc_session *ncs);
+
+/**
+ * @brief Remove a NETCONF session from the session map.
+ *
+ * @param[in] ncs NETCONF session to remove.
+ */
+void np_sess_map_del(struct nc_session *ncs);
+
+/**
+ * @brief Free the session map, all the sessions are expected to be removed.
+ */
+void np_sess_map_destroy(void);
+
+struct nc_session *np_get_nc_sess_by_id(uint32_t nc_id);
+
 struct nc_session *np_get_nc_sess_by_sr_id(uint32_t sr_id);
 
 int np_get_user_sess(sr_session_ctx_t *ev_sess, struct nc_session **nc_sess, struct np2_user_sess **user_sess);
@@ -84,6 +129,34 @@ int np_ly_mod_has_notif(const struct lys_module *mod);
 
 int np_ly_mod_has_data(const struct lys_module *mod, uint32_t config_mask);
 
+/**
+ * @brief Get the module index, updated if the context has changed, and READ lock it.
+ *
+ * @param[in] conn Sysrepo connection.
+ * @return Module index, NULL on error.
+ */
+const struct np_mod_idx *np_mod_idx_get(sr_conn_ctx_t *conn);
+
+/**
+ * @brief Unlock the module index.
+ */
+void np_mod_idx_release(void);
+
+/**
+ * @brief Check whether a module is in a module index array.
+ *
+ * @param[in] mods Sorted module index array.
+ * @param[in] count Count of @p mods.
+ * @param[in] mod Module to find.
+ * @return Whether the module was found or not.
+ */
+int np_mod_idx_has(const struct lys_module **mods, uint32_t count, const struct lys_module *mod);
+
+/**
+ * @brief Free the module index.
+ */
+void np_mod_idx_destroy(void);
+
 int np2srv_new_session_cb(const char *client_name, struct nc_session *new_session);
 
 int np2srv_url_setcap(void);
@@ -96,7 +169,19 @@ int op_export_url(const char *url, struct lyd_node *data, int options, int *rc,
 
 #endif
 
-struct lyd_node *op_parse_config(struct lyd_node_any *config, uint32_t parse_options, int *rc, sr_session_ctx_t *sr_sess);
+/**
+ * @brief Get the configuration data of a config anydata node.
+ *
+ * @param[in] config Config anydata node.
+ * @param[in] parse_options Parse options for string and LYB values.
+ * @param[in] steal Whether a data tree value can be taken from @p config instead of duplicating it, @p config is
+ * left without any value in this case. Use only if @p config is not needed afterwards.
+ * @param[out] rc Sysrepo error value.
+ * @param[in] sr_sess Sysrepo session to set the error message for.
+ * @return Configuration data, NULL on error or if there are none.
+ */
+struct lyd_node *op_parse_config(struct lyd_node_any *config, uint32_t parse_options, int steal, int *rc,
+        sr_session_ctx_t *sr_sess);
 
 struct np2_filter {
     struct {
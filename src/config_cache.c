@@ -0,0 +1,520 @@
+/**
+ * @file config_cache.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief cache of get-config reply data
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "config_cache.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "compat.h"
+#include "config.h"
+#include "log.h"
+#include "netconf_acm.h"
+
+/**
+ * @brief Cached reply data of a get-config.
+ */
+struct np_cfg_cache_entry {
+    struct np2_filter filter;   /* filter with all the subtree filters transformed into XPaths */
+    char *user;
+    uint32_t hash;
+    uint32_t version;           /* running data version of the data */
+    uint32_t nacm_version;      /* NACM configuration version of the data */
+    struct lyd_node *data;      /* NACM-filtered reply data, never modified */
+    ATOMIC_T ref_count;         /* reference of the cache and of every request duplicating the data */
+
+    struct np_cfg_cache_entry *prev;
+    struct np_cfg_cache_entry *next;
+};
+
+/**
+ * @brief get-config reply cache of the running datastore.
+ */
+static struct {
+    pthread_mutex_t lock;
+    struct np_cfg_cache_entry *first;   /* most recently used */
+    struct np_cfg_cache_entry *last;    /* least recently used */
+    uint32_t count;
+
+    sr_session_ctx_t *sess;
+    sr_subscription_ctx_t *sub;         /* change subscriptions of all the modules with configuration */
+    char **sub_mods;                    /* names of the subscribed modules */
+    uint32_t sub_mod_count;
+    uint32_t content_id;                /* content ID of the modules subscribed to */
+    int sub_valid;                      /* all the modules of content_id are subscribed to */
+
+    ATOMIC_T version;                   /* running data version, changed on every change */
+    ATOMIC_T changing;                  /* number of change events not yet finished */
+
+    ATOMIC64_T hits;
+    ATOMIC64_T misses;
+    ATOMIC64_T evictions;
+    ATOMIC64_T invalidations;
+} cfg_cache = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief Module change callback of the cache, tracks the running data version.
+ */
+static int
+np_cfg_cache_change_cb(sr_session_ctx_t *UNUSED(session), uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
+        const char *UNUSED(xpath), sr_event_t event, uint32_t UNUSED(request_id), void *UNUSED(private_data))
+{
+    /* the data are being changed between the change and done/abort events so nothing can be cached meanwhile,
+     * a done/abort event may come without the change event if subscribed during a change; all the events are
+     * processed by the single thread of the subscription so there is no other writer */
+    if (event == SR_EV_CHANGE) {
+        ATOMIC_INC_RELAXED(cfg_cache.changing);
+    } else if (ATOMIC_LOAD_RELAXED(cfg_cache.changing)) {
+        ATOMIC_DEC_RELAXED(cfg_cache.changing);
+    }
+
+    /* all the cached data are invalid */
+    ATOMIC_INC_RELAXED(cfg_cache.version);
+
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Subscribe to changes of all the modules with configuration not subscribed to yet.
+ * Cache lock held.
+ *
+ * @return 0 if all the changes are tracked and the data can be cached, -1 otherwise.
+ */
+static int
+np_cfg_cache_subscribe(void)
+{
+    const struct np_mod_idx *mod_idx;
+    const struct lys_module **mods = NULL;
+    uint32_t i, j, mod_count, content_id;
+    void *mem;
+    int rc;
+
+    content_id = sr_get_content_id(np2srv.sr_conn);
+    if (cfg_cache.sess && (cfg_cache.content_id == content_id)) {
+        /* up-to-date */
+        return cfg_cache.sub_valid ? 0 : -1;
+    }
+
+    /* modules with configuration, do not keep the index locked while subscribing */
+    mod_idx = np_mod_idx_get(np2srv.sr_conn);
+    if (!mod_idx) {
+        return -1;
+    }
+    content_id = mod_idx->content_id;
+    mod_count = mod_idx->config_count;
+    mods = malloc(mod_count * sizeof *mods);
+    if (mod_count && !mods) {
+        np_mod_idx_release();
+        EMEM;
+        return -1;
+    }
+    if (mod_count) {
+        memcpy(mods, mod_idx->config, mod_count * sizeof *mods);
+    }
+    np_mod_idx_release();
+
+    cfg_cache.content_id = content_id;
+    cfg_cache.sub_valid = 0;
+
+    if (!cfg_cache.sess && sr_session_start(np2srv.sr_conn, SR_DS_RUNNING, &cfg_cache.sess)) {
+        goto cleanup;
+    }
+
+    for (i = 0; i < mod_count; ++i) {
+        for (j = 0; j < cfg_cache.sub_mod_count; ++j) {
+            if (!strcmp(cfg_cache.sub_mods[j], mods[i]->name)) {
+                break;
+            }
+        }
+        if (j < cfg_cache.sub_mod_count) {
+            /* already subscribed */
+            continue;
+        }
+
+        mem = realloc(cfg_cache.sub_mods, (cfg_cache.sub_mod_count + 1) * sizeof *cfg_cache.sub_mods);
+        if (!mem) {
+            EMEM;
+            goto cleanup;
+        }
+        cfg_cache.sub_mods = mem;
+        cfg_cache.sub_mods[cfg_cache.sub_mod_count] = strdup(mods[i]->name);
+        if (!cfg_cache.sub_mods[cfg_cache.sub_mod_count]) {
+            EMEM;
+            goto cleanup;
+        }
+
+        rc = sr_module_change_subscribe(cfg_cache.sess, mods[i]->name, NULL, np_cfg_cache_change_cb, NULL, 0,
+                SR_SUBSCR_CTX_REUSE, &cfg_cache.sub);
+        if (rc != SR_ERR_OK) {
+            WRN("Failed to subscribe to \"%s\" changes, get-config replies will not be cached (%s).", mods[i]->name,
+                    sr_strerror(rc));
+            free(cfg_cache.sub_mods[cfg_cache.sub_mod_count]);
+            goto cleanup;
+        }
+        ++cfg_cache.sub_mod_count;
+    }
+
+    /* changes of the new modules were not tracked before */
+    ATOMIC_INC_RELAXED(cfg_cache.version);
+    cfg_cache.sub_valid = 1;
+
+cleanup:
+    free(mods);
+    return cfg_cache.sub_valid ? 0 : -1;
+}
+
+/**
+ * @brief Hash the key of a cache entry.
+ *
+ * @param[in] filter Filter of the get-config.
+ * @param[in] user NETCONF username.
+ * @return Key hash.
+ */
+static uint32_t
+np_cfg_cache_hash(const struct np2_filter *filter, const char *user)
+{
+    uint32_t i, hash = 2166136261U;
+    const char *ptr;
+
+    /* FNV-1a */
+    for (ptr = user; *ptr; ++ptr) {
+        hash = (hash ^ (unsigned char)*ptr) * 16777619U;
+    }
+    for (i = 0; i < filter->count; ++i) {
+        hash = (hash ^ (filter->filters[i].selection ? 's' : 'c')) * 16777619U;
+        for (ptr = filter->filters[i].str; *ptr; ++ptr) {
+            hash = (hash ^ (unsigned char)*ptr) * 16777619U;
+        }
+    }
+
+    return hash;
+}
+
+/**
+ * @brief Check whether a cache entry has a specific key.
+ *
+ * @param[in] entry Cache entry.
+ * @param[in] hash Key hash.
+ * @param[in] filter Filter of the get-config.
+ * @param[in] user NETCONF username.
+ * @return Whether the key matches.
+ */
+static int
+np_cfg_cache_key_match(const struct np_cfg_cache_entry *entry, uint32_t hash, const struct np2_filter *filter,
+        const char *user)
+{
+    uint32_t i;
+
+    if ((entry->hash != hash) || (entry->filter.count != filter->count) || strcmp(entry->user, user)) {
+        return 0;
+    }
+
+    for (i = 0; i < filter->count; ++i) {
+        if ((entry->filter.filters[i].selection != filter->filters[i].selection) ||
+                strcmp(entry->filter.filters[i].str, filter->filters[i].str)) {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Release a reference of a cache entry, free it if it was the last one.
+ *
+ * @param[in] entry Cache entry.
+ */
+static void
+np_cfg_cache_entry_release(struct np_cfg_cache_entry *entry)
+{
+    if (ATOMIC_DEC_RELAXED(entry->ref_count) > 1) {
+        return;
+    }
+
+    op_filter_erase(&entry->filter);
+    free(entry->user);
+    lyd_free_siblings(entry->data);
+    free(entry);
+}
+
+/**
+ * @brief Remove an entry from the cache.
+ * Cache lock held.
+ *
+ * @param[in] entry Cache entry to remove.
+ */
+static void
+np_cfg_cache_entry_remove(struct np_cfg_cache_entry *entry)
+{
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        cfg_cache.first = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        cfg_cache.last = entry->prev;
+    }
+    --cfg_cache.count;
+
+    np_cfg_cache_entry_release(entry);
+}
+
+/**
+ * @brief Insert an entry as the most recently used one.
+ * Cache lock held.
+ *
+ * @param[in] entry Cache entry to insert.
+ */
+static void
+np_cfg_cache_entry_insert(struct np_cfg_cache_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = cfg_cache.first;
+    if (cfg_cache.first) {
+        cfg_cache.first->prev = entry;
+    } else {
+        cfg_cache.last = entry;
+    }
+    cfg_cache.first = entry;
+    ++cfg_cache.count;
+}
+
+int
+np_cfg_cache_get(sr_datastore_t ds, const struct np2_filter *filter, const char *user, struct np_cfg_cache_req *req,
+        struct lyd_node **data)
+{
+    struct np_cfg_cache_entry *entry, *hit = NULL;
+    int ret = 0;
+
+    memset(req, 0, sizeof *req);
+    *data = NULL;
+
+    if (!NP2SRV_CONFIG_CACHE_SIZE || (ds != SR_DS_RUNNING)) {
+        /* not cached */
+        return 0;
+    }
+
+    req->hash = np_cfg_cache_hash(filter, user);
+    req->nacm_version = ncac_get_version();
+
+    /* LOCK */
+    pthread_mutex_lock(&cfg_cache.lock);
+
+    if (np_cfg_cache_subscribe() || ATOMIC_LOAD_RELAXED(cfg_cache.changing)) {
+        /* the data cannot be cached now */
+        goto cleanup_unlock;
+    }
+    req->version = ATOMIC_LOAD_RELAXED(cfg_cache.version);
+    req->cacheable = 1;
+
+    for (entry = cfg_cache.first; entry; entry = entry->next) {
+        if (np_cfg_cache_key_match(entry, req->hash, filter, user)) {
+            break;
+        }
+    }
+    if (!entry) {
+        goto cleanup_unlock;
+    }
+
+    if ((entry->version != req->version) || (entry->nacm_version != req->nacm_version)) {
+        /* outdated */
+        np_cfg_cache_entry_remove(entry);
+        ATOMIC_INC_RELAXED(cfg_cache.invalidations);
+        goto cleanup_unlock;
+    }
+
+    /* make it the most recently used */
+    if (entry != cfg_cache.first) {
+        entry->prev->next = entry->next;
+        if (entry->next) {
+            entry->next->prev = entry->prev;
+        } else {
+            cfg_cache.last = entry->prev;
+        }
+        --cfg_cache.count;
+        np_cfg_cache_entry_insert(entry);
+    }
+
+    /* the entry may be removed meanwhile but the data are kept until duplicated */
+    ATOMIC_INC_RELAXED(entry->ref_count);
+    hit = entry;
+
+cleanup_unlock:
+    /* UNLOCK */
+    pthread_mutex_unlock(&cfg_cache.lock);
+
+    if (hit) {
+        if (hit->data && lyd_dup_siblings(hit->data, NULL, LYD_DUP_RECURSIVE | LYD_DUP_WITH_FLAGS, data)) {
+            /* retrieve the data normally */
+            req->cacheable = 0;
+        } else {
+            ret = 1;
+        }
+        np_cfg_cache_entry_release(hit);
+    }
+
+    if (ret) {
+        ATOMIC_INC_RELAXED(cfg_cache.hits);
+    } else {
+        ATOMIC_INC_RELAXED(cfg_cache.misses);
+    }
+    return ret;
+}
+
+void
+np_cfg_cache_put(const struct np_cfg_cache_req *req, const struct np2_filter *filter, const char *user,
+        const struct lyd_node *data)
+{
+    struct np_cfg_cache_entry *entry, *iter;
+    uint32_t i;
+
+    if (!req->cacheable) {
+        return;
+    }
+
+    /* create the new entry */
+    entry = calloc(1, sizeof *entry);
+    if (!entry) {
+        EMEM;
+        return;
+    }
+    entry->hash = req->hash;
+    entry->version = req->version;
+    entry->nacm_version = req->nacm_version;
+    ATOMIC_STORE_RELAXED(entry->ref_count, 1);
+
+    entry->user = strdup(user);
+    entry->filter.filters = calloc(filter->count, sizeof *entry->filter.filters);
+    if (!entry->user || (filter->count && !entry->filter.filters)) {
+        EMEM;
+        goto error;
+    }
+    for (i = 0; i < filter->count; ++i) {
+        entry->filter.filters[i].str = strdup(filter->filters[i].str);
+        if (!entry->filter.filters[i].str) {
+            EMEM;
+            goto error;
+        }
+        entry->filter.filters[i].selection = filter->filters[i].selection;
+        ++entry->filter.count;
+    }
+    if (data && lyd_dup_siblings(data, NULL, LYD_DUP_RECURSIVE | LYD_DUP_WITH_FLAGS, &entry->data)) {
+        goto error;
+    }
+
+    /* LOCK */
+    pthread_mutex_lock(&cfg_cache.lock);
+
+    if (ATOMIC_LOAD_RELAXED(cfg_cache.changing) || (ATOMIC_LOAD_RELAXED(cfg_cache.version) != req->version) ||
+            (ncac_get_version() != req->nacm_version)) {
+        /* the data may have been retrieved with some changes in progress or are already outdated */
+        goto error_unlock;
+    }
+
+    for (iter = cfg_cache.first; iter; iter = iter->next) {
+        if (np_cfg_cache_key_match(iter, req->hash, filter, user)) {
+            break;
+        }
+    }
+    if (iter) {
+        if (iter->version == req->version) {
+            /* stored by a concurrent request */
+            goto error_unlock;
+        }
+
+        /* outdated */
+        np_cfg_cache_entry_remove(iter);
+        ATOMIC_INC_RELAXED(cfg_cache.invalidations);
+    }
+
+    np_cfg_cache_entry_insert(entry);
+
+    /* evict the least recently used entries */
+    while (cfg_cache.count > NP2SRV_CONFIG_CACHE_SIZE) {
+        np_cfg_cache_entry_remove(cfg_cache.last);
+        ATOMIC_INC_RELAXED(cfg_cache.evictions);
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&cfg_cache.lock);
+    return;
+
+error_unlock:
+    /* UNLOCK */
+    pthread_mutex_unlock(&cfg_cache.lock);
+
+error:
+    np_cfg_cache_entry_release(entry);
+}
+
+void
+np_cfg_cache_destroy(void)
+{
+    uint32_t i;
+
+    /* LOCK */
+    pthread_mutex_lock(&cfg_cache.lock);
+
+    while (cfg_cache.first) {
+        np_cfg_cache_entry_remove(cfg_cache.first);
+    }
+
+    sr_unsubscribe(cfg_cache.sub);
+    cfg_cache.sub = NULL;
+    sr_session_stop(cfg_cache.sess);
+    cfg_cache.sess = NULL;
+    for (i = 0; i < cfg_cache.sub_mod_count; ++i) {
+        free(cfg_cache.sub_mods[i]);
+    }
+    free(cfg_cache.sub_mods);
+    cfg_cache.sub_mods = NULL;
+    cfg_cache.sub_mod_count = 0;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&cfg_cache.lock);
+}
+
+void
+np_cfg_cache_metrics(struct np_metrics *m)
+{
+    uint32_t count;
+
+    /* LOCK */
+    pthread_mutex_lock(&cfg_cache.lock);
+
+    count = cfg_cache.count;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&cfg_cache.lock);
+
+    np_metrics_gauge(m, "config_cache_entries", "Number of cached get-config replies.", count);
+    np_metrics_counter(m, "config_cache_hits", "Number of get-config replies served from the cache.",
+            ATOMIC_LOAD_RELAXED(cfg_cache.hits));
+    np_metrics_counter(m, "config_cache_misses", "Number of cacheable get-config replies not found in the cache.",
+            ATOMIC_LOAD_RELAXED(cfg_cache.misses));
+    np_metrics_counter(m, "config_cache_evictions", "Number of cached get-config replies evicted because of the size "
+            "limit.", ATOMIC_LOAD_RELAXED(cfg_cache.evictions));
+    np_metrics_counter(m, "config_cache_invalidations", "Number of cached get-config replies removed because "
+            "of a datastore or NACM change.", ATOMIC_LOAD_RELAXED(cfg_cache.invalidations));
+}
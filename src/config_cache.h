@@ -0,0 +1,73 @@
+/**
+ * @file config_cache.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief cache of get-config reply data header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_CONFIG_CACHE_H_
+#define NP2SRV_CONFIG_CACHE_H_
+
+#include <stdint.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "metrics.h"
+
+/**
+ * @brief Cache request of a single get-config, used to store the reply data after a cache miss.
+ */
+struct np_cfg_cache_req {
+    int cacheable;          /* whether the reply data can be stored */
+    uint32_t hash;          /* hash of the filter and the user */
+    uint32_t version;       /* running data version before the data were retrieved */
+    uint32_t nacm_version;  /* NACM configuration version before the data were filtered */
+};
+
+/**
+ * @brief Get cached NACM-filtered reply data of a get-config.
+ *
+ * @param[in] ds Source datastore, only running is cached.
+ * @param[in] filter Filter of the get-config.
+ * @param[in] user NETCONF username.
+ * @param[out] req Cache request to store the reply data with in case of a miss.
+ * @param[out] data Duplicated cached reply data in case of a hit.
+ * @return 1 on a cache hit, 0 on a miss.
+ */
+int np_cfg_cache_get(sr_datastore_t ds, const struct np2_filter *filter, const char *user, struct np_cfg_cache_req *req,
+        struct lyd_node **data);
+
+/**
+ * @brief Store NACM-filtered reply data of a get-config after a cache miss. The data are not stored if
+ * the running datastore or NACM configuration changed since the data were retrieved.
+ *
+ * @param[in] req Cache request from the cache miss.
+ * @param[in] filter Filter of the get-config.
+ * @param[in] user NETCONF username.
+ * @param[in] data Reply data to store, are duplicated.
+ */
+void np_cfg_cache_put(const struct np_cfg_cache_req *req, const struct np2_filter *filter, const char *user,
+        const struct lyd_node *data);
+
+/**
+ * @brief Free all the cached data and unsubscribe the change subscriptions of the cache.
+ */
+void np_cfg_cache_destroy(void);
+
+/**
+ * @brief Print the cache metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void np_cfg_cache_metrics(struct np_metrics *m);
+
+#endif /* NP2SRV_CONFIG_CACHE_H_ */
@@ -0,0 +1,395 @@
+/**
+ * @file data_fetch.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief parallel retrieval of data selected by several filters
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "data_fetch.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "compat.h"
+#include "config.h"
+#include "err_netconf.h"
+#include "log.h"
+
+/**
+ * @brief Retrieval of the data of a single filter.
+ */
+struct np_data_fetch_job {
+    const char *xpath;
+    struct lyd_node *data;      /* retrieved data */
+    int rc;                     /* sysrepo error value of the retrieval */
+    char *err_msg;              /* sysrepo error message of a failed retrieval */
+};
+
+/**
+ * @brief Retrievals of a single request.
+ */
+struct np_data_fetch_ctx {
+    /* request session settings used by the workers */
+    sr_datastore_t ds;
+    const char *orig_name;
+    const void *orig_data[2];   /* NC ID and NETCONF username */
+    uint32_t orig_size[2];
+
+    uint32_t max_depth;
+    sr_get_oper_options_t get_opts;
+    struct np_data_fetch_job *jobs;
+    uint32_t job_count;
+    ATOMIC_T next_job;          /* index of the next job to retrieve */
+    ATOMIC_T failed;            /* set once any retrieval fails, the following jobs are skipped */
+
+    uint32_t worker_count;      /* workers retrieving the jobs, fetch lock */
+    uint32_t worker_max;        /* maximum number of workers */
+    int helped;                 /* some worker retrieved jobs, fetch lock */
+    struct np_data_fetch_ctx *next; /* queue, fetch lock */
+};
+
+/**
+ * @brief Worker thread with its own sysrepo session.
+ */
+struct np_data_fetch_worker {
+    pthread_t tid;
+    sr_session_ctx_t *sess;
+};
+
+/**
+ * @brief Workers retrieving data of the queued requests.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t work_cond;   /* signalled when a request is queued */
+    pthread_cond_t done_cond;   /* signalled when a worker stops retrieving the jobs of a request */
+    struct np_data_fetch_ctx *first;
+    struct np_data_fetch_ctx *last;
+    int quit;
+
+    struct np_data_fetch_worker workers[NP2SRV_DATA_FETCH_THREAD_COUNT];
+    uint32_t worker_count;
+
+    ATOMIC64_T parallel;
+    ATOMIC64_T worker_jobs;
+} data_fetch = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .work_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief Retrieve jobs of a request until there are none left.
+ *
+ * @param[in] ctx Retrievals of the request.
+ * @param[in] sess Sysrepo session to use.
+ * @return Number of retrieved jobs.
+ */
+static uint32_t
+np_data_fetch_run(struct np_data_fetch_ctx *ctx, sr_session_ctx_t *sess)
+{
+    const sr_error_info_t *err_info;
+    struct np_data_fetch_job *job;
+    uint32_t i, count = 0;
+
+    while (!ATOMIC_LOAD_RELAXED(ctx->failed) && ((i = ATOMIC_INC_RELAXED(ctx->next_job)) < ctx->job_count)) {
+        job = &ctx->jobs[i];
+
+        /* get the selected data */
+        job->rc = sr_get_data(sess, job->xpath, ctx->max_depth, np2srv.sr_timeout, ctx->get_opts, &job->data);
+        if (job->rc) {
+            ERR("Getting data \"%s\" from sysrepo failed (%s).", job->xpath, sr_strerror(job->rc));
+            sr_session_get_error(sess, &err_info);
+            job->err_msg = strdup(err_info->err[0].message);
+            ATOMIC_STORE_RELAXED(ctx->failed, 1);
+        }
+        ++count;
+    }
+
+    return count;
+}
+
+/**
+ * @brief Find a queued request with jobs left and a free worker slot.
+ * Fetch lock held.
+ *
+ * @return Found request, NULL if none.
+ */
+static struct np_data_fetch_ctx *
+np_data_fetch_queue_next(void)
+{
+    struct np_data_fetch_ctx *ctx;
+
+    for (ctx = data_fetch.first; ctx; ctx = ctx->next) {
+        if ((ctx->worker_count < ctx->worker_max) && !ATOMIC_LOAD_RELAXED(ctx->failed) &&
+                (ATOMIC_LOAD_RELAXED(ctx->next_job) < ctx->job_count)) {
+            return ctx;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Remove a request from the queue.
+ * Fetch lock held.
+ *
+ * @param[in] ctx Request to remove.
+ */
+static void
+np_data_fetch_queue_del(struct np_data_fetch_ctx *ctx)
+{
+    struct np_data_fetch_ctx *prev = NULL, *iter;
+
+    for (iter = data_fetch.first; iter != ctx; iter = iter->next) {
+        prev = iter;
+    }
+
+    if (prev) {
+        prev->next = ctx->next;
+    } else {
+        data_fetch.first = ctx->next;
+    }
+    if (data_fetch.last == ctx) {
+        data_fetch.last = prev;
+    }
+    ctx->next = NULL;
+}
+
+/**
+ * @brief Prepare a worker session for the retrievals of a request, with the same datastore and originator
+ * so that the operational callbacks see no difference.
+ *
+ * @param[in] ctx Retrievals of the request.
+ * @param[in] sess Worker sysrepo session.
+ */
+static void
+np_data_fetch_sess_prepare(const struct np_data_fetch_ctx *ctx, sr_session_ctx_t *sess)
+{
+    uint32_t i;
+
+    sr_session_switch_ds(sess, ctx->ds);
+
+    /* setting the name also discards the previous originator data */
+    sr_session_set_orig_name(sess, ctx->orig_name);
+    for (i = 0; i < 2; ++i) {
+        if (ctx->orig_data[i]) {
+            sr_session_push_orig_data(sess, ctx->orig_size[i], ctx->orig_data[i]);
+        }
+    }
+}
+
+/**
+ * @brief Worker thread retrieving jobs of the queued requests.
+ *
+ * @param[in] arg Worker structure.
+ * @return NULL.
+ */
+static void *
+np_data_fetch_thread(void *arg)
+{
+    struct np_data_fetch_worker *worker = arg;
+    struct np_data_fetch_ctx *ctx;
+    uint32_t count;
+
+    /* LOCK */
+    pthread_mutex_lock(&data_fetch.lock);
+
+    while (1) {
+        while (!data_fetch.quit && !(ctx = np_data_fetch_queue_next())) {
+            pthread_cond_wait(&data_fetch.work_cond, &data_fetch.lock);
+        }
+        if (data_fetch.quit) {
+            break;
+        }
+        ++ctx->worker_count;
+
+        /* UNLOCK */
+        pthread_mutex_unlock(&data_fetch.lock);
+
+        np_data_fetch_sess_prepare(ctx, worker->sess);
+        count = np_data_fetch_run(ctx, worker->sess);
+        ATOMIC_ADD_RELAXED(data_fetch.worker_jobs, count);
+
+        /* LOCK */
+        pthread_mutex_lock(&data_fetch.lock);
+
+        if (count) {
+            ctx->helped = 1;
+        }
+        --ctx->worker_count;
+        pthread_cond_broadcast(&data_fetch.done_cond);
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&data_fetch.lock);
+
+    return NULL;
+}
+
+int
+np_data_fetch_init(void)
+{
+    struct np_data_fetch_worker *worker;
+    uint32_t i;
+    int r;
+
+    if (NP2SRV_DATA_FETCH_MAX_FANOUT < 2) {
+        /* data are always retrieved sequentially */
+        return 0;
+    }
+
+    for (i = 0; i < NP2SRV_DATA_FETCH_THREAD_COUNT; ++i) {
+        worker = &data_fetch.workers[i];
+        if ((r = sr_session_start(np2srv.sr_conn, SR_DS_RUNNING, &worker->sess))) {
+            ERR("Failed to start a sysrepo session (%s).", sr_strerror(r));
+            return -1;
+        }
+        if ((r = pthread_create(&worker->tid, NULL, np_data_fetch_thread, worker))) {
+            ERR("Failed to create data retrieval thread (%s).", strerror(r));
+            sr_session_stop(worker->sess);
+            return -1;
+        }
+        ++data_fetch.worker_count;
+    }
+
+    return 0;
+}
+
+int
+np_data_fetch(sr_session_ctx_t *session, uint32_t max_depth, sr_get_oper_options_t get_opts,
+        const struct np2_filter *filter, sr_session_ctx_t *ev_sess, struct lyd_node **data)
+{
+    struct np_data_fetch_ctx ctx = {0};
+    struct np_data_fetch_job *job;
+    uint32_t i;
+    int rc = SR_ERR_OK;
+
+    ctx.max_depth = max_depth;
+    ctx.get_opts = get_opts;
+    ctx.jobs = calloc(filter->count, sizeof *ctx.jobs);
+    if (!ctx.jobs) {
+        EMEM;
+        return SR_ERR_NO_MEMORY;
+    }
+    ctx.job_count = filter->count;
+    for (i = 0; i < filter->count; ++i) {
+        ctx.jobs[i].xpath = filter->filters[i].str;
+    }
+
+    /* session settings for the workers, the session itself is used only by this thread */
+    ctx.ds = sr_session_get_ds(session);
+    ctx.orig_name = sr_session_get_orig_name(session);
+    if (ctx.orig_name && !strcmp(ctx.orig_name, "netopeer2")) {
+        for (i = 0; i < 2; ++i) {
+            sr_session_get_orig_data(session, i, &ctx.orig_size[i], &ctx.orig_data[i]);
+        }
+    }
+
+    /* the calling thread retrieves data as well */
+    ctx.worker_max = (filter->count < NP2SRV_DATA_FETCH_MAX_FANOUT) ? filter->count : NP2SRV_DATA_FETCH_MAX_FANOUT;
+    --ctx.worker_max;
+
+    /* LOCK */
+    pthread_mutex_lock(&data_fetch.lock);
+
+    if (data_fetch.last) {
+        data_fetch.last->next = &ctx;
+    } else {
+        data_fetch.first = &ctx;
+    }
+    data_fetch.last = &ctx;
+    pthread_cond_broadcast(&data_fetch.work_cond);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&data_fetch.lock);
+
+    np_data_fetch_run(&ctx, session);
+
+    /* LOCK */
+    pthread_mutex_lock(&data_fetch.lock);
+
+    /* no more workers can start, wait for the ones still retrieving */
+    np_data_fetch_queue_del(&ctx);
+    while (ctx.worker_count) {
+        pthread_cond_wait(&data_fetch.done_cond, &data_fetch.lock);
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&data_fetch.lock);
+
+    if (ctx.helped) {
+        ATOMIC_INC_RELAXED(data_fetch.parallel);
+    }
+
+    /* merge in the order of the filters, report the first failed one */
+    for (i = 0; i < ctx.job_count; ++i) {
+        job = &ctx.jobs[i];
+        if (job->rc) {
+            np_err_msg(ev_sess, "%s", job->err_msg ? job->err_msg : sr_strerror(job->rc));
+            rc = job->rc;
+            goto cleanup;
+        }
+
+        if (lyd_merge_siblings(data, job->data, LYD_MERGE_DESTRUCT)) {
+            rc = SR_ERR_LY;
+            goto cleanup;
+        }
+        job->data = NULL;
+    }
+
+cleanup:
+    for (i = 0; i < ctx.job_count; ++i) {
+        lyd_free_siblings(ctx.jobs[i].data);
+        free(ctx.jobs[i].err_msg);
+    }
+    free(ctx.jobs);
+    return rc;
+}
+
+void
+np_data_fetch_destroy(void)
+{
+    uint32_t i;
+
+    /* LOCK */
+    pthread_mutex_lock(&data_fetch.lock);
+
+    data_fetch.quit = 1;
+    pthread_cond_broadcast(&data_fetch.work_cond);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&data_fetch.lock);
+
+    for (i = 0; i < data_fetch.worker_count; ++i) {
+        pthread_join(data_fetch.workers[i].tid, NULL);
+        sr_session_stop(data_fetch.workers[i].sess);
+    }
+    data_fetch.worker_count = 0;
+}
+
+void
+np_data_fetch_metrics(struct np_metrics *m)
+{
+    np_metrics_gauge(m, "data_fetch_workers", "Number of threads retrieving data of read RPCs concurrently.",
+            data_fetch.worker_count);
+    np_metrics_counter(m, "data_fetch_parallel", "Number of read RPCs that retrieved data of several filters "
+            "concurrently.", ATOMIC_LOAD_RELAXED(data_fetch.parallel));
+    np_metrics_counter(m, "data_fetch_worker_retrievals", "Number of filter data retrieved by the worker threads.",
+            ATOMIC_LOAD_RELAXED(data_fetch.worker_jobs));
+}
@@ -0,0 +1,61 @@
+/**
+ * @file data_fetch.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief parallel retrieval of data selected by several filters header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_DATA_FETCH_H_
+#define NP2SRV_DATA_FETCH_H_
+
+#include <stdint.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "metrics.h"
+
+/**
+ * @brief Start the data retrieval worker threads, each with its own sysrepo session.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int np_data_fetch_init(void);
+
+/**
+ * @brief Get data selected by several filters concurrently and merge them into a data tree in the order
+ * of the filters. The calling thread retrieves the data together with at most the maximum fan-out minus one
+ * idle worker threads.
+ *
+ * @param[in] session Sysrepo session of the request, its datastore and originator are used by all the retrievals.
+ * @param[in] max_depth Maximum depth of the retrieved data.
+ * @param[in] get_opts Options for retrieving operational data.
+ * @param[in] filter Filters selecting the data.
+ * @param[in] ev_sess Event sysrepo session for errors.
+ * @param[in,out] data Data tree to merge the data into.
+ * @return Sysrepo error value.
+ */
+int np_data_fetch(sr_session_ctx_t *session, uint32_t max_depth, sr_get_oper_options_t get_opts,
+        const struct np2_filter *filter, sr_session_ctx_t *ev_sess, struct lyd_node **data);
+
+/**
+ * @brief Stop the worker threads and their sysrepo sessions. No data can be being retrieved.
+ */
+void np_data_fetch_destroy(void);
+
+/**
+ * @brief Print the parallel retrieval metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void np_data_fetch_metrics(struct np_metrics *m);
+
+#endif /* NP2SRV_DATA_FETCH_H_ */
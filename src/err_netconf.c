@@ -15,10 +15,255 @@
 
 #include "err_netconf.h"
 
+#include <pthread.h>
+#include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libyang/libyang.h>
+#include <nc_server.h>
 
 #include "common.h"
 #include "compat.h"
+#include "log.h"
+
+/**
+ * @brief Key of the errors of the directly called RPC callback of the current thread.
+ */
+static pthread_key_t err_direct_key;
+static pthread_once_t err_direct_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief Create the direct errors key.
+ */
+static void
+np_err_direct_key_create(void)
+{
+    pthread_key_create(&err_direct_key, NULL);
+}
+
+/**
+ * @brief Get the errors of the directly called RPC callback of the current thread.
+ *
+ * @return Direct errors, NULL if the callback was called by sysrepo.
+ */
+static struct np_err_direct *
+np_err_direct_get(void)
+{
+    pthread_once(&err_direct_once, np_err_direct_key_create);
+
+    return pthread_getspecific(err_direct_key);
+}
+
+/**
+ * @brief Add a NETCONF error to the direct errors.
+ *
+ * @param[in] direct Direct errors.
+ * @param[in] e NETCONF error to add, is spent.
+ */
+static void
+np_err_direct_add(struct np_err_direct *direct, struct lyd_node *e)
+{
+    if (!e) {
+        return;
+    }
+
+    if (direct->reply) {
+        nc_server_reply_add_err(direct->reply, e);
+    } else {
+        direct->reply = nc_server_reply_err(e);
+    }
+}
+
+/**
+ * @brief Create a NETCONF error from a sysrepo error with the NETCONF format.
+ *
+ * @param[in] err Sysrepo error.
+ * @return NETCONF error, NULL on error.
+ */
+static struct lyd_node *
+np_err_nc(sr_error_info_err_t *err)
+{
+    struct lyd_node *e = NULL, *err_info = NULL;
+    const char *err_type, *err_tag, *err_msg, *str, *str2;
+    uint32_t err_idx;
+
+    /* mandatory */
+    err_idx = 0;
+    if (sr_get_error_data(err, err_idx++, NULL, (const void **)&err_type)) {
+        WRN("Missing NETCONF error \"error-type\".");
+        goto error;
+    } else if (sr_get_error_data(err, err_idx++, NULL, (const void **)&err_tag)) {
+        WRN("Missing NETCONF error \"error-tag\".");
+        goto error;
+    } else if (sr_get_error_data(err, err_idx++, NULL, (const void **)&err_msg)) {
+        WRN("Missing NETCONF error \"error-message\".");
+        goto error;
+    }
+    /* rpc-error */
+    if (lyd_new_opaq2(NULL, sr_get_context(np2srv.sr_conn), "rpc-error", NULL, NULL, NC_NS_BASE, &e)) {
+        goto error;
+    }
+    /* error-type */
+    if (lyd_new_opaq2(e, NULL, "error-type", err_type, NULL, NC_NS_BASE, NULL)) {
+        goto error;
+    }
+    /* error-tag */
+    if (lyd_new_opaq2(e, NULL, "error-tag", err_tag, NULL, NC_NS_BASE, NULL)) {
+        goto error;
+    }
+    /* error-severity */
+    if (lyd_new_opaq2(e, NULL, "error-severity", "error", NULL, NC_NS_BASE, NULL)) {
+        goto error;
+    }
+    /* error-message */
+    if (nc_err_set_msg(e, err_msg, "en")) {
+        goto error;
+    }
+
+    /* error-app-tag */
+    if (sr_get_error_data(err, err_idx++, NULL, (const void **)&str)) {
+        return e;
+    }
+    if (str[0]) {
+        if (nc_err_set_app_tag(e, str)) {
+            goto error;
+        }
+    }
+    /* error-path */
+    if (sr_get_error_data(err, err_idx++, NULL, (const void **)&str)) {
+        return e;
+    }
+    if (str[0]) {
+        if (nc_err_set_path(e, str)) {
+            goto error;
+        }
+    }
+    /* error-info */
+    while (!sr_get_error_data(err, err_idx++, NULL, (const void **)&str) &&
+            !sr_get_error_data(err, err_idx++, NULL, (const void **)&str2)) {
+        if (!err_info) {
+            if (lyd_new_opaq2(e, NULL, "error-info", NULL, NULL, NC_NS_BASE, &err_info)) {
+                goto error;
+            }
+        }
+        if (lyd_new_opaq2(err_info, NULL, str, str2, NULL, NC_NS_BASE, NULL)) {
+            goto error;
+        }
+    }
+
+    return e;
+
+error:
+    lyd_free_tree(e);
+    return NULL;
+}
+
+struct nc_server_reply *
+np_err_reply_sr(const sr_error_info_t *err_info)
+{
+    struct nc_server_reply *reply = NULL;
+    struct lyd_node *e;
+    size_t i;
+
+    /* try to find a NETCONF error */
+    for (i = 0; i < err_info->err_count; ++i) {
+        if (err_info->err[i].error_format && !strcmp(err_info->err[i].error_format, "NETCONF")) {
+            /* NETCONF error */
+            e = np_err_nc(&err_info->err[i]);
+            if (e) {
+                reply = nc_server_reply_err(e);
+            }
+            break;
+        }
+    }
+
+    if (reply) {
+        /* return just the NETCONF error */
+        return reply;
+    }
+
+    for (i = 0; i < err_info->err_count; ++i) {
+        /* generic error */
+        e = nc_err(sr_get_context(np2srv.sr_conn), NC_ERR_OP_FAILED, NC_ERR_TYPE_APP);
+        nc_err_set_msg(e, err_info->err[i].message, "en");
+
+        if (reply) {
+            nc_server_reply_add_err(reply, e);
+        } else {
+            reply = nc_server_reply_err(e);
+        }
+        e = NULL;
+    }
+
+    return reply;
+}
+
+void
+np_err_direct_start(struct np_err_direct *direct)
+{
+    pthread_once(&err_direct_once, np_err_direct_key_create);
+
+    direct->reply = NULL;
+    pthread_setspecific(err_direct_key, direct);
+}
+
+struct nc_server_reply *
+np_err_direct_end(struct np_err_direct *direct)
+{
+    pthread_setspecific(err_direct_key, NULL);
+
+    return direct->reply;
+}
+
+void
+np_err_msg(sr_session_ctx_t *ev_sess, const char *format, ...)
+{
+    struct np_err_direct *direct;
+    struct lyd_node *e;
+    va_list ap;
+    char *msg;
+
+    va_start(ap, format);
+    if (vasprintf(&msg, format, ap) == -1) {
+        va_end(ap);
+        EMEM;
+        return;
+    }
+    va_end(ap);
+
+    if ((direct = np_err_direct_get())) {
+        /* no event session, create the NETCONF error right away */
+        e = nc_err(sr_get_context(np2srv.sr_conn), NC_ERR_OP_FAILED, NC_ERR_TYPE_APP);
+        nc_err_set_msg(e, msg, "en");
+        np_err_direct_add(direct, e);
+    } else {
+        sr_session_set_error_message(ev_sess, "%s", msg);
+    }
+    free(msg);
+}
+
+void
+np_err_dup(sr_session_ctx_t *src_sess, sr_session_ctx_t *ev_sess)
+{
+    struct np_err_direct *direct;
+    const sr_error_info_t *err_info;
+    struct nc_server_reply *reply;
+
+    if (!(direct = np_err_direct_get())) {
+        sr_session_dup_error(src_sess, ev_sess);
+        return;
+    }
+
+    /* no event session, create the NETCONF errors right away */
+    sr_session_get_error(src_sess, &err_info);
+    reply = np_err_reply_sr(err_info);
+    if (direct->reply) {
+        nc_server_reply_free(direct->reply);
+    }
+    direct->reply = reply;
+}
 
 void
 np_err_nacm_access_denied(sr_session_ctx_t *ev_sess, const char *module_name, const char *user, const char *path)
@@ -56,8 +301,20 @@ np_err_sr2nc_lock_denied(sr_session_ctx_t *ev_sess, const sr_error_info_t *err_i
 {
     struct nc_session *nc_sess;
     const char *str, *ptr;
+    struct np_err_direct *direct;
     char buf[11];
 
+    str = "DS-locked by session ";
+    ptr = strstr(err_info->err[0].message, str);
+    nc_sess = ptr ? np_get_nc_sess_by_sr_id(atoi(ptr + strlen(str))) : NULL;
+
+    if ((direct = np_err_direct_get())) {
+        /* no event session, create the NETCONF error right away */
+        np_err_direct_add(direct, nc_err(sr_get_context(np2srv.sr_conn), NC_ERR_LOCK_DENIED,
+                nc_sess ? nc_session_get_id(nc_sess) : 0));
+        return;
+    }
+
     /* error format */
     sr_session_set_error_format(ev_sess, "NETCONF");
 
@@ -83,13 +340,9 @@ np_err_sr2nc_lock_denied(sr_session_ctx_t *ev_sess, const sr_error_info_t *err_i
     str = "session-id";
     sr_session_push_error_data(ev_sess, strlen(str) + 1, str);
 
-    str = "DS-locked by session ";
-    ptr = strstr(err_info->err[0].message, str);
     if (!ptr) {
         return;
     }
-    nc_sess = np_get_nc_sess_by_sr_id(atoi(ptr + strlen(str)));
-
     sprintf(buf, "%" PRIu32, nc_sess ? nc_session_get_id(nc_sess) : 0);
     sr_session_push_error_data(ev_sess, strlen(buf) + 1, buf);
 }
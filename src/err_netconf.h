@@ -15,8 +15,57 @@
 #ifndef NP2SRV_ERR_NETCONF_H_
 #define NP2SRV_ERR_NETCONF_H_
 
+#include <nc_server.h>
 #include <sysrepo.h>
 
+/**
+ * @brief Errors of an RPC callback called directly, without a sysrepo event session.
+ */
+struct np_err_direct {
+    struct nc_server_reply *reply;  /* error reply with all the errors set by the callback */
+};
+
+/**
+ * @brief Create an error reply from sysrepo errors.
+ *
+ * @param[in] err_info Sysrepo error info.
+ * @return Error reply, NULL on error.
+ */
+struct nc_server_reply *np_err_reply_sr(const sr_error_info_t *err_info);
+
+/**
+ * @brief Start collecting errors of an RPC callback called directly by this thread.
+ *
+ * All the following functions create NETCONF errors right away instead of setting them in the event session.
+ *
+ * @param[in] direct Direct errors to use.
+ */
+void np_err_direct_start(struct np_err_direct *direct);
+
+/**
+ * @brief Stop collecting errors of a directly called RPC callback.
+ *
+ * @param[in] direct Direct errors used.
+ * @return Error reply, NULL if the callback set no errors.
+ */
+struct nc_server_reply *np_err_direct_end(struct np_err_direct *direct);
+
+/**
+ * @brief Set an error message of an RPC callback.
+ *
+ * @param[in] ev_sess Event session, unused for a directly called callback.
+ * @param[in] format Format string of the message.
+ */
+void np_err_msg(sr_session_ctx_t *ev_sess, const char *format, ...);
+
+/**
+ * @brief Use the last errors of a session as the errors of an RPC callback.
+ *
+ * @param[in] src_sess Session with the errors.
+ * @param[in] ev_sess Event session, unused for a directly called callback.
+ */
+void np_err_dup(sr_session_ctx_t *src_sess, sr_session_ctx_t *ev_sess);
+
 void np_err_nacm_access_denied(sr_session_ctx_t *ev_sess, const char *module_name, const char *user, const char *path);
 
 void np_err_sr2nc_lock_denied(sr_session_ctx_t *ev_sess, const sr_error_info_t *err_info);
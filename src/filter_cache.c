@@ -0,0 +1,432 @@
+/**
+ * @file filter_cache.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief cache of compiled read RPC filters
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "filter_cache.h"
+
+#include <ctype.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "compat.h"
+#include "config.h"
+#include "log.h"
+
+/**
+ * @brief Compiled filter cache.
+ */
+static struct {
+    pthread_mutex_t lock;
+    struct np_filter_plan *first;   /* most recently used */
+    struct np_filter_plan *last;    /* least recently used */
+    uint32_t count;
+    uint32_t content_id;            /* sysrepo content-id of the cached plans */
+
+    ATOMIC64_T hits;
+    ATOMIC64_T misses;
+    ATOMIC64_T evictions;
+} filter_cache = {.lock = PTHREAD_MUTEX_INITIALIZER};
+
+static int
+np_filter_first_ns(const char *expr, const char **start, int *len)
+{
+    int i;
+
+    if (expr[0] != '/') {
+        return -1;
+    }
+    if (expr[1] == '/') {
+        expr += 2;
+    } else {
+        ++expr;
+    }
+
+    if (!isalpha(expr[0]) && (expr[0] != '_')) {
+        return -1;
+    }
+    for (i = 1; expr[i] && (isalnum(expr[i]) || (expr[i] == '_') || (expr[i] == '-') || (expr[i] == '.')); ++i) {}
+    if (expr[i] != ':') {
+        return -1;
+    }
+
+    *start = expr;
+    *len = i;
+    return 0;
+}
+
+/**
+ * @brief Get generic filters in the form of "/module:*" from exact xpath filters.
+ */
+static int
+np_filter_mod_filters(const struct np2_filter *filter, struct np2_filter *mod_filter)
+{
+    int len, selection;
+    uint32_t i, j;
+    const char *start;
+    char *str;
+    void *mem;
+
+    for (i = 0; i < filter->count; ++i) {
+        if (np_filter_first_ns(filter->filters[i].str, &start, &len)) {
+            /* not the simple format, use it as it is */
+            str = strdup(filter->filters[i].str);
+            selection = filter->filters[i].selection;
+        } else {
+            /* get all the data of a module */
+            if (asprintf(&str, "/%.*s:*", len, start) == -1) {
+                str = NULL;
+            }
+            selection = 1;
+        }
+
+        if (!str) {
+            EMEM;
+            return SR_ERR_NO_MEMORY;
+        }
+
+        /* check for a duplicity */
+        for (j = 0; j < mod_filter->count; ++j) {
+            if (!strcmp(str, mod_filter->filters[j].str)) {
+                break;
+            }
+        }
+        if (j < mod_filter->count) {
+            free(str);
+            continue;
+        }
+
+        /* add a new module filter */
+        mem = realloc(mod_filter->filters, (mod_filter->count + 1) * sizeof *mod_filter->filters);
+        if (!mem) {
+            free(str);
+            EMEM;
+            return SR_ERR_NO_MEMORY;
+        }
+        mod_filter->filters = mem;
+        mod_filter->filters[mod_filter->count].str = str;
+        mod_filter->filters[mod_filter->count].selection = selection;
+        ++mod_filter->count;
+    }
+
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Create the canonical form of a filter used as the cache key.
+ *
+ * @param[in] subtree_filter Subtree filter node, NULL if @p xpath_filter is used.
+ * @param[in] xpath_filter XPath filter, used if @p subtree_filter is NULL.
+ * @param[out] key Canonical filter.
+ * @return Sysrepo error value.
+ */
+static int
+np_filter_plan_key(const struct lyd_node_any *subtree_filter, const char *xpath_filter, char **key)
+{
+    char *str = NULL;
+    int r;
+
+    if (!subtree_filter) {
+        r = asprintf(key, "x%s", xpath_filter);
+    } else if ((subtree_filter->value_type == LYD_ANYDATA_DATATREE) && subtree_filter->value.tree) {
+        /* the printed tree includes all the namespaces, attributes, and values */
+        if (lyd_print_mem(&str, subtree_filter->value.tree, LYD_XML, LYD_PRINT_WITHSIBLINGS | LYD_PRINT_SHRINK)) {
+            return SR_ERR_LY;
+        }
+        r = asprintf(key, "s%s", str);
+        free(str);
+    } else {
+        /* empty subtree filter */
+        r = asprintf(key, "s");
+    }
+    if (r == -1) {
+        *key = NULL;
+        EMEM;
+        return SR_ERR_NO_MEMORY;
+    }
+
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Compile a filter.
+ *
+ * @param[in] subtree_filter Subtree filter node, NULL if @p xpath_filter is used.
+ * @param[in] xpath_filter XPath filter, used if @p subtree_filter is NULL.
+ * @param[in,out] plan Plan to fill.
+ * @return Sysrepo error value.
+ */
+static int
+np_filter_plan_compile(const struct lyd_node_any *subtree_filter, const char *xpath_filter, struct np_filter_plan *plan)
+{
+    if (!subtree_filter) {
+        /* create a single filter */
+        plan->filter.filters = malloc(sizeof *plan->filter.filters);
+        if (!plan->filter.filters) {
+            EMEM;
+            return SR_ERR_NO_MEMORY;
+        }
+        plan->filter.filters[0].str = strdup(xpath_filter);
+        if (!plan->filter.filters[0].str) {
+            EMEM;
+            return SR_ERR_NO_MEMORY;
+        }
+        plan->filter.filters[0].selection = 1;
+        plan->filter.count = 1;
+    } else if ((subtree_filter->value_type == LYD_ANYDATA_DATATREE) && subtree_filter->value.tree) {
+        /* subtree */
+        if (op_filter_subtree2xpath(subtree_filter->value.tree, &plan->filter)) {
+            return SR_ERR_INTERNAL;
+        }
+    } /* else empty subtree filter selecting nothing */
+
+    /* module filters */
+    return np_filter_mod_filters(&plan->filter, &plan->mod_filter);
+}
+
+/**
+ * @brief Free a compiled filter.
+ *
+ * @param[in] plan Compiled filter to free.
+ */
+static void
+np_filter_plan_free(struct np_filter_plan *plan)
+{
+    op_filter_erase(&plan->filter);
+    op_filter_erase(&plan->mod_filter);
+    free(plan->key);
+    free(plan);
+}
+
+/**
+ * @brief Remove all the compiled filters from the cache.
+ * Cache lock held.
+ */
+static void
+np_filter_cache_flush(void)
+{
+    struct np_filter_plan *plan;
+
+    while ((plan = filter_cache.first)) {
+        filter_cache.first = plan->next;
+        np_filter_plan_release(plan);
+    }
+    filter_cache.last = NULL;
+    filter_cache.count = 0;
+}
+
+/**
+ * @brief Find a compiled filter in the cache and make it the most recently used.
+ * Cache lock held.
+ *
+ * @param[in] key Canonical filter.
+ * @param[in] hash Hash of @p key.
+ * @param[in] content_id Sysrepo content-id the filter is compiled for.
+ * @return Found compiled filter with a new reference, NULL if not found.
+ */
+static struct np_filter_plan *
+np_filter_cache_find(const char *key, uint32_t hash, uint32_t content_id)
+{
+    struct np_filter_plan *plan;
+
+    if (filter_cache.content_id != content_id) {
+        /* the plans depend on the context, they may select different data now */
+        np_filter_cache_flush();
+        filter_cache.content_id = content_id;
+        return NULL;
+    }
+
+    for (plan = filter_cache.first; plan; plan = plan->next) {
+        if ((plan->hash == hash) && !strcmp(plan->key, key)) {
+            break;
+        }
+    }
+    if (!plan) {
+        return NULL;
+    }
+
+    if (plan != filter_cache.first) {
+        /* unlink */
+        plan->prev->next = plan->next;
+        if (plan->next) {
+            plan->next->prev = plan->prev;
+        } else {
+            filter_cache.last = plan->prev;
+        }
+
+        /* insert first */
+        plan->prev = NULL;
+        plan->next = filter_cache.first;
+        filter_cache.first->prev = plan;
+        filter_cache.first = plan;
+    }
+
+    ATOMIC_INC_RELAXED(plan->ref_count);
+    return plan;
+}
+
+int
+np_filter_plan_get(const struct lyd_node_any *subtree_filter, const char *xpath_filter,
+        const struct np_filter_plan **plan)
+{
+    struct np_filter_plan *new_plan = NULL, *found;
+    char *key = NULL;
+    const char *ptr;
+    uint32_t hash = 2166136261U, content_id;
+    int rc;
+
+    *plan = NULL;
+
+    /* the filter is compiled in the current context */
+    content_id = sr_get_content_id(np2srv.sr_conn);
+
+    if ((rc = np_filter_plan_key(subtree_filter, xpath_filter, &key))) {
+        return rc;
+    }
+
+    /* FNV-1a */
+    for (ptr = key; *ptr; ++ptr) {
+        hash = (hash ^ (unsigned char)*ptr) * 16777619U;
+    }
+
+    /* LOCK */
+    pthread_mutex_lock(&filter_cache.lock);
+
+    found = np_filter_cache_find(key, hash, content_id);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&filter_cache.lock);
+
+    if (found) {
+        ATOMIC_INC_RELAXED(filter_cache.hits);
+        free(key);
+        *plan = found;
+        return SR_ERR_OK;
+    }
+    ATOMIC_INC_RELAXED(filter_cache.misses);
+
+    /* compile the filter */
+    new_plan = calloc(1, sizeof *new_plan);
+    if (!new_plan) {
+        free(key);
+        EMEM;
+        return SR_ERR_NO_MEMORY;
+    }
+    new_plan->key = key;
+    new_plan->hash = hash;
+    ATOMIC_STORE_RELAXED(new_plan->ref_count, 1);
+    if ((rc = np_filter_plan_compile(subtree_filter, xpath_filter, new_plan))) {
+        np_filter_plan_free(new_plan);
+        return rc;
+    }
+
+    if (!NP2SRV_FILTER_CACHE_SIZE) {
+        /* not cached */
+        *plan = new_plan;
+        return SR_ERR_OK;
+    }
+
+    /* LOCK */
+    pthread_mutex_lock(&filter_cache.lock);
+
+    found = np_filter_cache_find(key, hash, content_id);
+    if (found) {
+        /* compiled by a concurrent request */
+        np_filter_plan_free(new_plan);
+        new_plan = found;
+    } else {
+        /* cache reference */
+        ATOMIC_INC_RELAXED(new_plan->ref_count);
+        new_plan->next = filter_cache.first;
+        if (filter_cache.first) {
+            filter_cache.first->prev = new_plan;
+        } else {
+            filter_cache.last = new_plan;
+        }
+        filter_cache.first = new_plan;
+        ++filter_cache.count;
+
+        /* evict the least recently used plans */
+        while (filter_cache.count > NP2SRV_FILTER_CACHE_SIZE) {
+            found = filter_cache.last;
+            filter_cache.last = found->prev;
+            filter_cache.last->next = NULL;
+            --filter_cache.count;
+            np_filter_plan_release(found);
+            ATOMIC_INC_RELAXED(filter_cache.evictions);
+        }
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&filter_cache.lock);
+
+    *plan = new_plan;
+    return SR_ERR_OK;
+}
+
+void
+np_filter_plan_release(const struct np_filter_plan *plan)
+{
+    struct np_filter_plan *p = (struct np_filter_plan *)plan;
+
+    if (!p) {
+        return;
+    }
+
+    /* the last reference must see all the accesses of the other references */
+    if (ATOMIC_DEC_ACQ_REL(p->ref_count) == 1) {
+        np_filter_plan_free(p);
+    }
+}
+
+void
+np_filter_cache_destroy(void)
+{
+    /* LOCK */
+    pthread_mutex_lock(&filter_cache.lock);
+
+    np_filter_cache_flush();
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&filter_cache.lock);
+}
+
+void
+np_filter_cache_metrics(struct np_metrics *m)
+{
+    uint32_t count;
+
+    /* LOCK */
+    pthread_mutex_lock(&filter_cache.lock);
+
+    count = filter_cache.count;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&filter_cache.lock);
+
+    np_metrics_gauge(m, "filter_cache_entries", "Number of cached compiled filters.", count);
+    np_metrics_counter(m, "filter_cache_hits", "Number of read RPC filters found compiled in the cache.",
+            ATOMIC_LOAD_RELAXED(filter_cache.hits));
+    np_metrics_counter(m, "filter_cache_misses", "Number of read RPC filters compiled.",
+            ATOMIC_LOAD_RELAXED(filter_cache.misses));
+    np_metrics_counter(m, "filter_cache_evictions", "Number of compiled filters evicted because of the size limit.",
+            ATOMIC_LOAD_RELAXED(filter_cache.evictions));
+}
@@ -0,0 +1,71 @@
+/**
+ * @file filter_cache.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief cache of compiled read RPC filters header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_FILTER_CACHE_H_
+#define NP2SRV_FILTER_CACHE_H_
+
+#include <stdint.h>
+
+#include <libyang/libyang.h>
+
+#include "common.h"
+#include "compat.h"
+#include "metrics.h"
+
+/**
+ * @brief Compiled filter of a read RPC, shared by all the requests with the same filter and never modified.
+ */
+struct np_filter_plan {
+    struct np2_filter filter;       /* selection and content XPath filters */
+    struct np2_filter mod_filter;   /* filters of whole modules with any data selected by filter */
+
+    /* internal data */
+    char *key;                      /* canonical filter */
+    uint32_t hash;
+    ATOMIC_T ref_count;             /* reference of the cache and of every request using the plan */
+    struct np_filter_plan *prev;    /* LRU list, cache lock */
+    struct np_filter_plan *next;
+};
+
+/**
+ * @brief Get the compiled filter of a read RPC, from the cache if possible.
+ *
+ * @param[in] subtree_filter Subtree filter node, NULL if @p xpath_filter is used.
+ * @param[in] xpath_filter XPath filter, used if @p subtree_filter is NULL.
+ * @param[out] plan Compiled filter, must be released.
+ * @return Sysrepo error value.
+ */
+int np_filter_plan_get(const struct lyd_node_any *subtree_filter, const char *xpath_filter,
+        const struct np_filter_plan **plan);
+
+/**
+ * @brief Release a compiled filter.
+ *
+ * @param[in] plan Compiled filter to release, may be NULL.
+ */
+void np_filter_plan_release(const struct np_filter_plan *plan);
+
+/**
+ * @brief Free all the cached compiled filters.
+ */
+void np_filter_cache_destroy(void);
+
+/**
+ * @brief Print the cache metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void np_filter_cache_metrics(struct np_metrics *m);
+
+#endif /* NP2SRV_FILTER_CACHE_H_ */
@@ -12,16 +12,21 @@
  *     https://opensource.org/licenses/BSD-3-Clause
  */
 
-#define _DEFAULT_SOURCE
+#define _GNU_SOURCE
 
 #include "log.h"
 
+#include <assert.h>
 #include <errno.h>
+#include <inttypes.h>
+#include <pthread.h>
 #include <stdarg.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 #include <sys/types.h>
 #include <syslog.h>
+#include <time.h>
 #include <unistd.h>
 
 #include <libyang/libyang.h>
@@ -29,104 +34,414 @@
 #include <sysrepo.h>
 
 #include "common.h"
+#include "compat.h"
 
 volatile uint8_t np2_verbose_level;
+volatile uint8_t np2_sub_verbose_level[NP2LOG_SUB_COUNT];
 uint8_t np2_libssh_verbose_level;
 uint8_t np2_sr_verbose_level;
 uint8_t np2_stderr_log;
 
+/**
+ * @brief Subsystem message sources, in the order of enum np2log_sub.
+ */
+static const char *np2log_sub_src[NP2LOG_SUB_COUNT] = {"NACM", "SUBNTF", "YP", "SESS", "TRANSP", "URL", "STATS"};
+
+/**
+ * @brief Subsystem names, as in the netopeer2-server module.
+ */
+static const char *np2log_sub_name[NP2LOG_SUB_COUNT] = {"nacm", "subscriptions", "yang-push", "sessions",
+    "transport", "url", "statistics"};
+
+/**
+ * @brief Buffered log message.
+ */
+struct np2log_rec {
+    int priority;
+    const char *src;
+    struct timespec time;   /* when the message was logged */
+    char msg[NP2SRV_LOG_MSG_LEN];
+};
+
+/**
+ * @brief Ring buffer of log messages of a single thread, written only by the thread and read only by the logging thread.
+ */
+struct np2log_ring {
+    struct np2log_rec recs[NP2SRV_LOG_RING_SIZE];
+    ATOMIC_T head;                  /* next record to write, written by the owner thread */
+    ATOMIC_T tail;                  /* next record to print, written by the logging thread */
+    ATOMIC_T dropped;               /* messages dropped because the ring was full */
+    ATOMIC_T dead;                  /* the owner thread has terminated */
+
+    uint32_t dropped_reported;      /* dropped messages already reported, logging thread only */
+    struct np2log_ring *next;
+};
+
+/**
+ * @brief Asynchronous logging state.
+ */
+static struct {
+    ATOMIC_T running;               /* whether the logging thread prints the messages */
+    pthread_t tid;
+    pthread_key_t ring_key;         /* ring of the current thread */
+    struct np2log_ring *rings;      /* all the rings, protected by the lock */
+    uint64_t dropped;               /* reported dropped messages of all the rings, protected by the lock */
+    pthread_mutex_t lock;
+
+    int wake;                       /* a ring has reached its high-water mark, protected by the wake lock */
+    pthread_cond_t wake_cond;
+    pthread_mutex_t wake_lock;      /* separate so that a logging thread never waits for the messages being printed */
+} np2log_async = {.lock = PTHREAD_MUTEX_INITIALIZER, .wake_lock = PTHREAD_MUTEX_INITIALIZER};
+
+/**
+ * @brief Print a log message to syslog and stderr, if enabled.
+ *
+ * @param[in] priority Syslog priority.
+ * @param[in] src Message source.
+ * @param[in] ts Time the message was logged at, NULL if being logged now.
+ * @param[in] msg Message to print.
+ */
 static void
-np2log(int priority, const char *src, const char *fmt, ...)
+np2log_write(int priority, const char *src, const struct timespec *ts, const char *msg)
 {
-    char *format;
-    va_list ap;
+    const char *prio_str;
+    struct timespec now;
+    struct tm tm;
+    char time_str[32];
+
+    if (!ts) {
+        clock_gettime(CLOCK_REALTIME, &now);
+        ts = &now;
+    }
+    localtime_r(&ts->tv_sec, &tm);
+    strftime(time_str, sizeof time_str, "%Y-%m-%dT%H:%M:%S", &tm);
+    sprintf(time_str + strlen(time_str), ".%03ld", ts->tv_nsec / 1000000L);
 
-    va_start(ap, fmt);
-    vsyslog(priority, fmt, ap);
-    va_end(ap);
+    if (ts == &now) {
+        syslog(priority, "%s", msg);
+    } else {
+        /* printed later than logged, syslog would only add the current time */
+        syslog(priority, "[%s] %s", time_str, msg);
+    }
 
     if (np2_stderr_log) {
-        format = malloc(11 + strlen(fmt) + 2);
-        if (!format) {
-            fprintf(stderr, "[ERR]: Memory allocation failed (%s:%d), src: %s, fmt: %s\n", __FILE__, __LINE__, src, fmt);
-            return;
-        }
-
         switch (priority) {
         case LOG_ERR:
-            sprintf(format, "[ERR]: %s: %s\n", src, fmt);
+            prio_str = "ERR";
             break;
         case LOG_WARNING:
-            sprintf(format, "[WRN]: %s: %s\n", src, fmt);
+            prio_str = "WRN";
             break;
         case LOG_INFO:
-            sprintf(format, "[INF]: %s: %s\n", src, fmt);
+            prio_str = "INF";
             break;
         case LOG_DEBUG:
-            sprintf(format, "[DBG]: %s: %s\n", src, fmt);
+            prio_str = "DBG";
             break;
         default:
-            sprintf(format, "[UNK]: %s: %s\n", src, fmt);
+            prio_str = "UNK";
             break;
         }
+        fprintf(stderr, "[%s] [%s]: %s: %s\n", time_str, prio_str, src, msg);
+    }
+}
+
+/**
+ * @brief Destructor of a thread ring, the ring itself is freed by the logging thread once printed.
+ *
+ * @param[in] arg Thread ring.
+ */
+static void
+np2log_ring_release(void *arg)
+{
+    struct np2log_ring *ring = arg;
+
+    ATOMIC_STORE_RELEASE(ring->dead, 1);
+}
+
+/**
+ * @brief Get a free record in the ring of the current thread.
+ *
+ * @param[out] ring Ring of the current thread.
+ * @return Record to fill, NULL if the message should be printed directly.
+ * @return Record with no message if the ring is full and the message was dropped.
+ */
+static struct np2log_rec *
+np2log_rec_get(struct np2log_ring **ring)
+{
+    static struct np2log_rec dropped_rec;
+    ATOMIC_T head;
+
+    if (!ATOMIC_LOAD_ACQUIRE(np2log_async.running)) {
+        return NULL;
+    }
+
+    *ring = pthread_getspecific(np2log_async.ring_key);
+    if (!*ring) {
+        /* first message of this thread, create its ring */
+        *ring = calloc(1, sizeof **ring);
+        if (!*ring) {
+            return NULL;
+        }
+        pthread_setspecific(np2log_async.ring_key, *ring);
+
+        /* LOCK */
+        pthread_mutex_lock(&np2log_async.lock);
 
-        va_start(ap, fmt);
-        vfprintf(stderr, format, ap);
-        va_end(ap);
+        (*ring)->next = np2log_async.rings;
+        np2log_async.rings = *ring;
 
-        free(format);
+        /* UNLOCK */
+        pthread_mutex_unlock(&np2log_async.lock);
+    }
+
+    head = ATOMIC_LOAD_RELAXED((*ring)->head);
+    if (head - ATOMIC_LOAD_ACQUIRE((*ring)->tail) == NP2SRV_LOG_RING_SIZE) {
+        /* full, never block the caller */
+        ATOMIC_INC_RELAXED((*ring)->dropped);
+        *ring = NULL;
+        return &dropped_rec;
+    }
+
+    return &(*ring)->recs[head & (NP2SRV_LOG_RING_SIZE - 1)];
+}
+
+/**
+ * @brief Publish a filled record to the logging thread and wake it up if the ring has reached its high-water mark.
+ *
+ * @param[in] ring Ring of the record, nothing is done if NULL.
+ */
+static void
+np2log_rec_commit(struct np2log_ring *ring)
+{
+    ATOMIC_T head;
+
+    if (!ring) {
+        return;
+    }
+
+    head = ATOMIC_LOAD_RELAXED(ring->head) + 1;
+    ATOMIC_STORE_RELEASE(ring->head, head);
+
+    if (head - ATOMIC_LOAD_ACQUIRE(ring->tail) == NP2SRV_LOG_RING_HIGH_WATER) {
+        /* WAKE LOCK */
+        pthread_mutex_lock(&np2log_async.wake_lock);
+
+        np2log_async.wake = 1;
+        pthread_cond_signal(&np2log_async.wake_cond);
+
+        /* WAKE UNLOCK */
+        pthread_mutex_unlock(&np2log_async.wake_lock);
     }
 }
 
 /**
- * @brief Encode message characters (% -> %%) to avoid printf arg problems.
+ * @brief Print all the buffered messages.
+ *
+ * @return Number of printed messages.
  */
-static const char *
-np2log_encode(const char *msg, char **buf)
+static uint32_t
+np2log_flush(void)
 {
-    const char *ptr1, *ptr2;
-    size_t buf_len, buf_size = 1;
-    void *mem;
-
-    *buf = NULL;
-    if ((ptr2 = strchr(msg, '%'))) {
-        /* something to encode */
-        ptr1 = msg;
-        do {
-            /* enlarge buffer */
-            buf_len = buf_size - 1;
-            buf_size += (ptr2 - ptr1) + 2;
-            mem = realloc(*buf, buf_size * sizeof **buf);
-            if (!mem) {
-                EMEM;
-                return "";
+    struct np2log_ring *ring, **prev;
+    struct np2log_rec *rec;
+    ATOMIC_T head, tail;
+    uint32_t dropped, count = 0;
+    int dead;
+
+    /* LOCK */
+    pthread_mutex_lock(&np2log_async.lock);
+
+    prev = &np2log_async.rings;
+    while ((ring = *prev)) {
+        /* learn whether the owner has terminated before reading head so that no more messages can be added */
+        dead = ATOMIC_LOAD_ACQUIRE(ring->dead);
+
+        head = ATOMIC_LOAD_ACQUIRE(ring->head);
+        for (tail = ATOMIC_LOAD_RELAXED(ring->tail); tail != head; ++tail) {
+            rec = &ring->recs[tail & (NP2SRV_LOG_RING_SIZE - 1)];
+            np2log_write(rec->priority, rec->src, &rec->time, rec->msg);
+            ++count;
+        }
+        ATOMIC_STORE_RELEASE(ring->tail, tail);
+
+        dropped = ATOMIC_LOAD_RELAXED(ring->dropped);
+        if (dropped != ring->dropped_reported) {
+            syslog(LOG_WARNING, "%" PRIu32 " log messages dropped.", dropped - ring->dropped_reported);
+            if (np2_stderr_log) {
+                fprintf(stderr, "[WRN]: NP: %" PRIu32 " log messages dropped.\n", dropped - ring->dropped_reported);
             }
-            *buf = mem;
-
-            /* copy preceding message */
-            strncpy(*buf + buf_len, ptr1, ptr2 - ptr1);
-            buf_len += ptr2 - ptr1;
-
-            /* copy % */
-            strcpy(*buf + buf_len, "%%");
-
-            /* next iter */
-            ptr1 = ptr2 + 1;
-        } while ((ptr2 = strchr(ptr1, '%')));
-
-        /* copy remaining message */
-        buf_len = buf_size - 1;
-        buf_size += strlen(ptr1);
-        mem = realloc(*buf, buf_size * sizeof **buf);
-        if (!mem) {
-            EMEM;
-            return "";
+            np2log_async.dropped += dropped - ring->dropped_reported;
+            ring->dropped_reported = dropped;
+        }
+
+        if (dead) {
+            /* all the messages printed, free the ring */
+            *prev = ring->next;
+            free(ring);
+        } else {
+            prev = &ring->next;
         }
-        *buf = mem;
-        strcpy(*buf + buf_len, ptr1);
     }
 
-    return *buf ? *buf : msg;
+    /* UNLOCK */
+    pthread_mutex_unlock(&np2log_async.lock);
+
+    return count;
+}
+
+/**
+ * @brief Logging thread printing the buffered messages, periodically or once a ring reaches its high-water mark.
+ */
+static void *
+np2log_thread(void *UNUSED(arg))
+{
+    struct timespec wake;
+
+    while (ATOMIC_LOAD_ACQUIRE(np2log_async.running)) {
+        if (np2log_flush()) {
+            continue;
+        }
+
+        wake = np_gettimespec();
+        np_addtimespec(&wake, NP2SRV_LOG_FLUSH_INTERVAL);
+
+        /* WAKE LOCK */
+        pthread_mutex_lock(&np2log_async.wake_lock);
+
+        while (!np2log_async.wake && ATOMIC_LOAD_ACQUIRE(np2log_async.running)) {
+            if (pthread_cond_timedwait(&np2log_async.wake_cond, &np2log_async.wake_lock, &wake) == ETIMEDOUT) {
+                break;
+            }
+        }
+        np2log_async.wake = 0;
+
+        /* WAKE UNLOCK */
+        pthread_mutex_unlock(&np2log_async.wake_lock);
+    }
+
+    return NULL;
+}
+
+int
+np2log_async_start(void)
+{
+    pthread_condattr_t attr;
+    int r;
+
+    if ((r = pthread_key_create(&np2log_async.ring_key, np2log_ring_release))) {
+        ERR("Failed to create a thread key (%s).", strerror(r));
+        return -1;
+    }
+
+    /* the logging thread waits on the server clock */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, NP_CLOCK_ID);
+    pthread_cond_init(&np2log_async.wake_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    ATOMIC_STORE_RELEASE(np2log_async.running, 1);
+    if ((r = pthread_create(&np2log_async.tid, NULL, np2log_thread, NULL))) {
+        ATOMIC_STORE_RELEASE(np2log_async.running, 0);
+        pthread_cond_destroy(&np2log_async.wake_cond);
+        pthread_key_delete(np2log_async.ring_key);
+        ERR("Failed to create the logging thread (%s).", strerror(r));
+        return -1;
+    }
+
+    return 0;
+}
+
+void
+np2log_async_stop(void)
+{
+    struct np2log_ring *ring;
+
+    if (!ATOMIC_LOAD_RELAXED(np2log_async.running)) {
+        return;
+    }
+
+    /* print the messages directly from now on */
+    ATOMIC_STORE_RELEASE(np2log_async.running, 0);
+
+    /* WAKE LOCK */
+    pthread_mutex_lock(&np2log_async.wake_lock);
+
+    pthread_cond_signal(&np2log_async.wake_cond);
+
+    /* WAKE UNLOCK */
+    pthread_mutex_unlock(&np2log_async.wake_lock);
+
+    pthread_join(np2log_async.tid, NULL);
+    pthread_cond_destroy(&np2log_async.wake_cond);
+
+    /* print the remaining messages, no thread should be logging into the rings anymore */
+    for (ring = np2log_async.rings; ring; ring = ring->next) {
+        ATOMIC_STORE_RELAXED(ring->dead, 1);
+    }
+    np2log_flush();
+    assert(!np2log_async.rings);
+
+    pthread_key_delete(np2log_async.ring_key);
+}
+
+void
+np2log_metrics(struct np_metrics *m)
+{
+    struct np2log_ring *ring;
+    uint64_t dropped;
+    uint32_t queued = 0;
+
+    /* LOCK */
+    pthread_mutex_lock(&np2log_async.lock);
+
+    for (ring = np2log_async.rings; ring; ring = ring->next) {
+        queued += ATOMIC_LOAD_ACQUIRE(ring->head) - ATOMIC_LOAD_RELAXED(ring->tail);
+    }
+    dropped = np2log_async.dropped;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&np2log_async.lock);
+
+    np_metrics_gauge(m, "log_messages_queued", "Number of log messages waiting to be printed.", queued);
+    np_metrics_counter(m, "log_messages_dropped", "Number of log messages dropped because of a full buffer.", dropped);
+}
+
+/**
+ * @brief Log a message, buffered if the logging thread is running.
+ *
+ * @param[in] priority Syslog priority.
+ * @param[in] src Message source.
+ * @param[in] msg Message to log.
+ * @param[in] path Optional path to append to the message.
+ */
+static void
+np2log(int priority, const char *src, const char *msg, const char *path)
+{
+    struct np2log_ring *ring = NULL;
+    struct np2log_rec *rec;
+    char *str = NULL;
+
+    rec = np2log_rec_get(&ring);
+    if (!rec) {
+        /* synchronous, not truncated */
+        if (path && (asprintf(&str, "%s (%s)", msg, path) > -1)) {
+            msg = str;
+        }
+        np2log_write(priority, src, NULL, msg);
+        free(str);
+    } else if (ring) {
+        rec->priority = priority;
+        rec->src = src;
+        clock_gettime(CLOCK_REALTIME, &rec->time);
+        if (path) {
+            snprintf(rec->msg, sizeof rec->msg, "%s (%s)", msg, path);
+        } else {
+            strncpy(rec->msg, msg, sizeof rec->msg - 1);
+            rec->msg[sizeof rec->msg - 1] = '\0';
+        }
+        np2log_rec_commit(ring);
+    } /* else dropped */
 }
 
 /**
@@ -136,8 +451,6 @@ void
 np2log_cb_nc2(NC_VERB_LEVEL level, const char *msg)
 {
     int priority = LOG_ERR;
-    const char *log_msg;
-    char *buf;
 
     if (level > np2_verbose_level) {
         return;
@@ -159,9 +472,7 @@ np2log_cb_nc2(NC_VERB_LEVEL level, const char *msg)
         break;
     }
 
-    log_msg = np2log_encode(msg, &buf);
-    np2log(priority, "LN", log_msg);
-    free(buf);
+    np2log(priority, "LN", msg, NULL);
 }
 
 /**
@@ -171,8 +482,6 @@ void
 np2log_cb_ly(LY_LOG_LEVEL level, const char *msg, const char *path)
 {
     int priority;
-    const char *log_msg;
-    char *buf;
 
     if (level > np2_verbose_level) {
         return;
@@ -196,21 +505,13 @@ np2log_cb_ly(LY_LOG_LEVEL level, const char *msg, const char *path)
         return;
     }
 
-    if (path) {
-        np2log(priority, "LY", "%s (%s)", msg, path);
-    } else {
-        log_msg = np2log_encode(msg, &buf);
-        np2log(priority, "LY", log_msg);
-        free(buf);
-    }
+    np2log(priority, "LY", msg, path);
 }
 
 void
 np2log_cb_sr(sr_log_level_t level, const char *msg)
 {
     int priority = LOG_ERR;
-    const char *log_msg;
-    char *buf;
 
     if (level > np2_sr_verbose_level) {
         return;
@@ -233,9 +534,57 @@ np2log_cb_sr(sr_log_level_t level, const char *msg)
         return;
     }
 
-    log_msg = np2log_encode(msg, &buf);
-    np2log(priority, "SR", log_msg);
-    free(buf);
+    np2log(priority, "SR", msg, NULL);
+}
+
+/**
+ * @brief Print a formatted message.
+ *
+ * @param[in] level Verbose level.
+ * @param[in] src Message source.
+ * @param[in] format Formatting string.
+ * @param[in] ap Format arguments.
+ */
+static void
+np2log_vprintf(NC_VERB_LEVEL level, const char *src, const char *format, va_list ap)
+{
+    struct np2log_ring *ring = NULL;
+    struct np2log_rec *rec;
+    char *str;
+    int priority = LOG_ERR;
+
+    switch (level) {
+    case NC_VERB_ERROR:
+        priority = LOG_ERR;
+        break;
+    case NC_VERB_WARNING:
+        priority = LOG_WARNING;
+        break;
+    case NC_VERB_VERBOSE:
+        priority = LOG_INFO;
+        break;
+    case NC_VERB_DEBUG:
+    case NC_VERB_DEBUG_LOWLVL:
+        priority = LOG_DEBUG;
+        break;
+    }
+
+    rec = np2log_rec_get(&ring);
+    if (!rec) {
+        /* synchronous, not truncated */
+        if (vasprintf(&str, format, ap) == -1) {
+            return;
+        }
+        np2log_write(priority, src, NULL, str);
+        free(str);
+    } else if (ring) {
+        /* print the message directly into the record */
+        vsnprintf(rec->msg, sizeof rec->msg, format, ap);
+        rec->priority = priority;
+        rec->src = src;
+        clock_gettime(CLOCK_REALTIME, &rec->time);
+        np2log_rec_commit(ring);
+    } /* else dropped */
 }
 
 /**
@@ -246,65 +595,88 @@ np2log_cb_sr(sr_log_level_t level, const char *msg)
 void
 np2log_printf(NC_VERB_LEVEL level, const char *format, ...)
 {
-    va_list ap, ap2;
-    ssize_t msg_len = NP2SRV_MSG_LEN_START, req_len;
-    char *msg, *mem;
-    int priority = LOG_ERR;
+    va_list ap;
 
     if (level > np2_verbose_level) {
         return;
     }
 
     va_start(ap, format);
-    va_copy(ap2, ap);
+    np2log_vprintf(level, "NP", format, ap);
+    va_end(ap);
+}
+
+void
+np2log_sub_printf(enum np2log_sub sub, NC_VERB_LEVEL level, const char *format, ...)
+{
+    va_list ap;
 
-    /* initial length */
-    msg = malloc(msg_len);
-    if (!msg) {
-        goto cleanup;
+    va_start(ap, format);
+    np2log_vprintf(level, np2log_sub_src[sub], format, ap);
+    va_end(ap);
+}
+
+/* /netopeer2-server:logging/subsystem */
+int
+np2log_subsystem_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
+        const char *xpath, sr_event_t UNUSED(event), uint32_t UNUSED(request_id), void *UNUSED(private_data))
+{
+    sr_change_iter_t *iter;
+    sr_change_oper_t op;
+    const struct lyd_node *node;
+    const char *name, *level;
+    uint32_t i;
+    char *xpath2;
+    int rc;
+
+    if (asprintf(&xpath2, "%s/verbose-level", xpath) == -1) {
+        EMEM;
+        return SR_ERR_NO_MEMORY;
+    }
+    rc = sr_get_changes_iter(session, xpath2, &iter);
+    free(xpath2);
+    if (rc != SR_ERR_OK) {
+        ERR("Getting changes iter failed (%s).", sr_strerror(rc));
+        return rc;
     }
 
-    /* learn how much bytes are needed */
-    req_len = vsnprintf(msg, msg_len, format, ap);
-    if (req_len == -1) {
-        goto cleanup;
-    } else if (req_len >= NP2SRV_MSG_LEN_START) {
-        /* the intial size was not enough */
-        msg_len = req_len + 1;
-        mem = realloc(msg, msg_len);
-        if (!mem) {
-            free(msg);
-            goto cleanup;
+    while ((rc = sr_get_change_tree_next(session, iter, &op, &node, NULL, NULL, NULL)) == SR_ERR_OK) {
+        /* learn the subsystem, key must be present */
+        assert(!strcmp(lyd_child(lyd_parent(node))->schema->name, "name"));
+        name = lyd_get_value(lyd_child(lyd_parent(node)));
+        for (i = 0; i < NP2LOG_SUB_COUNT; ++i) {
+            if (!strcmp(np2log_sub_name[i], name)) {
+                break;
+            }
+        }
+        if (i == NP2LOG_SUB_COUNT) {
+            EINT;
+            continue;
         }
-        msg = mem;
 
-        /* now print the full message */
-        req_len = vsnprintf(msg, msg_len, format, ap2);
-        if (req_len == -1) {
-            goto cleanup;
+        if (op == SR_OP_DELETED) {
+            /* only the global verbose level applies */
+            np2_sub_verbose_level[i] = NC_VERB_ERROR;
+            continue;
         }
-    }
 
-    switch (level) {
-    case NC_VERB_ERROR:
-        priority = LOG_ERR;
-        break;
-    case NC_VERB_WARNING:
-        priority = LOG_WARNING;
-        break;
-    case NC_VERB_VERBOSE:
-        priority = LOG_INFO;
-        break;
-    case NC_VERB_DEBUG:
-    case NC_VERB_DEBUG_LOWLVL:
-        priority = LOG_DEBUG;
-        break;
+        level = lyd_get_value(node);
+        if (!strcmp(level, "error")) {
+            np2_sub_verbose_level[i] = NC_VERB_ERROR;
+        } else if (!strcmp(level, "warning")) {
+            np2_sub_verbose_level[i] = NC_VERB_WARNING;
+        } else if (!strcmp(level, "verbose")) {
+            np2_sub_verbose_level[i] = NC_VERB_VERBOSE;
+        } else {
+            assert(!strcmp(level, "debug"));
+            np2_sub_verbose_level[i] = NC_VERB_DEBUG;
+        }
+    }
+    sr_free_change_iter(iter);
+    if (rc != SR_ERR_NOT_FOUND) {
+        ERR("Getting next change failed (%s).", sr_strerror(rc));
+        return rc;
     }
-    /* no need to encode in this case */
-    np2log(priority, "NP", msg);
 
-cleanup:
-    free(msg);
-    va_end(ap);
-    va_end(ap2);
+    return SR_ERR_OK;
 }
@@ -18,11 +18,33 @@
 #include <nc_server.h>
 #include <sysrepo.h>
 
+#include "metrics.h"
+
 /**
  * @brief Verbose level variable
  */
 extern volatile uint8_t np2_verbose_level;
 
+/**
+ * @brief Server subsystems with separate verbose levels.
+ */
+enum np2log_sub {
+    NP2LOG_NACM = 0,    /**< NETCONF access control */
+    NP2LOG_SUB_NTF,     /**< subscribed notifications */
+    NP2LOG_YANG_PUSH,   /**< yang-push subscriptions */
+    NP2LOG_SESSION,     /**< NETCONF sessions */
+    NP2LOG_TRANSPORT,   /**< SSH and TLS transport */
+    NP2LOG_URL,         /**< URL capability */
+    NP2LOG_STATS,       /**< RPC statistics */
+
+    NP2LOG_SUB_COUNT    /**< number of subsystems */
+};
+
+/**
+ * @brief Subsystem verbose level variables, messages are printed if within this or the global verbose level.
+ */
+extern volatile uint8_t np2_sub_verbose_level[NP2LOG_SUB_COUNT];
+
 /**
  * @brief libssh verbose level variable
  */
@@ -38,6 +60,25 @@ extern uint8_t np2_sr_verbose_level;
  */
 extern uint8_t np2_stderr_log;
 
+/**
+ * @brief Start the logging thread, messages are buffered and printed asynchronously from now on.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int np2log_async_start(void);
+
+/**
+ * @brief Print all the buffered messages and stop the logging thread, messages are printed directly from now on.
+ */
+void np2log_async_stop(void);
+
+/**
+ * @brief Print the logging queue depth as metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void np2log_metrics(struct np_metrics *m);
+
 /**
  * @brief internal printing function, follows the levels from libnetconf2
  * @param[in] level Verbose level
@@ -45,6 +86,14 @@ extern uint8_t np2_stderr_log;
  */
 void np2log_printf(NC_VERB_LEVEL level, const char *format, ...);
 
+/**
+ * @brief Internal printing function of a subsystem message, the verbose level is expected to be checked.
+ * @param[in] sub Subsystem of the message.
+ * @param[in] level Verbose level
+ * @param[in] format Formatting string
+ */
+void np2log_sub_printf(enum np2log_sub sub, NC_VERB_LEVEL level, const char *format, ...);
+
 /*
  * Verbose printing macros
  */
@@ -53,6 +102,23 @@ void np2log_printf(NC_VERB_LEVEL level, const char *format, ...);
 #define VRB(format, args ...) np2log_printf(NC_VERB_VERBOSE,format,##args)
 #define DBG(format, args ...) np2log_printf(NC_VERB_DEBUG,format,##args)
 
+/*
+ * Subsystem printing macros, the arguments are not evaluated if the message is not printed
+ */
+#define NP2LOG_ENABLED(sub, level) (((level) <= np2_verbose_level) || ((level) <= np2_sub_verbose_level[sub]))
+#define SUB_VRB(sub, format, args ...) \
+    do { \
+        if (NP2LOG_ENABLED(sub, NC_VERB_VERBOSE)) { \
+            np2log_sub_printf(sub, NC_VERB_VERBOSE, format, ##args); \
+        } \
+    } while (0)
+#define SUB_DBG(sub, format, args ...) \
+    do { \
+        if (NP2LOG_ENABLED(sub, NC_VERB_DEBUG)) { \
+            np2log_sub_printf(sub, NC_VERB_DEBUG, format, ##args); \
+        } \
+    } while (0)
+
 #define EMEM ERR("Memory allocation failed (%s:%d)", __FILE__, __LINE__)
 #define EINT ERR("Internal error (%s:%d)", __FILE__, __LINE__)
 
@@ -71,4 +137,10 @@ void np2log_cb_ly(LY_LOG_LEVEL level, const char *msg, const char *path);
  */
 void np2log_cb_sr(sr_log_level_t level, const char *msg);
 
+/**
+ * @brief Callback for subsystem verbose level changes.
+ */
+int np2log_subsystem_cb(sr_session_ctx_t *session, uint32_t sub_id, const char *module_name, const char *xpath,
+        sr_event_t event, uint32_t request_id, void *private_data);
+
 #endif /* NP2SRV_LOG_H_ */
@@ -34,8 +34,12 @@
 #include "common.h"
 #include "compat.h"
 #include "config.h"
+#include "config_cache.h"
+#include "data_fetch.h"
 #include "err_netconf.h"
+#include "filter_cache.h"
 #include "log.h"
+#include "metrics.h"
 #include "netconf.h"
 #if defined (NC_ENABLED_SSH) || defined (NC_ENABLED_TLS)
 # include "netconf_server.h"
@@ -50,6 +54,9 @@
 #include "netconf_monitoring.h"
 #include "netconf_nmda.h"
 #include "netconf_subscribed_notifications.h"
+#include "oper_cache.h"
+#include "stats.h"
+#include "timer_wheel.h"
 #include "yang_push.h"
 
 /** @brief flag for main loop */
@@ -58,6 +65,9 @@ ATOMIC_T loop_continue = 1;
 /* NETCONF SID of session to skip diff check for */
 ATOMIC_T skip_nacm_nc_sid;
 
+/** @brief flag for printing RPC statistics */
+ATOMIC_T stats_print;
+
 static void *worker_thread(void *arg);
 
 /**
@@ -84,6 +94,10 @@ signal_handler(int sig)
         }
         ATOMIC_STORE_RELAXED(loop_continue, 0);
         break;
+    case SIGUSR1:
+        /* print RPC statistics */
+        ATOMIC_STORE_RELAXED(stats_print, 1);
+        break;
     default:
         exit(EXIT_FAILURE);
     }
@@ -98,6 +112,9 @@ np2srv_del_session_cb(struct nc_session *session)
     struct np2_user_sess *user_sess;
     const struct lys_module *mod;
 
+    /* callbacks will no longer find the session */
+    np_sess_map_del(session);
+
     if (nc_ps_del_session(np2srv.nc_ps, session)) {
         ERR("Removing session from ps failed.");
     }
@@ -109,6 +126,9 @@ np2srv_del_session_cb(struct nc_session *session)
     user_sess = nc_session_get_data(session);
     sr_session_unsubscribe(user_sess->sess);
 
+    /* stop monitoring, the counters are freed with the user session */
+    ncm_session_del(session);
+
     /* stop sysrepo session, if no callback is using it */
     np_release_user_sess(user_sess);
 
@@ -160,131 +180,228 @@ np2srv_del_session_cb(struct nc_session *session)
         if (rc != SR_ERR_OK) {
             WRN("Failed to send a notification (%s).", sr_strerror(rc));
         } else {
-            VRB("Generated new event (netconf-session-end).");
+            SUB_VRB(NP2LOG_SESSION, "Generated new event (netconf-session-end).");
         }
         free(event_data);
     }
 
-    /* stop monitoring and free NC session */
-    ncm_session_del(session);
+    /* free NC session */
     nc_session_free(session, NULL);
 }
 
-static struct lyd_node *
-np2srv_err_nc(sr_error_info_err_t *err)
+/**
+ * @brief Built-in RPC whose callback can be called directly instead of through sysrepo.
+ */
+struct np2srv_rpc_direct {
+    const char *path;   /* RPC path */
+    sr_rpc_tree_cb cb;  /* RPC callback */
+    ATOMIC_T direct;    /* set if the server is the only subscriber of the RPC */
+};
+
+/**
+ * @brief RPCs that may be called directly, only those working the same way without a sysrepo event session.
+ */
+static struct np2srv_rpc_direct rpc_direct[] = {
+    {"/ietf-netconf:get-config", np2srv_rpc_get_cb, 0},
+    {"/ietf-netconf:get", np2srv_rpc_get_cb, 0},
+    {"/ietf-netconf:edit-config", np2srv_rpc_editconfig_cb, 0},
+    {"/ietf-netconf:lock", np2srv_rpc_un_lock_cb, 0},
+    {"/ietf-netconf:unlock", np2srv_rpc_un_lock_cb, 0},
+    {"/ietf-netconf-nmda:get-data", np2srv_rpc_getdata_cb, 0},
+    {"/ietf-netconf-nmda:edit-data", np2srv_rpc_editdata_cb, 0},
+};
+
+/* timer periodically learning the RPCs that can be called directly, and its session */
+static struct np_timer rpc_direct_timer;
+static sr_session_ctx_t *rpc_direct_sess;
+
+#ifdef NP2SRV_RPC_DIRECT
+
+/**
+ * @brief Timer callback learning whether there are any other subscribers of the direct RPCs.
+ *
+ * Until the next check, an RPC is still called directly even if another subscriber has meanwhile subscribed to it.
+ */
+static void
+np2srv_rpc_direct_timer_cb(void *UNUSED(arg))
 {
-    struct lyd_node *e = NULL, *err_info = NULL;
-    const char *err_type, *err_tag, *err_msg, *str, *str2;
-    uint32_t err_idx;
-
-    /* mandatory */
-    err_idx = 0;
-    if (sr_get_error_data(err, err_idx++, NULL, (const void **)&err_type)) {
-        WRN("Missing NETCONF error \"error-type\".");
-        goto error;
-    } else if (sr_get_error_data(err, err_idx++, NULL, (const void **)&err_tag)) {
-        WRN("Missing NETCONF error \"error-tag\".");
-        goto error;
-    } else if (sr_get_error_data(err, err_idx++, NULL, (const void **)&err_msg)) {
-        WRN("Missing NETCONF error \"error-message\".");
-        goto error;
-    }
-    /* rpc-error */
-    if (lyd_new_opaq2(NULL, sr_get_context(np2srv.sr_conn), "rpc-error", NULL, NULL, NC_NS_BASE, &e)) {
-        goto error;
-    }
-    /* error-type */
-    if (lyd_new_opaq2(e, NULL, "error-type", err_type, NULL, NC_NS_BASE, NULL)) {
-        goto error;
-    }
-    /* error-tag */
-    if (lyd_new_opaq2(e, NULL, "error-tag", err_tag, NULL, NC_NS_BASE, NULL)) {
-        goto error;
-    }
-    /* error-severity */
-    if (lyd_new_opaq2(e, NULL, "error-severity", "error", NULL, NC_NS_BASE, NULL)) {
-        goto error;
+    struct lyd_node *data = NULL;
+    struct ly_set *set = NULL;
+    char *xpath;
+    uint32_t i, direct;
+    int rc;
+
+    /* get all the RPC subscriptions */
+    rc = sr_get_data(rpc_direct_sess, "/sysrepo-monitoring:sysrepo-state/rpc", 0, np2srv.sr_timeout, 0, &data);
+    if (rc) {
+        WRN("Getting RPC subscriptions failed (%s).", sr_strerror(rc));
     }
-    /* error-message */
-    if (nc_err_set_msg(e, err_msg, "en")) {
-        goto error;
+
+    for (i = 0; i < sizeof rpc_direct / sizeof *rpc_direct; ++i) {
+        direct = 0;
+        if (!rc && (asprintf(&xpath, "/sysrepo-monitoring:sysrepo-state/rpc[path='%s']/rpc-sub",
+                rpc_direct[i].path) > -1)) {
+            /* only the server subscription */
+            if (!lyd_find_xpath(data, xpath, &set) && (set->count == 1)) {
+                direct = 1;
+            }
+            ly_set_free(set, NULL);
+            set = NULL;
+            free(xpath);
+        }
+
+        if (ATOMIC_LOAD_RELAXED(rpc_direct[i].direct) != direct) {
+            VRB("RPC \"%s\" will be %s.", rpc_direct[i].path, direct ? "called directly" : "sent to sysrepo");
+            ATOMIC_STORE_RELAXED(rpc_direct[i].direct, direct);
+        }
     }
 
-    /* error-app-tag */
-    if (sr_get_error_data(err, err_idx++, NULL, (const void **)&str)) {
-        return e;
+    lyd_free_siblings(data);
+}
+
+/**
+ * @brief Start periodically learning the RPCs that can be called directly.
+ *
+ * @return 0 on success, -1 on error.
+ */
+static int
+np2srv_rpc_direct_init(void)
+{
+    int rc;
+
+    /* the subscriptions are operational data */
+    rc = sr_session_start(np2srv.sr_conn, SR_DS_OPERATIONAL, &rpc_direct_sess);
+    if (rc != SR_ERR_OK) {
+        ERR("Creating a sysrepo session failed (%s).", sr_strerror(rc));
+        return -1;
     }
-    if (str[0]) {
-        if (nc_err_set_app_tag(e, str)) {
-            goto error;
-        }
+
+    np_timer_init(&rpc_direct_timer, np2srv_rpc_direct_timer_cb, NULL);
+    np_timer_set(&rpc_direct_timer, np_gettimespec(), NP2SRV_RPC_DIRECT_CHECK_INTERVAL);
+    return 0;
+}
+
+#endif
+
+/**
+ * @brief Stop calling any RPCs directly.
+ */
+static void
+np2srv_rpc_direct_destroy(void)
+{
+    uint32_t i;
+
+    /* the session is stopped on disconnect, after the timer threads are */
+    if (rpc_direct_sess) {
+        np_timer_disarm(&rpc_direct_timer);
     }
-    /* error-path */
-    if (sr_get_error_data(err, err_idx++, NULL, (const void **)&str)) {
-        return e;
+
+    for (i = 0; i < sizeof rpc_direct / sizeof *rpc_direct; ++i) {
+        ATOMIC_STORE_RELAXED(rpc_direct[i].direct, 0);
     }
-    if (str[0]) {
-        if (nc_err_set_path(e, str)) {
-            goto error;
-        }
+}
+
+/**
+ * @brief Find the direct RPC of an RPC.
+ *
+ * @param[in] rpc RPC to find.
+ * @return Direct RPC, NULL if the RPC must be sent to sysrepo.
+ */
+static const struct np2srv_rpc_direct *
+np2srv_rpc_direct_find(const struct lyd_node *rpc)
+{
+    char path[128];
+    uint32_t i;
+
+    if (rpc->schema->nodetype != LYS_RPC) {
+        /* actions are never direct */
+        return NULL;
     }
-    /* error-info */
-    while (!sr_get_error_data(err, err_idx++, NULL, (const void **)&str) &&
-            !sr_get_error_data(err, err_idx++, NULL, (const void **)&str2)) {
-        if (!err_info) {
-            if (lyd_new_opaq2(e, NULL, "error-info", NULL, NULL, NC_NS_BASE, &err_info)) {
-                goto error;
-            }
-        }
-        if (lyd_new_opaq2(err_info, NULL, str, str2, NULL, NC_NS_BASE, NULL)) {
-            goto error;
+
+    snprintf(path, sizeof path, "/%s:%s", rpc->schema->module->name, LYD_NAME(rpc));
+    for (i = 0; i < sizeof rpc_direct / sizeof *rpc_direct; ++i) {
+        if (!strcmp(rpc_direct[i].path, path)) {
+            return ATOMIC_LOAD_RELAXED(rpc_direct[i].direct) ? &rpc_direct[i] : NULL;
         }
     }
 
-    return e;
-
-error:
-    lyd_free_tree(e);
     return NULL;
 }
 
+/**
+ * @brief Create an error reply with a generic error.
+ *
+ * @param[in] msg Error message.
+ * @return Error reply.
+ */
 static struct nc_server_reply *
-np2srv_err_reply_sr(const sr_error_info_t *err_info)
+np2srv_err_reply_msg(const char *msg)
 {
-    struct nc_server_reply *reply = NULL;
     struct lyd_node *e;
-    size_t i;
-
-    /* try to find a NETCONF error */
-    for (i = 0; i < err_info->err_count; ++i) {
-        if (err_info->err[i].error_format && !strcmp(err_info->err[i].error_format, "NETCONF")) {
-            /* NETCONF error */
-            e = np2srv_err_nc(&err_info->err[i]);
-            if (e) {
-                reply = nc_server_reply_err(e);
-            }
-            break;
-        }
+
+    e = nc_err(sr_get_context(np2srv.sr_conn), NC_ERR_OP_FAILED, NC_ERR_TYPE_APP);
+    nc_err_set_msg(e, msg, "en");
+    return nc_server_reply_err(e);
+}
+
+/**
+ * @brief Call an RPC callback directly, the same way sysrepo would call it.
+ *
+ * @param[in] rd Direct RPC.
+ * @param[in] user_sess User session of the NETCONF session, used instead of the event session.
+ * @param[in] rpc RPC to execute, its input default values are added.
+ * @param[out] output RPC output on success.
+ * @return Error reply, NULL on success.
+ */
+static struct nc_server_reply *
+np2srv_rpc_direct_send(const struct np2srv_rpc_direct *rd, struct np2_user_sess *user_sess, struct lyd_node *rpc,
+        struct lyd_node **output)
+{
+    struct np_err_direct direct;
+    struct nc_server_reply *reply;
+    int rc;
+
+    *output = NULL;
+
+    /* validate the input, which adds default values, as sysrepo does */
+    if (lyd_validate_op(rpc, NULL, LYD_TYPE_RPC_YANG, NULL)) {
+        return np2srv_err_reply_msg(ly_errmsg(LYD_CTX(rpc)));
     }
 
-    if (reply) {
-        /* return just the NETCONF error */
-        return reply;
+    /* output is created in the operation node */
+    if (lyd_dup_single(rpc, NULL, 0, output)) {
+        return np2srv_err_reply_msg(ly_errmsg(LYD_CTX(rpc)));
     }
 
-    for (i = 0; i < err_info->err_count; ++i) {
-        /* generic error */
-        e = nc_err(sr_get_context(np2srv.sr_conn), NC_ERR_OP_FAILED, NC_ERR_TYPE_APP);
-        nc_err_set_msg(e, err_info->err[i].message, "en");
+    /* call the callback, it sets the errors to the direct errors instead of the event session */
+    np_err_direct_start(&direct);
+    rc = rd->cb(user_sess->sess, 0, rd->path, rpc, SR_EV_RPC, 0, *output, NULL);
+    reply = np_err_direct_end(&direct);
 
-        if (reply) {
-            nc_server_reply_add_err(reply, e);
-        } else {
-            reply = nc_server_reply_err(e);
+    /* the callback finished its statistics, continue with those of the RPC */
+    np_stats_rpc_set(rd->path + 1);
+
+    if (rc) {
+        ERR("Failed to execute an RPC (%s).", sr_strerror(rc));
+        if (!reply) {
+            reply = np2srv_err_reply_msg(sr_strerror(rc));
         }
-        e = NULL;
+        goto error;
+    }
+    nc_server_reply_free(reply);
+    reply = NULL;
+
+    /* validate the output, which adds default values, as sysrepo does */
+    if (lyd_validate_op(*output, NULL, LYD_TYPE_REPLY_YANG, NULL)) {
+        reply = np2srv_err_reply_msg(ly_errmsg(LYD_CTX(rpc)));
+        goto error;
     }
 
+    return NULL;
+
+error:
+    lyd_free_tree(*output);
+    *output = NULL;
     return reply;
 }
 
@@ -295,6 +412,7 @@ static struct nc_server_reply *
 np2srv_rpc_cb(struct lyd_node *rpc, struct nc_session *ncs)
 {
     struct np2_user_sess *user_sess;
+    const struct np2srv_rpc_direct *rd;
     const struct lyd_node *denied;
     struct lyd_node *node;
     const sr_error_info_t *err_info;
@@ -302,11 +420,17 @@ np2srv_rpc_cb(struct lyd_node *rpc, struct nc_session *ncs)
     struct lyd_node *output, *child = NULL;
     NC_WD_MODE nc_wd;
     struct lyd_node *e;
+    struct timespec start;
     char *str;
     int rc;
 
+    np_stats_rpc_begin(rpc);
+
     /* check NACM */
-    if ((denied = ncac_check_operation(rpc, nc_session_get_username(ncs)))) {
+    np_stats_stage_start(&start);
+    denied = ncac_check_operation(rpc, nc_session_get_username(ncs));
+    np_stats_stage_end(NP_STATS_NACM, &start);
+    if (denied) {
         e = nc_err(LYD_CTX(rpc), NC_ERR_ACCESS_DENIED, NC_ERR_TYPE_APP);
 
         /* set path */
@@ -319,20 +443,35 @@ np2srv_rpc_cb(struct lyd_node *rpc, struct nc_session *ncs)
         nc_err_set_msg(e, str, "en");
         free(str);
 
+        np_stats_rpc_end();
         return nc_server_reply_err(e);
     }
 
     /* get this user session with its originator data, no need to use ref-count */
     user_sess = nc_session_get_data(ncs);
 
-    /* sysrepo API, use the default timeout or slightly higher than the configured one */
-    rc = sr_rpc_send_tree(user_sess->sess, rpc, np2srv.sr_timeout ? np2srv.sr_timeout + 2000 : 0, &output);
-    if (rc) {
-        ERR("Failed to send an RPC (%s).", sr_strerror(rc));
-
-        /* build proper error */
-        sr_session_get_error(user_sess->sess, &err_info);
-        return np2srv_err_reply_sr(err_info);
+    if ((rd = np2srv_rpc_direct_find(rpc))) {
+        /* no other subscribers, call the callback without sysrepo */
+        np_stats_stage_start(&start);
+        reply = np2srv_rpc_direct_send(rd, user_sess, rpc, &output);
+        np_stats_stage_end(NP_STATS_EXEC, &start);
+        if (reply) {
+            np_stats_rpc_end();
+            return reply;
+        }
+    } else {
+        /* sysrepo API, use the default timeout or slightly higher than the configured one */
+        np_stats_stage_start(&start);
+        rc = sr_rpc_send_tree(user_sess->sess, rpc, np2srv.sr_timeout ? np2srv.sr_timeout + 2000 : 0, &output);
+        np_stats_stage_end(NP_STATS_EXEC, &start);
+        if (rc) {
+            ERR("Failed to send an RPC (%s).", sr_strerror(rc));
+
+            /* build proper error */
+            sr_session_get_error(user_sess->sess, &err_info);
+            np_stats_rpc_end();
+            return np_err_reply_sr(err_info);
+        }
     }
 
     /* build RPC Reply */
@@ -375,6 +514,7 @@ np2srv_rpc_cb(struct lyd_node *rpc, struct nc_session *ncs)
         reply = nc_server_reply_ok();
     }
 
+    np_stats_rpc_end();
     return reply;
 }
 
@@ -468,6 +608,14 @@ np2srv_check_schemas(sr_session_ctx_t *sr_sess)
     NP2_CHECK_FEATURE("ssh-listen");
     NP2_CHECK_FEATURE("ssh-call-home");
 
+    /* .. netopeer2-yang-push */
+    mod_name = "netopeer2-yang-push";
+    NP2_CHECK_MODULE(mod_name);
+
+    /* .. netopeer2-server */
+    mod_name = "netopeer2-server";
+    NP2_CHECK_MODULE(mod_name);
+
     return 0;
 }
 
@@ -519,6 +667,16 @@ server_init(void)
     /* init NACM */
     ncac_init();
 
+    /* init yang-push timers */
+    if (np2srv_timer_wheel_init()) {
+        goto error;
+    }
+
+    /* init parallel data retrieval */
+    if (np_data_fetch_init()) {
+        goto error;
+    }
+
     /* init libnetconf2 (it modifies only the dictionary) */
     if (nc_server_init((struct ly_ctx *)ly_ctx)) {
         goto error;
@@ -580,11 +738,25 @@ static void
 server_destroy(void)
 {
     struct nc_session *sess;
+    uint32_t i;
+
+    /* stop the metrics exporter, it reads all the counters */
+    np2srv_metrics_destroy();
+
+    /* send all the RPCs to sysrepo */
+    np2srv_rpc_direct_destroy();
 
     /* stop subscriptions */
-    sr_unsubscribe(np2srv.sr_rpc_sub);
+    for (i = 0; i < NP_RPC_SUB_COUNT; ++i) {
+        sr_unsubscribe(np2srv.sr_rpc_sub[i]);
+    }
     sr_unsubscribe(np2srv.sr_data_sub);
-    sr_unsubscribe(np2srv.sr_notif_sub);
+    for (i = 0; i < NP2SRV_NOTIF_THREAD_COUNT; ++i) {
+        sr_unsubscribe(np2srv.sr_notif_sub[i]);
+    }
+    for (i = 0; i < NP2SRV_YANG_PUSH_THREAD_COUNT; ++i) {
+        sr_unsubscribe(np2srv.sr_yp_sub[i]);
+    }
 
 #if defined (NC_ENABLED_SSH) || defined (NC_ENABLED_TLS)
     /* remove all CH clients so they do not reconnect */
@@ -600,6 +772,7 @@ server_destroy(void)
         }
         nc_ps_free(np2srv.nc_ps);
     }
+    np_sess_map_destroy();
 
     /* libnetconf2 cleanup */
     nc_server_destroy();
@@ -612,14 +785,35 @@ server_destroy(void)
     /* monitoring cleanup */
     ncm_destroy();
 
+    /* get-config reply cache cleanup */
+    np_cfg_cache_destroy();
+
+    /* operational data cache cleanup */
+    np_oper_cache_destroy();
+
+    /* compiled filter cache cleanup */
+    np_filter_cache_destroy();
+
+    /* parallel data retrieval workers cleanup */
+    np_data_fetch_destroy();
+
+    /* module index cleanup */
+    np_mod_idx_destroy();
+
     /* NACM cleanup */
     ncac_destroy();
 
     /* ietf-subscribed-notifications cleanup */
     np2srv_sub_ntf_destroy();
 
+    /* timer wheel cleanup */
+    np2srv_timer_wheel_destroy();
+
     /* removes the context and clears all the sessions */
     sr_disconnect(np2srv.sr_conn);
+
+    /* RPC statistics cleanup */
+    np2srv_stats_destroy();
 }
 
 #if defined (NC_ENABLED_SSH) || defined (NC_ENABLED_TLS)
@@ -637,47 +831,63 @@ static int
 server_rpc_subscribe(void)
 {
     int rc;
+    uint32_t i, read_idx = 0;
 
-#define SR_RPC_SUBSCR(xpath, cb) \
-    rc = sr_rpc_subscribe_tree(np2srv.sr_sess, xpath, cb, NULL, 0, SR_SUBSCR_CTX_REUSE, &np2srv.sr_rpc_sub); \
+#define SR_RPC_SUBSCR(xpath, cb, sub_idx) \
+    rc = sr_rpc_subscribe_tree(np2srv.sr_sess, xpath, cb, NULL, 0, SR_SUBSCR_CTX_REUSE, &np2srv.sr_rpc_sub[sub_idx]); \
     if (rc != SR_ERR_OK) { \
         ERR("Subscribing for \"%s\" RPC failed (%s).", xpath, sr_strerror(rc)); \
         goto error; \
     }
 
-    /* subscribe to standard supported RPCs */
-    if (np2srv.sr_rpc_sub) {
-        EINT;
-        goto error;
+/* read RPCs are spread among all the read contexts */
+#define SR_RPC_SUBSCR_READ(xpath, cb) \
+    SR_RPC_SUBSCR(xpath, cb, NP_RPC_SUB_READ + read_idx); \
+    read_idx = (read_idx + 1) % NP2SRV_RPC_READ_THREAD_COUNT
+
+    for (i = 0; i < NP_RPC_SUB_COUNT; ++i) {
+        if (np2srv.sr_rpc_sub[i]) {
+            EINT;
+            goto error;
+        }
     }
-    SR_RPC_SUBSCR("/ietf-netconf:get-config", np2srv_rpc_get_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:edit-config", np2srv_rpc_editconfig_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:copy-config", np2srv_rpc_copyconfig_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:delete-config", np2srv_rpc_deleteconfig_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:lock", np2srv_rpc_un_lock_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:unlock", np2srv_rpc_un_lock_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:get", np2srv_rpc_get_cb);
+
+    /* subscribe to standard supported RPCs */
+    SR_RPC_SUBSCR_READ("/ietf-netconf:get-config", np2srv_rpc_get_cb);
+    SR_RPC_SUBSCR("/ietf-netconf:edit-config", np2srv_rpc_editconfig_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR("/ietf-netconf:copy-config", np2srv_rpc_copyconfig_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR("/ietf-netconf:delete-config", np2srv_rpc_deleteconfig_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR("/ietf-netconf:lock", np2srv_rpc_un_lock_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR("/ietf-netconf:unlock", np2srv_rpc_un_lock_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR_READ("/ietf-netconf:get", np2srv_rpc_get_cb);
     /* keep close-session empty so that internal lnc2 callback is used */
-    SR_RPC_SUBSCR("/ietf-netconf:kill-session", np2srv_rpc_kill_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:commit", np2srv_rpc_commit_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:discard-changes", np2srv_rpc_discard_cb);
-    SR_RPC_SUBSCR("/ietf-netconf:validate", np2srv_rpc_validate_cb);
+    SR_RPC_SUBSCR("/ietf-netconf:kill-session", np2srv_rpc_kill_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR("/ietf-netconf:commit", np2srv_rpc_commit_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR("/ietf-netconf:discard-changes", np2srv_rpc_discard_cb, NP_RPC_SUB_WRITE);
+    SR_RPC_SUBSCR("/ietf-netconf:validate", np2srv_rpc_validate_cb, NP_RPC_SUB_WRITE);
 
     /* subscribe to create-subscription */
-    SR_RPC_SUBSCR("/notifications:create-subscription", np2srv_rpc_subscribe_cb);
+    SR_RPC_SUBSCR("/notifications:create-subscription", np2srv_rpc_subscribe_cb, NP_RPC_SUB_NTF);
 
     /* subscribe to NMDA RPCs */
-    SR_RPC_SUBSCR("/ietf-netconf-nmda:get-data", np2srv_rpc_getdata_cb);
-    SR_RPC_SUBSCR("/ietf-netconf-nmda:edit-data", np2srv_rpc_editdata_cb);
+    SR_RPC_SUBSCR_READ("/ietf-netconf-nmda:get-data", np2srv_rpc_getdata_cb);
+    SR_RPC_SUBSCR("/ietf-netconf-nmda:edit-data", np2srv_rpc_editdata_cb, NP_RPC_SUB_WRITE);
 
     /* subscribe to ietf-subscribed-notifications RPCs */
-    SR_RPC_SUBSCR("/ietf-subscribed-notifications:establish-subscription", np2srv_rpc_establish_sub_cb);
-    SR_RPC_SUBSCR("/ietf-subscribed-notifications:modify-subscription", np2srv_rpc_modify_sub_cb);
-    SR_RPC_SUBSCR("/ietf-subscribed-notifications:delete-subscription", np2srv_rpc_delete_sub_cb);
-    SR_RPC_SUBSCR("/ietf-subscribed-notifications:kill-subscription", np2srv_rpc_kill_sub_cb);
+    SR_RPC_SUBSCR("/ietf-subscribed-notifications:establish-subscription", np2srv_rpc_establish_sub_cb, NP_RPC_SUB_NTF);
+    SR_RPC_SUBSCR("/ietf-subscribed-notifications:modify-subscription", np2srv_rpc_modify_sub_cb, NP_RPC_SUB_NTF);
+    SR_RPC_SUBSCR("/ietf-subscribed-notifications:delete-subscription", np2srv_rpc_delete_sub_cb, NP_RPC_SUB_NTF);
+    SR_RPC_SUBSCR("/ietf-subscribed-notifications:kill-subscription", np2srv_rpc_kill_sub_cb, NP_RPC_SUB_NTF);
 
     /* one more yang-push RPC */
-    SR_RPC_SUBSCR("/ietf-yang-push:resync-subscription", np2srv_rpc_resync_sub_cb);
+    SR_RPC_SUBSCR("/ietf-yang-push:resync-subscription", np2srv_rpc_resync_sub_cb, NP_RPC_SUB_NTF);
+
+#ifdef NP2SRV_RPC_DIRECT
+    /* learn the RPCs without other subscribers, which can be called directly */
+    if (np2srv_rpc_direct_init()) {
+        goto error;
+    }
+#endif
 
     return 0;
 
@@ -870,6 +1080,15 @@ server_data_subscribe(void)
     xpath = "/ietf-netconf-acm:nacm/denied-notifications";
     SR_OPER_SUBSCR(mod_name, xpath, ncac_oper_cb);
 
+    /*
+     * netopeer2-server
+     */
+    mod_name = "netopeer2-server";
+    xpath = "/netopeer2-server:logging/subsystem";
+    SR_CONFIG_SUBSCR(mod_name, xpath, np2log_subsystem_cb);
+
+    SR_OPER_SUBSCR(mod_name, "/netopeer2-server:rpc-statistics", np2srv_stats_oper_cb);
+
     return 0;
 
 error:
@@ -889,6 +1108,12 @@ worker_thread(void *arg)
 #endif
 
     while (ATOMIC_LOAD_RELAXED(loop_continue)) {
+        if (!idx && ATOMIC_LOAD_RELAXED(stats_print)) {
+            /* SIGUSR1 received, only the first thread prints the statistics */
+            ATOMIC_STORE_RELAXED(stats_print, 0);
+            np_stats_print();
+        }
+
         /* try to accept new NETCONF sessions */
         if (nc_server_endpt_count()) {
             msgtype = nc_accept(0, &ncs);
@@ -912,24 +1137,25 @@ worker_thread(void *arg)
         /* process the result of nc_ps_poll(), increase counters */
         if (rc & NC_PSPOLL_BAD_RPC) {
             ncm_session_bad_rpc(ncs);
-            VRB("Session %d: thread %d event bad RPC.", nc_session_get_id(ncs), idx);
+            SUB_VRB(NP2LOG_SESSION, "Session %d: thread %d event bad RPC.", nc_session_get_id(ncs), idx);
         }
         if (rc & NC_PSPOLL_RPC) {
+            np_stats_rpc_replied();
             ncm_session_rpc(ncs);
-            VRB("Session %d: thread %d event new RPC.", nc_session_get_id(ncs), idx);
+            SUB_VRB(NP2LOG_SESSION, "Session %d: thread %d event new RPC.", nc_session_get_id(ncs), idx);
         }
         if (rc & NC_PSPOLL_REPLY_ERROR) {
             ncm_session_rpc_reply_error(ncs);
-            VRB("Session %d: thread %d event reply error.", nc_session_get_id(ncs), idx);
+            SUB_VRB(NP2LOG_SESSION, "Session %d: thread %d event reply error.", nc_session_get_id(ncs), idx);
         }
         if (rc & NC_PSPOLL_SESSION_TERM) {
-            VRB("Session %d: thread %d event session terminated.", nc_session_get_id(ncs), idx);
+            SUB_VRB(NP2LOG_SESSION, "Session %d: thread %d event session terminated.", nc_session_get_id(ncs), idx);
             np2srv_del_session_cb(ncs);
         }
 #ifdef NC_ENABLED_SSH
         else if (rc & NC_PSPOLL_SSH_CHANNEL) {
             /* a new SSH channel on existing session was created */
-            VRB("Session %d: thread %d event new SSH channel.", nc_session_get_id(ncs), idx);
+            SUB_VRB(NP2LOG_SESSION, "Session %d: thread %d event new SSH channel.", nc_session_get_id(ncs), idx);
             msgtype = nc_session_accept_ssh_channel(ncs, &ncs);
             if (msgtype == NC_MSG_HELLO) {
                 if (np2srv_new_session_cb(NULL, ncs)) {
@@ -961,15 +1187,17 @@ print_version(void)
 static void
 print_usage(char *progname)
 {
-    fprintf(stdout, "Usage: %s [-dhV] [-p path] [-U (path)] [-m mode] [-u uid] [-g gid] [-t timeout] [-v level] [-c category]\n", progname);
+    fprintf(stdout, "Usage: %s [-dhV] [-p path] [-U (path)] [-M (path)] [-m mode] [-u uid] [-g gid] [-t timeout] [-v level] [-c category]\n", progname);
     fprintf(stdout, " -d         debug mode (do not daemonize and print verbose messages to stderr instead of syslog)\n");
     fprintf(stdout, " -h         display help\n");
     fprintf(stdout, " -V         show program version\n");
     fprintf(stdout, " -p path    path to pidfile (default path is \"%s\")\n", NP2SRV_PID_FILE_PATH);
     fprintf(stdout, " -U[path]   listen on a local UNIX socket (default path is \"%s\")\n", NP2SRV_UNIX_SOCK_PATH);
-    fprintf(stdout, " -m mode    set mode for the listening UNIX socket\n");
-    fprintf(stdout, " -u uid     set UID/user for the listening UNIX socket\n");
-    fprintf(stdout, " -g gid     set GID/group for the listening UNIX socket\n");
+    fprintf(stdout, " -M[path]   export metrics in the OpenMetrics text format on a local UNIX socket\n");
+    fprintf(stdout, "            (default path is \"%s\")\n", NP2SRV_METRICS_SOCK_PATH);
+    fprintf(stdout, " -m mode    set mode for the listening UNIX sockets\n");
+    fprintf(stdout, " -u uid     set UID/user for the listening UNIX sockets\n");
+    fprintf(stdout, " -g gid     set GID/group for the listening UNIX sockets\n");
     fprintf(stdout, " -t timeout timeout in seconds of all sysrepo functions (applying edit-config, reading data, ...),\n");
     fprintf(stdout, "            if 0 (default), the default sysrepo timeouts are used\n");
     fprintf(stdout, " -v level   verbose output level:\n");
@@ -1020,13 +1248,14 @@ main(int argc, char *argv[])
     sigaction(SIGABRT, &action, NULL);
     sigaction(SIGTERM, &action, NULL);
     sigaction(SIGHUP, &action, NULL);
+    sigaction(SIGUSR1, &action, NULL);
 
     /* ignore SIGPIPE */
     action.sa_handler = SIG_IGN;
     sigaction(SIGPIPE, &action, NULL);
 
     /* process command line options */
-    while ((c = getopt(argc, argv, "dhVp:U::m:u:g:t:v:c:")) != -1) {
+    while ((c = getopt(argc, argv, "dhVp:U::M::m:u:g:t:v:c:")) != -1) {
         switch (c) {
         case 'd':
             daemonize = 0;
@@ -1073,6 +1302,9 @@ main(int argc, char *argv[])
         case 'U':
             np2srv.unix_path = optarg ? optarg : NP2SRV_UNIX_SOCK_PATH;
             break;
+        case 'M':
+            np2srv.metrics_path = optarg ? optarg : NP2SRV_METRICS_SOCK_PATH;
+            break;
         case 'm':
             np2srv.unix_mode = strtoul(optarg, &ptr, 8);
             if (*ptr || (np2srv.unix_mode > 0777)) {
@@ -1208,6 +1440,9 @@ main(int argc, char *argv[])
     }
     close(pidfd);
 
+    /* print log messages from a separate thread, directly if it fails */
+    np2log_async_start();
+
     /* set printer callbacks for the used libraries and set proper log levels */
     nc_set_print_clb(np2log_cb_nc2); /* libnetconf2 */
     ly_set_log_clb(np2log_cb_ly, 1); /* libyang */
@@ -1229,6 +1464,13 @@ main(int argc, char *argv[])
         goto cleanup;
     }
 
+    /* start the metrics exporter */
+    if (np2srv.metrics_path && np2srv_metrics_init(np2srv.metrics_path, np2srv.unix_mode, np2srv.unix_uid,
+            np2srv.unix_gid)) {
+        ret = EXIT_FAILURE;
+        goto cleanup;
+    }
+
     /* start additional worker threads */
     for (i = 1; i < NP2SRV_THREAD_COUNT; ++i) {
         idx = malloc(sizeof *idx);
@@ -1259,5 +1501,8 @@ cleanup:
     /* destroy the server */
     server_destroy();
 
+    /* print any remaining log messages */
+    np2log_async_stop();
+
     return ret;
 }
@@ -0,0 +1,282 @@
+/**
+ * @file metrics.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief OpenMetrics exporter on a local UNIX socket
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "metrics.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "common.h"
+#include "compat.h"
+#include "config_cache.h"
+#include "data_fetch.h"
+#include "filter_cache.h"
+#include "log.h"
+#include "netconf_acm.h"
+#include "netconf_monitoring.h"
+#include "netconf_subscribed_notifications.h"
+#include "oper_cache.h"
+#include "timer_wheel.h"
+
+/**
+ * @brief Metrics exporter state.
+ */
+static struct {
+    const char *path;       /* path of the UNIX socket */
+    int sock;               /* listening socket */
+    ATOMIC_T running;       /* whether the exporter thread should keep running */
+    pthread_t tid;
+} metrics = {.sock = -1};
+
+void
+np_metrics_printf(struct np_metrics *m, const char *format, ...)
+{
+    va_list ap;
+    int len;
+    char *buf;
+
+    if (m->mem_err) {
+        return;
+    }
+
+    va_start(ap, format);
+    len = vsnprintf(m->buf + m->len, m->size - m->len, format, ap);
+    va_end(ap);
+    if (len < 0) {
+        m->mem_err = 1;
+        return;
+    }
+
+    if (m->len + len >= m->size) {
+        /* enlarge the buffer and print again, it is reused for all the following metrics */
+        buf = realloc(m->buf, m->len + len + 1024);
+        if (!buf) {
+            EMEM;
+            m->mem_err = 1;
+            return;
+        }
+        m->buf = buf;
+        m->size = m->len + len + 1024;
+
+        va_start(ap, format);
+        vsnprintf(m->buf + m->len, m->size - m->len, format, ap);
+        va_end(ap);
+    }
+
+    m->len += len;
+}
+
+void
+np_metrics_family(struct np_metrics *m, const char *name, const char *type, const char *help)
+{
+    np_metrics_printf(m, "# TYPE " NP_METRICS_PREFIX "%s %s\n# HELP " NP_METRICS_PREFIX "%s %s\n", name, type, name,
+            help);
+}
+
+void
+np_metrics_counter(struct np_metrics *m, const char *name, const char *help, uint64_t value)
+{
+    np_metrics_family(m, name, "counter", help);
+    np_metrics_printf(m, NP_METRICS_PREFIX "%s_total %" PRIu64 "\n", name, value);
+}
+
+void
+np_metrics_gauge(struct np_metrics *m, const char *name, const char *help, uint64_t value)
+{
+    np_metrics_family(m, name, "gauge", help);
+    np_metrics_printf(m, NP_METRICS_PREFIX "%s %" PRIu64 "\n", name, value);
+}
+
+/**
+ * @brief Collect all the metrics. No data trees are created, only the counters are read.
+ *
+ * @param[in] m Metrics buffer to print into.
+ */
+static void
+np_metrics_collect(struct np_metrics *m)
+{
+    ncm_metrics(m);
+    ncac_metrics(m);
+    sub_ntf_metrics(m);
+    np_timer_metrics(m);
+    np_cfg_cache_metrics(m);
+    np_oper_cache_metrics(m);
+    np_filter_cache_metrics(m);
+    np_data_fetch_metrics(m);
+    np2log_metrics(m);
+
+    np_metrics_printf(m, "# EOF\n");
+}
+
+/**
+ * @brief Send all the metrics to a client.
+ *
+ * @param[in] fd Client socket.
+ * @param[in] m Metrics to send.
+ * @return 0 on success, -1 on error.
+ */
+static int
+np_metrics_send(int fd, const struct np_metrics *m)
+{
+    size_t written = 0;
+    ssize_t r;
+
+    while (written < m->len) {
+        r = send(fd, m->buf + written, m->len - written, MSG_NOSIGNAL);
+        if (r == -1) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return -1;
+        }
+        written += r;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Metrics exporter thread, sends the current metrics to every connected client.
+ */
+static void *
+np_metrics_thread(void *UNUSED(arg))
+{
+    struct np_metrics m = {0};
+    struct pollfd pfd = {.fd = metrics.sock, .events = POLLIN};
+    struct timeval tv = {.tv_sec = NP2SRV_METRICS_SEND_TIMEOUT};
+    int fd, r;
+
+    while (ATOMIC_LOAD_RELAXED(metrics.running)) {
+        r = poll(&pfd, 1, NP2SRV_METRICS_POLL_TIMEOUT);
+        if (r == -1) {
+            if (errno != EINTR) {
+                ERR("Polling the metrics socket failed (%s).", strerror(errno));
+                break;
+            }
+            continue;
+        } else if (!r) {
+            continue;
+        }
+
+        fd = accept(metrics.sock, NULL, NULL);
+        if (fd == -1) {
+            if ((errno != EAGAIN) && (errno != EWOULDBLOCK) && (errno != EINTR)) {
+                WRN("Accepting a metrics client failed (%s).", strerror(errno));
+            }
+            continue;
+        }
+
+        /* a stuck client must not block the exporter */
+        setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof tv);
+
+        /* reuse the buffer */
+        m.len = 0;
+        m.mem_err = 0;
+        np_metrics_collect(&m);
+
+        if (!m.mem_err && np_metrics_send(fd, &m)) {
+            WRN("Sending metrics failed (%s).", strerror(errno));
+        }
+        close(fd);
+    }
+
+    free(m.buf);
+    return NULL;
+}
+
+int
+np2srv_metrics_init(const char *path, mode_t mode, uid_t uid, gid_t gid)
+{
+    struct sockaddr_un addr = {.sun_family = AF_UNIX};
+    int r;
+
+    if (strlen(path) >= sizeof addr.sun_path) {
+        ERR("Metrics socket path \"%s\" is too long.", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    metrics.sock = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (metrics.sock == -1) {
+        ERR("Failed to create the metrics socket (%s).", strerror(errno));
+        return -1;
+    }
+
+    /* remove any socket left by a previous run */
+    unlink(path);
+    if (bind(metrics.sock, (struct sockaddr *)&addr, sizeof addr) == -1) {
+        ERR("Failed to bind the metrics socket to \"%s\" (%s).", path, strerror(errno));
+        goto error;
+    }
+    metrics.path = path;
+
+    if ((mode != (mode_t)-1) && (chmod(path, mode) == -1)) {
+        ERR("Failed to set mode of the metrics socket \"%s\" (%s).", path, strerror(errno));
+        goto error;
+    }
+    if (((uid != (uid_t)-1) || (gid != (gid_t)-1)) && (chown(path, uid, gid) == -1)) {
+        ERR("Failed to set owner of the metrics socket \"%s\" (%s).", path, strerror(errno));
+        goto error;
+    }
+
+    if (listen(metrics.sock, SOMAXCONN) == -1) {
+        ERR("Failed to listen on the metrics socket (%s).", strerror(errno));
+        goto error;
+    }
+
+    ATOMIC_STORE_RELAXED(metrics.running, 1);
+    if ((r = pthread_create(&metrics.tid, NULL, np_metrics_thread, NULL))) {
+        ATOMIC_STORE_RELAXED(metrics.running, 0);
+        ERR("Failed to create the metrics thread (%s).", strerror(r));
+        goto error;
+    }
+
+    return 0;
+
+error:
+    np2srv_metrics_destroy();
+    return -1;
+}
+
+void
+np2srv_metrics_destroy(void)
+{
+    if (ATOMIC_LOAD_RELAXED(metrics.running)) {
+        ATOMIC_STORE_RELAXED(metrics.running, 0);
+        pthread_join(metrics.tid, NULL);
+    }
+
+    if (metrics.sock > -1) {
+        close(metrics.sock);
+        metrics.sock = -1;
+    }
+    if (metrics.path) {
+        unlink(metrics.path);
+        metrics.path = NULL;
+    }
+}
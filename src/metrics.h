@@ -0,0 +1,89 @@
+/**
+ * @file metrics.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief OpenMetrics exporter header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_METRICS_H_
+#define NP2SRV_METRICS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/types.h>
+
+/* prefix of all the metric names */
+#define NP_METRICS_PREFIX "netopeer2_"
+
+/**
+ * @brief Buffer with the metrics in the OpenMetrics text format.
+ */
+struct np_metrics {
+    char *buf;
+    size_t len;
+    size_t size;
+    int mem_err;    /* memory allocation failed, the metrics are incomplete */
+};
+
+/**
+ * @brief Start listening on the metrics UNIX socket and start the exporter thread.
+ *
+ * @param[in] path Path of the UNIX socket.
+ * @param[in] mode Mode of the socket, -1 for the default.
+ * @param[in] uid UID of the socket, -1 for the default.
+ * @param[in] gid GID of the socket, -1 for the default.
+ * @return 0 on success, -1 on error.
+ */
+int np2srv_metrics_init(const char *path, mode_t mode, uid_t uid, gid_t gid);
+
+/**
+ * @brief Stop the exporter thread and remove the metrics UNIX socket, if created.
+ */
+void np2srv_metrics_destroy(void);
+
+/**
+ * @brief Print into the metrics buffer.
+ *
+ * @param[in] m Metrics buffer.
+ * @param[in] format Format string.
+ */
+void np_metrics_printf(struct np_metrics *m, const char *format, ...);
+
+/**
+ * @brief Print the metadata of a metric family.
+ *
+ * @param[in] m Metrics buffer.
+ * @param[in] name Metric family name, without the server prefix.
+ * @param[in] type Metric type.
+ * @param[in] help Metric description.
+ */
+void np_metrics_family(struct np_metrics *m, const char *name, const char *type, const char *help);
+
+/**
+ * @brief Print a counter metric without any labels.
+ *
+ * @param[in] m Metrics buffer.
+ * @param[in] name Metric family name, without the server prefix and the "_total" suffix.
+ * @param[in] help Metric description.
+ * @param[in] value Counter value.
+ */
+void np_metrics_counter(struct np_metrics *m, const char *name, const char *help, uint64_t value);
+
+/**
+ * @brief Print a gauge metric without any labels.
+ *
+ * @param[in] m Metrics buffer.
+ * @param[in] name Metric family name, without the server prefix.
+ * @param[in] help Metric description.
+ * @param[in] value Gauge value.
+ */
+void np_metrics_gauge(struct np_metrics *m, const char *name, const char *help, uint64_t value);
+
+#endif /* NP2SRV_METRICS_H_ */
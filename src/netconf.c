@@ -19,7 +19,6 @@
 #include "netconf.h"
 
 #include <assert.h>
-#include <ctype.h>
 #include <errno.h>
 #include <inttypes.h>
 #include <pthread.h>
@@ -33,135 +32,67 @@
 
 #include "common.h"
 #include "compat.h"
+#include "config_cache.h"
 #include "err_netconf.h"
+#include "filter_cache.h"
 #include "log.h"
 #include "netconf_acm.h"
 #include "netconf_monitoring.h"
-
-static int
-np2srv_get_first_ns(const char *expr, const char **start, int *len)
-{
-    int i;
-
-    if (expr[0] != '/') {
-        return -1;
-    }
-    if (expr[1] == '/') {
-        expr += 2;
-    } else {
-        ++expr;
-    }
-
-    if (!isalpha(expr[0]) && (expr[0] != '_')) {
-        return -1;
-    }
-    for (i = 1; expr[i] && (isalnum(expr[i]) || (expr[i] == '_') || (expr[i] == '-') || (expr[i] == '.')); ++i) {}
-    if (expr[i] != ':') {
-        return -1;
-    }
-
-    *start = expr;
-    *len = i;
-    return 0;
-}
-
-/**
- * @brief Get generic filters in the form of "/module:*" from exact xpath filters.
- */
-static int
-np2srv_get_rpc_module_filters(const struct np2_filter *filter, struct np2_filter *mod_filter)
-{
-    int len, selection;
-    uint32_t i, j;
-    const char *start;
-    char *str;
-
-    for (i = 0; i < filter->count; ++i) {
-        if (np2srv_get_first_ns(filter->filters[i].str, &start, &len)) {
-            /* not the simple format, use it as it is */
-            str = strdup(filter->filters[i].str);
-            selection = filter->filters[i].selection;
-        } else {
-            /* get all the data of a module */
-            if (asprintf(&str, "/%.*s:*", len, start) == -1) {
-                str = NULL;
-            }
-            selection = 1;
-        }
-
-        if (!str) {
-            EMEM;
-            return SR_ERR_NO_MEMORY;
-        }
-
-        /* check for a duplicity */
-        for (j = 0; j < mod_filter->count; ++j) {
-            if (!strcmp(str, mod_filter->filters[j].str)) {
-                break;
-            }
-        }
-        if (j < mod_filter->count) {
-            free(str);
-            continue;
-        }
-
-        /* add a new module filter */
-        mod_filter->filters = realloc(mod_filter->filters, (mod_filter->count + 1) * sizeof *mod_filter->filters);
-        mod_filter->filters[mod_filter->count].str = str;
-        mod_filter->filters[mod_filter->count].selection = selection;
-        ++mod_filter->count;
-    }
-
-    return SR_ERR_OK;
-}
+#include "oper_cache.h"
+#include "request_xpath.h"
+#include "stats.h"
 
 /**
  * @brief Get data for a get RPC.
  */
 static int
-np2srv_get_rpc_data(sr_session_ctx_t *session, const struct np2_filter *filter, sr_session_ctx_t *ev_sess,
+np2srv_get_rpc_data(sr_session_ctx_t *session, const struct np_filter_plan *plan, sr_session_ctx_t *ev_sess,
         struct lyd_node **data)
 {
     struct lyd_node *all_data = NULL;
     sr_datastore_t ds;
-    sr_get_oper_options_t get_opts = 0;
-    struct np2_filter mod_filter = {0};
+    struct timespec start;
     int rc = SR_ERR_OK;
     struct ly_set *set = NULL;
 
-    /* get generic filters to allow retrieving all possibly needed data first, which are then filtered again
-     * (once we have merged config and state data) */
-    rc = np2srv_get_rpc_module_filters(filter, &mod_filter);
-    if (rc) {
-        goto cleanup;
-    }
+    /* use generic module filters to allow retrieving all possibly needed data first, which are then filtered again
+     * (once we have merged config and state data); the operational callbacks thus never narrow the data they create
+     * based on the request XPath */
 
     /* get data from running first */
     ds = SR_DS_RUNNING;
+    np_stats_stage_start(&start);
 
 get_sr_data:
     sr_session_switch_ds(session, ds);
 
-    if ((rc = op_filter_data_get(session, 0, get_opts, &mod_filter, ev_sess, &all_data))) {
+    if (ds == SR_DS_OPERATIONAL) {
+        /* state data may be shared with other get requests */
+        rc = np_oper_cache_data_get(session, &plan->mod_filter, ev_sess, &all_data);
+    } else {
+        rc = op_filter_data_get(session, 0, 0, &plan->mod_filter, ev_sess, &all_data);
+    }
+    if (rc) {
         goto cleanup;
     }
 
     if (ds == SR_DS_RUNNING) {
         /* we have running data, now append state data */
         ds = SR_DS_OPERATIONAL;
-        get_opts = SR_OPER_NO_CONFIG;
         goto get_sr_data;
     }
+    np_stats_stage_end(NP_STATS_DATA_GET, &start);
 
     /* now filter only the requested data from the created running data + state data */
-    if ((rc = op_filter_data_filter(&all_data, filter, 1, data))) {
+    np_stats_stage_start(&start);
+    if ((rc = op_filter_data_filter(&all_data, &plan->filter, 1, data))) {
         goto cleanup;
     }
+    np_stats_stage_end(NP_STATS_FILTER, &start);
 
 cleanup:
     ly_set_free(set, NULL);
     lyd_free_siblings(all_data);
-    op_filter_erase(&mod_filter);
     return rc;
 }
 
@@ -173,6 +104,7 @@ np2srv_getconfig_rpc_data(sr_session_ctx_t *session, const struct np2_filter *fi
         sr_session_ctx_t *ev_sess, struct lyd_node **data)
 {
     struct lyd_node *select_data = NULL;
+    struct timespec start;
     int rc = SR_ERR_OK;
 
     /* update sysrepo session datastore */
@@ -181,13 +113,17 @@ np2srv_getconfig_rpc_data(sr_session_ctx_t *session, const struct np2_filter *fi
     /*
      * create the data tree for the data reply
      */
+    np_stats_stage_start(&start);
     if ((rc = op_filter_data_get(session, 0, 0, filter, ev_sess, &select_data))) {
         goto cleanup;
     }
+    np_stats_stage_end(NP_STATS_DATA_GET, &start);
 
+    np_stats_stage_start(&start);
     if ((rc = op_filter_data_filter(&select_data, filter, 0, data))) {
         goto cleanup;
     }
+    np_stats_stage_end(NP_STATS_FILTER, &start);
 
 cleanup:
     lyd_free_siblings(select_data);
@@ -200,18 +136,24 @@ np2srv_rpc_get_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char
 {
     struct lyd_node *node, *data_get = NULL;
     struct lyd_meta *meta;
-    struct np2_filter filter = {0};
+    const struct np_filter_plan *plan = NULL;
     int rc = SR_ERR_OK;
     struct np2_user_sess *user_sess = NULL;
     struct ly_set *nodeset = NULL;
     sr_datastore_t ds = 0;
-    const char *single_filter, *username;
+    const char *username;
+    struct timespec start;
+    struct np_cfg_cache_req cache_req = {0};
+    int cached = 0;
 
     if (NP_IGNORE_RPC(session, event)) {
         /* ignore in this case */
         return SR_ERR_OK;
     }
 
+    /* measure the processing stages of this RPC */
+    np_stats_rpc_set(op_path + 1);
+
     /* get know which datastore is being affected for get-config */
     if (!strcmp(op_path, "/ietf-netconf:get-config")) {
         lyd_find_xpath(input, "source/*", &nodeset);
@@ -245,37 +187,16 @@ np2srv_rpc_get_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char
 
         if (!meta) {
             /* subtree */
-            if (((struct lyd_node_any *)node)->value_type == LYD_ANYDATA_DATATREE) {
-                if (op_filter_subtree2xpath(((struct lyd_node_any *)node)->value.tree, &filter)) {
-                    rc = SR_ERR_INTERNAL;
-                    goto cleanup;
-                }
-            }
-            single_filter = NULL;
+            rc = np_filter_plan_get((struct lyd_node_any *)node, NULL, &plan);
         } else {
             /* xpath */
-            single_filter = lyd_get_meta_value(meta);
+            rc = np_filter_plan_get(NULL, lyd_get_meta_value(meta), &plan);
         }
     } else {
-        single_filter = "/*";
+        rc = np_filter_plan_get(NULL, "/*", &plan);
     }
-
-    if (single_filter) {
-        /* create a single filter */
-        filter.filters = malloc(sizeof *filter.filters);
-        if (!filter.filters) {
-            EMEM;
-            rc = SR_ERR_NO_MEMORY;
-            goto cleanup;
-        }
-        filter.count = 1;
-        filter.filters[0].str = strdup(single_filter);
-        filter.filters[0].selection = 1;
-        if (!filter.filters[0].str) {
-            EMEM;
-            rc = SR_ERR_NO_MEMORY;
-            goto cleanup;
-        }
+    if (rc) {
+        goto cleanup;
     }
 
     /* we do not care here about with-defaults mode, it does not change anything */
@@ -285,19 +206,30 @@ np2srv_rpc_get_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char
         goto cleanup;
     }
 
+    sr_session_get_orig_data(session, 1, NULL, (const void **)&username);
+
     /* get filtered data */
-    if (!strcmp(op_path, "/ietf-netconf:get-config")) {
-        rc = np2srv_getconfig_rpc_data(user_sess->sess, &filter, ds, session, &data_get);
+    if (strcmp(op_path, "/ietf-netconf:get-config")) {
+        rc = np2srv_get_rpc_data(user_sess->sess, plan, session, &data_get);
+    } else if (np_cfg_cache_get(ds, &plan->filter, username, &cache_req, &data_get)) {
+        /* the same reply was already created for this user */
+        cached = 1;
     } else {
-        rc = np2srv_get_rpc_data(user_sess->sess, &filter, session, &data_get);
+        rc = np2srv_getconfig_rpc_data(user_sess->sess, &plan->filter, ds, session, &data_get);
     }
     if (rc) {
         goto cleanup;
     }
 
-    /* perform correct NACM filtering */
-    sr_session_get_orig_data(session, 1, NULL, (const void **)&username);
-    ncac_check_data_read_filter(&data_get, username);
+    if (!cached) {
+        /* perform correct NACM filtering */
+        np_stats_stage_start(&start);
+        ncac_check_data_read_filter(&data_get, username);
+        np_stats_stage_end(NP_STATS_NACM_READ, &start);
+
+        /* cache the reply, if possible */
+        np_cfg_cache_put(&cache_req, &plan->filter, username, data_get);
+    }
 
     /* add output */
     if (lyd_new_any(output, NULL, "data", data_get, 1, LYD_ANYDATA_DATATREE, 1, &node)) {
@@ -308,9 +240,10 @@ np2srv_rpc_get_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char
     /* success */
 
 cleanup:
-    op_filter_erase(&filter);
+    np_filter_plan_release(plan);
     lyd_free_siblings(data_get);
     np_release_user_sess(user_sess);
+    np_stats_rpc_set(NULL);
     return rc;
 }
 
@@ -368,7 +301,9 @@ np2srv_rpc_editconfig_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), con
     /* config */
     lyd_find_xpath(input, "config | url", &nodeset);
     if (!strcmp(nodeset->dnodes[0]->schema->name, "config")) {
-        config = op_parse_config((struct lyd_node_any *)nodeset->dnodes[0], LYD_PARSE_OPAQ | LYD_PARSE_ONLY, &rc, session);
+        /* input is not needed afterwards, take the config */
+        config = op_parse_config((struct lyd_node_any *)nodeset->dnodes[0], LYD_PARSE_OPAQ | LYD_PARSE_ONLY, 1, &rc,
+                session);
         if (rc) {
             ly_set_free(nodeset, NULL);
             goto cleanup;
@@ -384,7 +319,7 @@ np2srv_rpc_editconfig_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), con
 #else
         ly_set_free(nodeset, NULL);
         rc = SR_ERR_UNSUPPORTED;
-        sr_session_set_error_message(session, "URL not supported.");
+        np_err_msg(session, "URL not supported.");
         goto cleanup;
 #endif
     }
@@ -413,7 +348,7 @@ np2srv_rpc_editconfig_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), con
         rc = sr_validate(user_sess->sess, NULL, 0);
     }
     if (rc) {
-        sr_session_dup_error(user_sess->sess, session);
+        np_err_dup(user_sess->sess, session);
         goto cleanup;
     }
 
@@ -486,8 +421,9 @@ np2srv_rpc_copyconfig_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), con
     } else if (!strcmp(nodeset->dnodes[0]->schema->name, "candidate")) {
         sds = SR_DS_CANDIDATE;
     } else if (!strcmp(nodeset->dnodes[0]->schema->name, "config")) {
+        /* input is not needed afterwards, take the config */
         config = op_parse_config((struct lyd_node_any *)nodeset->dnodes[0],
-                LYD_PARSE_STRICT | LYD_PARSE_NO_STATE | LYD_PARSE_ONLY, &rc, session);
+                LYD_PARSE_STRICT | LYD_PARSE_NO_STATE | LYD_PARSE_ONLY, 1, &rc, session);
         if (rc) {
             ly_set_free(nodeset, NULL);
             goto cleanup;
@@ -726,7 +662,7 @@ np2srv_rpc_un_lock_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
     } else if (rc) {
         /* generic error */
         sr_session_get_error(user_sess->sess, &err_info);
-        sr_session_set_error_message(session, err_info->err[0].message);
+        np_err_msg(session, "%s", err_info->err[0].message);
         goto cleanup;
     }
 
@@ -744,7 +680,7 @@ np2srv_rpc_kill_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const cha
 {
     struct nc_session *kill_sess;
     struct lyd_node *node;
-    uint32_t kill_sid, *nc_sid, i;
+    uint32_t kill_sid, *nc_sid;
     int rc = SR_ERR_OK;
 
     if (NP_IGNORE_RPC(session, event)) {
@@ -762,11 +698,7 @@ np2srv_rpc_kill_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const cha
         goto cleanup;
     }
 
-    for (i = 0; (kill_sess = nc_ps_get_session(np2srv.nc_ps, i)); ++i) {
-        if (nc_session_get_id(kill_sess) == kill_sid) {
-            break;
-        }
-    }
+    kill_sess = np_get_nc_sess_by_id(kill_sid);
     if (!kill_sess) {
         rc = SR_ERR_INVAL_ARG;
         sr_session_set_error_message(session, "Session with the specified \"session-id\" not found.");
@@ -885,7 +817,7 @@ np2srv_rpc_validate_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
         ds = SR_DS_CANDIDATE;
     } else if (!strcmp(nodeset->dnodes[0]->schema->name, "config")) {
         /* config is also validated now */
-        config = op_parse_config((struct lyd_node_any *)nodeset->dnodes[0], LYD_PARSE_STRICT | LYD_PARSE_NO_STATE,
+        config = op_parse_config((struct lyd_node_any *)nodeset->dnodes[0], LYD_PARSE_STRICT | LYD_PARSE_NO_STATE, 1,
                 &rc, session);
         if (rc) {
             ly_set_free(nodeset, NULL);
@@ -964,7 +896,7 @@ np2srv_rpc_subscribe_ntf_cb(sr_session_ctx_t *UNUSED(session), uint32_t sub_id,
         lyd_new_path(NULL, sr_get_context(np2srv.sr_conn), "/nc-notifications:replayComplete", NULL, 0, &ly_ntf);
         notif = ly_ntf;
     } else if (notif_type == SR_EV_NOTIF_TERMINATED) {
-        sr_event_notif_sub_get_info(np2srv.sr_notif_sub, sub_id, NULL, NULL, NULL, &stop, NULL);
+        sr_event_notif_sub_get_info(*NP_NOTIF_SUB(nc_session_get_id(ncs)), sub_id, NULL, NULL, NULL, &stop, NULL);
         if (!stop || (stop > time(NULL))) {
             /* no stop-time or it was not reached so no notification should be generated */
             goto cleanup;
@@ -1116,7 +1048,7 @@ np2srv_rpc_subscribe_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), cons
             if (lysc_module_dfs_full(ly_mod, np2srv_lysc_has_notif_clb, NULL) == LY_EEXIST) {
                 /* a notification was found, subscribe to the module */
                 rc = sr_event_notif_subscribe_tree(user_sess->sess, ly_mod->name, xp, start.tv_sec, stop.tv_sec,
-                        np2srv_rpc_subscribe_ntf_cb, ncs, SR_SUBSCR_CTX_REUSE, &np2srv.sr_notif_sub);
+                        np2srv_rpc_subscribe_ntf_cb, ncs, SR_SUBSCR_CTX_REUSE, NP_NOTIF_SUB(nc_session_get_id(ncs)));
                 if (rc != SR_ERR_OK) {
                     sr_session_get_error(user_sess->sess, &err_info);
                     sr_session_set_error_message(session, err_info->err[0].message);
@@ -1127,7 +1059,7 @@ np2srv_rpc_subscribe_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), cons
     } else {
         /* subscribe to the specific module (stream) */
         rc = sr_event_notif_subscribe_tree(user_sess->sess, stream, xp, start.tv_sec, stop.tv_sec, np2srv_rpc_subscribe_ntf_cb,
-                ncs, SR_SUBSCR_CTX_REUSE, &np2srv.sr_notif_sub);
+                ncs, SR_SUBSCR_CTX_REUSE, NP_NOTIF_SUB(nc_session_get_id(ncs)));
         if (rc != SR_ERR_OK) {
             sr_session_get_error(user_sess->sess, &err_info);
             sr_session_set_error_message(session, err_info->err[0].message);
@@ -1151,35 +1083,48 @@ cleanup:
 
 int
 np2srv_nc_ntf_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
-        const char *UNUSED(path), const char *UNUSED(request_xpath), uint32_t UNUSED(request_id),
+        const char *UNUSED(path), const char *request_xpath, uint32_t UNUSED(request_id),
         struct lyd_node **parent, void *UNUSED(private_data))
 {
     struct lyd_node *root, *stream, *sr_data = NULL, *sr_mod, *rep_sup;
     sr_conn_ctx_t *conn;
     const struct ly_ctx *ly_ctx;
     const struct lys_module *mod;
-    const char *mod_name;
+    const struct np_mod_idx *mod_idx = NULL;
+    const char *mod_name, *name;
     char *buf;
+    size_t name_len;
     int rc;
 
     conn = sr_session_get_connection(session);
     ly_ctx = sr_get_context(conn);
 
+    /* only a single stream may be requested */
+    name = np_xpath_list_key_value(request_xpath, "/nc-notifications:netconf/streams/stream", "name", &name_len);
+
     if (lyd_new_path(NULL, ly_ctx, "/nc-notifications:netconf/streams", NULL, 0, &root)) {
         goto error;
     }
 
     /* generic stream */
-    if (lyd_new_path(root, NULL, "/nc-notifications:netconf/streams/stream[name='NETCONF']", NULL, 0, &stream)) {
-        goto error;
-    }
-    if (lyd_new_term(stream, stream->schema->module, "description",
-            "Default NETCONF stream containing notifications from all the modules."
-            " Replays only notifications for modules (streams) that support replay.", 0, NULL)) {
-        goto error;
-    }
-    if (lyd_new_term(stream, stream->schema->module, "replaySupport", "true", 0, NULL)) {
-        goto error;
+    if (!name || ((name_len == 7) && !strncmp(name, "NETCONF", 7))) {
+        if (lyd_new_path(root, NULL, "/nc-notifications:netconf/streams/stream[name='NETCONF']", NULL, 0, &stream)) {
+            goto error;
+        }
+        if (lyd_new_term(stream, stream->schema->module, "description",
+                "Default NETCONF stream containing notifications from all the modules."
+                " Replays only notifications for modules (streams) that support replay.", 0, NULL)) {
+            goto error;
+        }
+        if (lyd_new_term(stream, stream->schema->module, "replaySupport", "true", 0, NULL)) {
+            goto error;
+        }
+
+        if (name) {
+            /* only the generic stream requested */
+            *parent = root;
+            return SR_ERR_OK;
+        }
     }
 
     /* go through all the sysrepo modules */
@@ -1188,18 +1133,28 @@ np2srv_nc_ntf_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
         ERR("Failed to get sysrepo module info data (%s).", sr_strerror(rc));
         goto error;
     }
+
+    /* modules with notifications */
+    mod_idx = np_mod_idx_get(conn);
+    if (!mod_idx) {
+        goto error;
+    }
     LY_LIST_FOR(lyd_child(sr_data), sr_mod) {
         if (strcmp(sr_mod->schema->name, "module")) {
             continue;
         }
 
         mod_name = lyd_get_value(lyd_child(sr_mod));
+        if (name && (strncmp(mod_name, name, name_len) || mod_name[name_len])) {
+            /* not requested */
+            continue;
+        }
 
         /* get the module */
         mod = ly_ctx_get_module_implemented(ly_ctx, mod_name);
         assert(mod);
 
-        if (!np_ly_mod_has_notif(mod)) {
+        if (!np_mod_idx_has(mod_idx->notif, mod_idx->notif_count, mod)) {
             /* no notifications in the module so do not consider it a stream */
             continue;
         }
@@ -1226,11 +1181,15 @@ np2srv_nc_ntf_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
         }
     }
 
+    np_mod_idx_release();
     lyd_free_siblings(sr_data);
     *parent = root;
     return SR_ERR_OK;
 
 error:
+    if (mod_idx) {
+        np_mod_idx_release();
+    }
     lyd_free_tree(root);
     lyd_free_siblings(sr_data);
     return SR_ERR_INTERNAL;
@@ -57,6 +57,9 @@ ncac_nacm_params_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const ch
 
     pthread_mutex_lock(&nacm.lock);
 
+    /* cached NACM access is no longer valid */
+    ++nacm.version;
+
     while ((rc = sr_get_change_tree_next(session, iter, &op, &node, NULL, NULL, NULL)) == SR_ERR_OK) {
         term = (struct lyd_node_term *)node;
         if (!strcmp(node->schema->name, "enable-nacm")) {
@@ -146,6 +149,25 @@ ncac_oper_cb(sr_session_ctx_t *UNUSED(session), uint32_t UNUSED(sub_id), const c
     return SR_ERR_OK;
 }
 
+void
+ncac_metrics(struct np_metrics *m)
+{
+    uint32_t denied_operations, denied_data_writes, denied_notifications;
+
+    pthread_mutex_lock(&nacm.lock);
+
+    denied_operations = nacm.denied_operations;
+    denied_data_writes = nacm.denied_data_writes;
+    denied_notifications = nacm.denied_notifications;
+
+    pthread_mutex_unlock(&nacm.lock);
+
+    np_metrics_counter(m, "nacm_denied_operations", "Number of operations denied by NACM.", denied_operations);
+    np_metrics_counter(m, "nacm_denied_data_writes", "Number of data writes denied by NACM.", denied_data_writes);
+    np_metrics_counter(m, "nacm_denied_notifications", "Number of notifications denied by NACM.",
+            denied_notifications);
+}
+
 /* /ietf-netconf-acm:nacm/groups/group */
 int
 ncac_group_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name), const char *xpath,
@@ -177,6 +199,9 @@ ncac_group_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UN
 
     pthread_mutex_lock(&nacm.lock);
 
+    /* cached NACM access is no longer valid */
+    ++nacm.version;
+
     while ((rc = sr_get_change_tree_next(session, iter, &op, &node, NULL, NULL, NULL)) == SR_ERR_OK) {
         if (!strcmp(node->schema->name, "group")) {
             /* name must be present */
@@ -349,6 +374,9 @@ ncac_rule_list_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char
 
     pthread_mutex_lock(&nacm.lock);
 
+    /* cached NACM access is no longer valid */
+    ++nacm.version;
+
     while ((rc = sr_get_change_tree_next(session, iter, &op, &node, NULL, &prev_list, NULL)) == SR_ERR_OK) {
         if (!strcmp(node->schema->name, "rule-list")) {
             /* name must be present */
@@ -525,6 +553,9 @@ ncac_rule_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNU
 
     pthread_mutex_lock(&nacm.lock);
 
+    /* cached NACM access is no longer valid */
+    ++nacm.version;
+
     while ((rc = sr_get_change_tree_next(session, iter, &op, &node, NULL, &prev_list, NULL)) == SR_ERR_OK) {
         if (!strcmp(node->schema->name, "rule")) {
             /* find parent rule list */
@@ -1232,6 +1263,55 @@ cleanup:
     return access;
 }
 
+enum ncac_access
+ncac_allowed_node_read(const char *node_path, const struct lysc_node *node_schema, const char *user,
+        int *schema_access)
+{
+    const struct lysc_node *top_node;
+    struct ncac_rule_list *rlist;
+    struct ncac_rule *rule;
+    enum ncac_access access;
+
+    *schema_access = 1;
+
+    pthread_mutex_lock(&nacm.lock);
+
+    /* check access for the whole data tree first */
+    for (top_node = node_schema; top_node->parent; top_node = top_node->parent) {}
+    if (ncac_allowed_tree(top_node, user)) {
+        access = NCAC_ACCESS_PERMIT;
+        goto cleanup;
+    }
+
+    access = ncac_allowed_node(NULL, node_path, node_schema, user, NCAC_OP_READ);
+
+    /* rules with predicates in their targets may match only some instances */
+    for (rlist = nacm.rule_lists; rlist; rlist = rlist->next) {
+        for (rule = rlist->rules; rule; rule = rule->next) {
+            if (rule->target && strchr(rule->target, '[')) {
+                *schema_access = 0;
+                goto cleanup;
+            }
+        }
+    }
+
+cleanup:
+    pthread_mutex_unlock(&nacm.lock);
+    return access;
+}
+
+uint32_t
+ncac_get_version(void)
+{
+    uint32_t version;
+
+    pthread_mutex_lock(&nacm.lock);
+    version = nacm.version;
+    pthread_mutex_unlock(&nacm.lock);
+
+    return version;
+}
+
 const struct lyd_node *
 ncac_check_operation(const struct lyd_node *data, const char *user)
 {
@@ -1311,8 +1391,10 @@ cleanup:
     } else {
         if (op->schema->nodetype & (LYS_RPC | LYS_ACTION)) {
             ++nacm.denied_operations;
+            SUB_DBG(NP2LOG_NACM, "Operation \"%s\" denied for user \"%s\".", op->schema->name, user);
         } else {
             ++nacm.denied_notifications;
+            SUB_DBG(NP2LOG_NACM, "Notification \"%s\" denied for user \"%s\".", op->schema->name, user);
         }
     }
     pthread_mutex_unlock(&nacm.lock);
@@ -1387,6 +1469,22 @@ ncac_check_data_read_filter(struct lyd_node **data, const char *user)
     pthread_mutex_unlock(&nacm.lock);
 }
 
+void
+ncac_check_data_read_filter_children(struct lyd_node *parent, const char *user)
+{
+    assert(parent);
+
+    if (!(parent->schema->nodetype & LYD_NODE_INNER)) {
+        return;
+    }
+
+    pthread_mutex_lock(&nacm.lock);
+
+    ncac_check_data_read_filter_r(&((struct lyd_node_inner *)parent)->child, user);
+
+    pthread_mutex_unlock(&nacm.lock);
+}
+
 /**
  * @brief Check whether diff node siblings can be applied by a user, recursively with children.
  *
@@ -1469,6 +1567,7 @@ ncac_check_diff(const struct lyd_node *diff, const char *user)
         node = ncac_check_diff_r(diff, user, NULL);
         if (node) {
             ++nacm.denied_data_writes;
+            SUB_DBG(NP2LOG_NACM, "Data write of \"%s\" denied for user \"%s\".", node->schema->name, user);
         }
     }
 
@@ -21,6 +21,8 @@
 #include <libyang/libyang.h>
 #include <sysrepo.h>
 
+#include "metrics.h"
+
 #define NCAC_OP_CREATE 0x01 /**< NACM operation create */
 #define NCAC_OP_READ   0x02 /**< NACM operation read */
 #define NCAC_OP_UPDATE 0x04 /**< NACM operation update */
@@ -87,6 +89,7 @@ struct ncac {
         struct ncac_rule_list *next;    /**< Pointer to the next rule list. */
     } *rule_lists;                  /**< List of all the rule lists. */
 
+    uint32_t version;               /**< Configuration version, changed on every NACM configuration change. */
     pthread_mutex_t lock;
 };
 
@@ -117,6 +120,13 @@ int ncac_rule_cb(sr_session_ctx_t *session, uint32_t sub_id, const char *module_
 void ncac_init(void);
 void ncac_destroy(void);
 
+/**
+ * @brief Print the NACM denied counters as metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void ncac_metrics(struct np_metrics *m);
+
 /**
  * @brief Check NACM access for a single node.
  *
@@ -130,6 +140,25 @@ void ncac_destroy(void);
 enum ncac_access ncac_allowed_node(const struct lyd_node *node, const char *node_path,
         const struct lysc_node *node_schema, const char *user, uint8_t oper);
 
+/**
+ * @brief Check NACM R access for a single data node, including the global NACM checks.
+ *
+ * @param[in] node_path Data path of the node to check.
+ * @param[in] node_schema Schema of the node to check.
+ * @param[in] user User, whose access to check.
+ * @param[out] schema_access Whether the access is the same for all the instances of @p node_schema.
+ * @return NCAC access enum.
+ */
+enum ncac_access ncac_allowed_node_read(const char *node_path, const struct lysc_node *node_schema, const char *user,
+        int *schema_access);
+
+/**
+ * @brief Get the current NACM configuration version, any cached NACM access is valid only for the same version.
+ *
+ * @return NACM configuration version.
+ */
+uint32_t ncac_get_version(void);
+
 /**
  * @brief Check whether an operation is allowed for a user.
  *
@@ -155,6 +184,16 @@ const struct lyd_node *ncac_check_operation(const struct lyd_node *data, const c
  */
 void ncac_check_data_read_filter(struct lyd_node **data, const char *user);
 
+/**
+ * @brief Filter out any descendants of a node for which the user does not have R access.
+ *
+ * Access to the node itself is expected to be checked before.
+ *
+ * @param[in] parent Node whose descendants to filter.
+ * @param[in] user User for the NACM filtering.
+ */
+void ncac_check_data_read_filter_children(struct lyd_node *parent, const char *user);
+
 /**
  * @brief Check whether a diff (simplified edit-config tree) can be
  * applied by a user.
@@ -14,6 +14,7 @@
 
 #include "netconf_monitoring.h"
 
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -26,6 +27,17 @@
 #include "common.h"
 #include "compat.h"
 #include "log.h"
+#include "request_xpath.h"
+
+/*
+ * netconf-state subtrees
+ */
+#define NCM_CAPABILITIES    0x01
+#define NCM_DATASTORES      0x02
+#define NCM_SCHEMAS         0x04
+#define NCM_SESSIONS        0x08
+#define NCM_STATISTICS      0x10
+#define NCM_ALL             0x1F
 
 struct ncm stats;
 
@@ -34,6 +46,7 @@ ncm_init(void)
 {
     stats.netconf_start_time = time(NULL);
     pthread_mutex_init(&stats.lock, NULL);
+    pthread_mutex_init(&stats.cache_lock, NULL);
 }
 
 void
@@ -42,21 +55,8 @@ ncm_destroy(void)
     free(stats.sessions);
     free(stats.session_stats);
     pthread_mutex_destroy(&stats.lock);
-}
-
-static uint32_t
-find_session_idx(struct nc_session *session)
-{
-    uint32_t i;
-
-    for (i = 0; i < stats.session_count; ++i) {
-        if (nc_session_get_id(stats.sessions[i]) == nc_session_get_id(session)) {
-            return i;
-        }
-    }
-
-    EINT;
-    return 0;
+    lyd_free_tree(stats.cache);
+    pthread_mutex_destroy(&stats.cache_lock);
 }
 
 static int
@@ -79,69 +79,113 @@ ncm_is_monitored(struct nc_session *session)
     return 0;
 }
 
-void
-ncm_session_rpc(struct nc_session *session)
+/**
+ * @brief Get the counters of a monitored session.
+ *
+ * @param[in] session NETCONF session.
+ * @return Session counters, NULL if the session is not monitored.
+ */
+static struct ncm_session_stats *
+ncm_session_stats(struct nc_session *session)
 {
-    if (!ncm_is_monitored(session)) {
-        return;
+    struct np2_user_sess *user_sess;
+
+    user_sess = nc_session_get_data(session);
+    if (!user_sess) {
+        return NULL;
     }
 
-    pthread_mutex_lock(&stats.lock);
+    return user_sess->ncm_stats;
+}
 
-    ++stats.session_stats[find_session_idx(session)].in_rpcs;
-    ++stats.global_stats.in_rpcs;
+void
+ncm_session_rpc(struct nc_session *session)
+{
+    struct ncm_session_stats *sess_stats;
 
-    pthread_mutex_unlock(&stats.lock);
+    if ((sess_stats = ncm_session_stats(session))) {
+        ATOMIC_INC_RELAXED(sess_stats->in_rpcs);
+    }
 }
 
 void
 ncm_session_bad_rpc(struct nc_session *session)
 {
-    if (!ncm_is_monitored(session)) {
-        return;
-    }
-
-    pthread_mutex_lock(&stats.lock);
+    struct ncm_session_stats *sess_stats;
 
-    ++stats.session_stats[find_session_idx(session)].in_bad_rpcs;
-    ++stats.global_stats.in_bad_rpcs;
-
-    pthread_mutex_unlock(&stats.lock);
+    if ((sess_stats = ncm_session_stats(session))) {
+        ATOMIC_INC_RELAXED(sess_stats->in_bad_rpcs);
+    }
 }
 
 void
 ncm_session_rpc_reply_error(struct nc_session *session)
 {
-    if (!ncm_is_monitored(session)) {
-        return;
-    }
-
-    pthread_mutex_lock(&stats.lock);
-
-    ++stats.session_stats[find_session_idx(session)].out_rpc_errors;
-    ++stats.global_stats.out_rpc_errors;
+    struct ncm_session_stats *sess_stats;
 
-    pthread_mutex_unlock(&stats.lock);
+    if ((sess_stats = ncm_session_stats(session))) {
+        ATOMIC_INC_RELAXED(sess_stats->out_rpc_errors);
+    }
 }
 
 void
 ncm_session_notification(struct nc_session *session)
 {
-    if (!ncm_is_monitored(session)) {
-        return;
+    struct ncm_session_stats *sess_stats;
+
+    if ((sess_stats = ncm_session_stats(session))) {
+        ATOMIC_INC_RELAXED(sess_stats->out_notifications);
     }
+}
 
-    pthread_mutex_lock(&stats.lock);
+/**
+ * @brief Add session counters to a counter snapshot.
+ *
+ * @param[in,out] counters Counters to add to.
+ * @param[in] sess_stats Session counters to add.
+ */
+static void
+ncm_counters_add(struct ncm_counters *counters, struct ncm_session_stats *sess_stats)
+{
+    counters->in_rpcs += ATOMIC_LOAD_RELAXED(sess_stats->in_rpcs);
+    counters->in_bad_rpcs += ATOMIC_LOAD_RELAXED(sess_stats->in_bad_rpcs);
+    counters->out_rpc_errors += ATOMIC_LOAD_RELAXED(sess_stats->out_rpc_errors);
+    counters->out_notifications += ATOMIC_LOAD_RELAXED(sess_stats->out_notifications);
+}
+
+/**
+ * @brief Sum the counters of all the sessions. Stats lock is expected to be held.
+ *
+ * @param[out] counters Global counters.
+ */
+static void
+ncm_global_counters(struct ncm_counters *counters)
+{
+    uint32_t i;
 
-    ++stats.session_stats[find_session_idx(session)].out_notifications;
-    ++stats.global_stats.out_notifications;
+    *counters = stats.closed_stats;
+    for (i = 0; i < stats.session_count; ++i) {
+        ncm_counters_add(counters, stats.session_stats[i]);
+    }
+}
 
-    pthread_mutex_unlock(&stats.lock);
+/**
+ * @brief Get a 64-bit counter value for a 32-bit ietf-netconf-monitoring leaf.
+ *
+ * @param[in] value Counter value.
+ * @return Value clamped to the maximum 32-bit value.
+ */
+static uint32_t
+ncm_counter32(uint64_t value)
+{
+    return (value > UINT32_MAX) ? UINT32_MAX : value;
 }
 
 void
 ncm_session_add(struct nc_session *session)
 {
+    struct np2_user_sess *user_sess;
+    struct ncm_session_stats *sess_stats;
     void *new;
 
     if (!ncm_is_monitored(session)) {
@@ -150,36 +194,50 @@ ncm_session_add(struct nc_session *session)
         return;
     }
 
+    /* the counters are owned by the user session so that they can be accessed while it exists */
+    user_sess = nc_session_get_data(session);
+    sess_stats = calloc(1, sizeof *sess_stats);
+    if (!sess_stats) {
+        EMEM;
+        return;
+    }
+
     pthread_mutex_lock(&stats.lock);
 
     ++stats.in_sessions;
 
-    ++stats.session_count;
-    new = realloc(stats.sessions, stats.session_count * sizeof *stats.sessions);
+    new = realloc(stats.sessions, (stats.session_count + 1) * sizeof *stats.sessions);
     if (!new) {
         EMEM;
-        return;
+        goto cleanup;
     }
     stats.sessions = new;
-    new = realloc(stats.session_stats, stats.session_count * sizeof *stats.session_stats);
+    new = realloc(stats.session_stats, (stats.session_count + 1) * sizeof *stats.session_stats);
     if (!new) {
         EMEM;
-        return;
+        goto cleanup;
     }
     stats.session_stats = new;
 
-    stats.sessions[stats.session_count - 1] = session;
-    memset(&stats.session_stats[stats.session_count - 1], 0, sizeof *stats.session_stats);
+    stats.sessions[stats.session_count] = session;
+    stats.session_stats[stats.session_count] = sess_stats;
+    ++stats.session_count;
+
+    user_sess->ncm_stats = sess_stats;
+    sess_stats = NULL;
 
+cleanup:
     pthread_mutex_unlock(&stats.lock);
+    free(sess_stats);
 }
 
 void
 ncm_session_del(struct nc_session *session)
 {
+    struct ncm_session_stats *sess_stats;
     uint32_t i;
 
-    if (!ncm_is_monitored(session)) {
+    if (!(sess_stats = ncm_session_stats(session))) {
         return;
     }
 
@@ -193,11 +251,19 @@ ncm_session_del(struct nc_session *session)
         ++stats.dropped_sessions;
     }
 
-    i = find_session_idx(session);
-    --stats.session_count;
-    if (stats.session_count && (i < stats.session_count)) {
-        memmove(&stats.sessions[i], &stats.sessions[i + 1], (stats.session_count - i) * sizeof *stats.sessions);
-        memmove(&stats.session_stats[i], &stats.session_stats[i + 1], (stats.session_count - i) * sizeof *stats.session_stats);
+    /* keep the counters of the session in the global counters */
+    ncm_counters_add(&stats.closed_stats, sess_stats);
+
+    for (i = 0; (i < stats.session_count) && (stats.session_stats[i] != sess_stats); ++i) {}
+    if (i == stats.session_count) {
+        EINT;
+    } else {
+        --stats.session_count;
+        if (i < stats.session_count) {
+            memmove(&stats.sessions[i], &stats.sessions[i + 1], (stats.session_count - i) * sizeof *stats.sessions);
+            memmove(&stats.session_stats[i], &stats.session_stats[i + 1],
+                    (stats.session_count - i) * sizeof *stats.session_stats);
+        }
     }
 
     pthread_mutex_unlock(&stats.lock);
@@ -210,29 +276,48 @@ ncm_bad_hello(struct nc_session *session)
         return;
     }
 
+    ATOMIC_INC_RELAXED(stats.in_bad_hellos);
+}
+
+void
+ncm_metrics(struct np_metrics *m)
+{
+    struct ncm_counters global_stats;
+    uint64_t in_sessions, dropped_sessions;
+    uint32_t session_count;
+
+    /* copy the counters so that the lock is held only briefly */
     pthread_mutex_lock(&stats.lock);
 
-    ++stats.in_bad_hellos;
+    ncm_global_counters(&global_stats);
+    session_count = stats.session_count;
+    in_sessions = stats.in_sessions;
+    dropped_sessions = stats.dropped_sessions;
 
     pthread_mutex_unlock(&stats.lock);
+
+    np_metrics_gauge(m, "start_time_seconds", "Time the NETCONF server was started.", stats.netconf_start_time);
+    np_metrics_gauge(m, "sessions", "Number of monitored NETCONF sessions.", session_count);
+    np_metrics_counter(m, "in_sessions", "Number of started NETCONF sessions.", in_sessions);
+    np_metrics_counter(m, "in_bad_hellos", "Number of sessions dropped because of an invalid hello message.",
+            ATOMIC_LOAD_RELAXED(stats.in_bad_hellos));
+    np_metrics_counter(m, "dropped_sessions", "Number of abnormally terminated sessions.", dropped_sessions);
+    np_metrics_counter(m, "in_rpcs", "Number of correct RPCs received.", global_stats.in_rpcs);
+    np_metrics_counter(m, "in_bad_rpcs", "Number of invalid RPCs received.", global_stats.in_bad_rpcs);
+    np_metrics_counter(m, "out_rpc_errors", "Number of RPC replies with an error.", global_stats.out_rpc_errors);
+    np_metrics_counter(m, "out_notifications", "Number of notifications sent.", global_stats.out_notifications);
 }
 
-uint32_t
+uint64_t
 ncm_session_get_notification(struct nc_session *session)
 {
-    uint32_t count;
+    struct ncm_session_stats *sess_stats;
 
-    if (!ncm_is_monitored(session)) {
+    if (!(sess_stats = ncm_session_stats(session))) {
         return 0;
     }
 
-    pthread_mutex_lock(&stats.lock);
-
-    count = stats.session_stats[find_session_idx(session)].out_notifications;
-
-    pthread_mutex_unlock(&stats.lock);
-
-    return count;
+    return ATOMIC_LOAD_RELAXED(sess_stats->out_notifications);
 }
 
 static void
@@ -263,20 +348,60 @@ ncm_data_add_ds_lock(sr_conn_ctx_t *conn, const char *ds_str, sr_datastore_t ds,
     }
 }
 
-int
-np2srv_ncm_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
-        const char *UNUSED(path), const char *UNUSED(request_xpath), uint32_t UNUSED(request_id),
-        struct lyd_node **parent, void *UNUSED(private_data))
+/**
+ * @brief Learn the netconf-state subtrees that need to be created for a request.
+ *
+ * @param[in] request_xpath Requested XPath, may be NULL.
+ * @return Bitmask of NCM_* subtrees.
+ */
+static uint32_t
+ncm_requested_subtrees(const char *request_xpath)
+{
+    const char *name;
+    size_t len;
+
+    name = np_xpath_child_name(request_xpath, "/ietf-netconf-monitoring:netconf-state", &len);
+    if (!name) {
+        /* whole container or an XPath too complex to handle */
+        return NCM_ALL;
+    }
+
+    if ((len == 12) && !strncmp(name, "capabilities", len)) {
+        return NCM_CAPABILITIES;
+    } else if ((len == 10) && !strncmp(name, "datastores", len)) {
+        return NCM_DATASTORES;
+    } else if ((len == 7) && !strncmp(name, "schemas", len)) {
+        return NCM_SCHEMAS;
+    } else if ((len == 8) && !strncmp(name, "sessions", len)) {
+        return NCM_SESSIONS;
+    } else if ((len == 10) && !strncmp(name, "statistics", len)) {
+        return NCM_STATISTICS;
+    }
+
+    return NCM_ALL;
+}
+
+/**
+ * @brief Update the cached capabilities and schemas, if the context has changed. Cache lock is expected to be held.
+ *
+ * @param[in] conn Sysrepo connection.
+ * @return 0 on success, -1 on error.
+ */
+static int
+ncm_cache_update(sr_conn_ctx_t *conn)
 {
     struct lyd_node *root = NULL, *cont, *list;
     const struct lys_module *mod;
-    sr_conn_ctx_t *conn;
     struct ly_ctx *ly_ctx;
     const char **cpblts;
-    char *time_str, buf[11];
-    uint32_t i;
+    uint32_t i, content_id;
+
+    content_id = sr_get_content_id(conn);
+    if (stats.cache && (stats.cache_content_id == content_id)) {
+        /* up-to-date */
+        return 0;
+    }
 
-    conn = sr_session_get_connection(session);
     ly_ctx = (struct ly_ctx *)sr_get_context(conn);
 
     if (lyd_new_path(NULL, ly_ctx, "/ietf-netconf-monitoring:netconf-state", NULL, 0, &root)) {
@@ -297,12 +422,6 @@ np2srv_ncm_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const cha
     }
     free(cpblts);
 
-    /* datastore locks */
-    lyd_new_inner(root, NULL, "datastores", 0, &cont);
-    ncm_data_add_ds_lock(conn, "running", SR_DS_RUNNING, cont);
-    ncm_data_add_ds_lock(conn, "startup", SR_DS_STARTUP, cont);
-    ncm_data_add_ds_lock(conn, "candidate", SR_DS_CANDIDATE, cont);
-
     /* schemas */
     lyd_new_inner(root, NULL, "schemas", 0, &cont);
 
@@ -317,13 +436,130 @@ np2srv_ncm_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const cha
         lyd_new_term(list, NULL, "location", "NETCONF", 0, NULL);
     }
 
-    /* sessions */
+    /* validate it only once */
+    if (lyd_validate_all(&root, NULL, LYD_VALIDATE_PRESENT, NULL)) {
+        goto error;
+    }
+
+    /* replace the cache */
+    lyd_free_tree(stats.cache);
+    stats.cache = root;
+    stats.cache_content_id = content_id;
+    return 0;
+
+error:
+    lyd_free_tree(root);
+    return -1;
+}
+
+/**
+ * @brief Add a copy of a cached netconf-state subtree, replacing any default one.
+ *
+ * @param[in] root netconf-state container to add to.
+ * @param[in] name Name of the subtree.
+ * @param[in] key Optional key value of the only list instances to copy.
+ * @param[in] key_len Length of @p key.
+ * @return 0 on success, -1 on error.
+ */
+static int
+ncm_cache_dup(struct lyd_node *root, const char *name, const char *key, size_t key_len)
+{
+    struct lyd_node *cached, *node, *dup;
+    const char *val;
+
+    LY_LIST_FOR(lyd_child(stats.cache), cached) {
+        if (!strcmp(cached->schema->name, name)) {
+            break;
+        }
+    }
+    if (!cached) {
+        EINT;
+        return -1;
+    }
+
+    /* remove the implicit container created by validation */
+    if (!lyd_find_sibling_val(lyd_child(root), cached->schema, NULL, 0, &node)) {
+        lyd_free_tree(node);
+    }
+
+    if (!key) {
+        /* whole subtree */
+        if (lyd_dup_single(cached, (struct lyd_node_inner *)root, LYD_DUP_RECURSIVE, NULL)) {
+            return -1;
+        }
+        return 0;
+    }
+
+    /* only the list instances with the first key matching */
+    if (lyd_dup_single(cached, (struct lyd_node_inner *)root, 0, &dup)) {
+        return -1;
+    }
+    LY_LIST_FOR(lyd_child(cached), node) {
+        val = lyd_get_value(lyd_child(node));
+        if (strncmp(val, key, key_len) || val[key_len]) {
+            continue;
+        }
+
+        if (lyd_dup_single(node, (struct lyd_node_inner *)dup, LYD_DUP_RECURSIVE, NULL)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int
+np2srv_ncm_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
+        const char *UNUSED(path), const char *request_xpath, uint32_t UNUSED(request_id),
+        struct lyd_node **parent, void *UNUSED(private_data))
+{
+    struct lyd_node *root = NULL, *cont, *list;
+    sr_conn_ctx_t *conn;
+    struct ly_ctx *ly_ctx;
+    struct ncm_counters counters;
+    const char *key;
+    char *time_str, buf[11];
+    uint32_t i, subtrees, nc_id = 0;
+    size_t key_len;
+    int r;
+
+    conn = sr_session_get_connection(session);
+    ly_ctx = (struct ly_ctx *)sr_get_context(conn);
+
+    /* build only the requested subtrees */
+    subtrees = ncm_requested_subtrees(request_xpath);
+    if (subtrees & NCM_SESSIONS) {
+        /* and only the requested session */
+        key = np_xpath_list_key_value(request_xpath, "/ietf-netconf-monitoring:netconf-state/sessions/session",
+                "session-id", &key_len);
+        if (key) {
+            nc_id = strtoul(key, NULL, 10);
+        }
+    }
+
+    if (lyd_new_path(NULL, ly_ctx, "/ietf-netconf-monitoring:netconf-state", NULL, 0, &root)) {
+        goto error;
+    }
+
+    if (subtrees & NCM_DATASTORES) {
+        /* datastore locks */
+        lyd_new_inner(root, NULL, "datastores", 0, &cont);
+        ncm_data_add_ds_lock(conn, "running", SR_DS_RUNNING, cont);
+        ncm_data_add_ds_lock(conn, "startup", SR_DS_STARTUP, cont);
+        ncm_data_add_ds_lock(conn, "candidate", SR_DS_CANDIDATE, cont);
+    }
+
     pthread_mutex_lock(&stats.lock);
 
-    if (stats.session_count) {
+    /* sessions */
+    if ((subtrees & NCM_SESSIONS) && stats.session_count) {
         lyd_new_inner(root, NULL, "sessions", 0, &cont);
 
         for (i = 0; i < stats.session_count; ++i) {
+            if (nc_id && (nc_session_get_id(stats.sessions[i]) != nc_id)) {
+                continue;
+            }
+
             sprintf(buf, "%u", nc_session_get_id(stats.sessions[i]));
             lyd_new_list(cont, NULL, "session", 0, &list, buf);
 
@@ -349,37 +585,42 @@ np2srv_ncm_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const cha
             lyd_new_term(list, NULL, "login-time", time_str, 0, NULL);
             free(time_str);
 
-            sprintf(buf, "%u", stats.session_stats[i].in_rpcs);
+            memset(&counters, 0, sizeof counters);
+            ncm_counters_add(&counters, stats.session_stats[i]);
+            sprintf(buf, "%" PRIu32, ncm_counter32(counters.in_rpcs));
             lyd_new_term(list, NULL, "in-rpcs", buf, 0, NULL);
-            sprintf(buf, "%u", stats.session_stats[i].in_bad_rpcs);
+            sprintf(buf, "%" PRIu32, ncm_counter32(counters.in_bad_rpcs));
             lyd_new_term(list, NULL, "in-bad-rpcs", buf, 0, NULL);
-            sprintf(buf, "%u", stats.session_stats[i].out_rpc_errors);
+            sprintf(buf, "%" PRIu32, ncm_counter32(counters.out_rpc_errors));
             lyd_new_term(list, NULL, "out-rpc-errors", buf, 0, NULL);
-            sprintf(buf, "%u", stats.session_stats[i].out_notifications);
+            sprintf(buf, "%" PRIu32, ncm_counter32(counters.out_notifications));
             lyd_new_term(list, NULL, "out-notifications", buf, 0, NULL);
         }
     }
 
     /* statistics */
-    lyd_new_inner(root, NULL, "statistics", 0, &cont);
-
-    ly_time_time2str(stats.netconf_start_time, NULL, &time_str);
-    lyd_new_term(cont, NULL, "netconf-start-time", time_str, 0, NULL);
-    free(time_str);
-    sprintf(buf, "%u", stats.in_bad_hellos);
-    lyd_new_term(cont, NULL, "in-bad-hellos", buf, 0, NULL);
-    sprintf(buf, "%u", stats.in_sessions);
-    lyd_new_term(cont, NULL, "in-sessions", buf, 0, NULL);
-    sprintf(buf, "%u", stats.dropped_sessions);
-    lyd_new_term(cont, NULL, "dropped-sessions", buf, 0, NULL);
-    sprintf(buf, "%u", stats.global_stats.in_rpcs);
-    lyd_new_term(cont, NULL, "in-rpcs", buf, 0, NULL);
-    sprintf(buf, "%u", stats.global_stats.in_bad_rpcs);
-    lyd_new_term(cont, NULL, "in-bad-rpcs", buf, 0, NULL);
-    sprintf(buf, "%u", stats.global_stats.out_rpc_errors);
-    lyd_new_term(cont, NULL, "out-rpc-errors", buf, 0, NULL);
-    sprintf(buf, "%u", stats.global_stats.out_notifications);
-    lyd_new_term(cont, NULL, "out-notifications", buf, 0, NULL);
+    if (subtrees & NCM_STATISTICS) {
+        lyd_new_inner(root, NULL, "statistics", 0, &cont);
+
+        ly_time_time2str(stats.netconf_start_time, NULL, &time_str);
+        lyd_new_term(cont, NULL, "netconf-start-time", time_str, 0, NULL);
+        free(time_str);
+        sprintf(buf, "%" PRIu32, ncm_counter32(ATOMIC_LOAD_RELAXED(stats.in_bad_hellos)));
+        lyd_new_term(cont, NULL, "in-bad-hellos", buf, 0, NULL);
+        sprintf(buf, "%" PRIu32, ncm_counter32(stats.in_sessions));
+        lyd_new_term(cont, NULL, "in-sessions", buf, 0, NULL);
+        sprintf(buf, "%" PRIu32, ncm_counter32(stats.dropped_sessions));
+        lyd_new_term(cont, NULL, "dropped-sessions", buf, 0, NULL);
+        ncm_global_counters(&counters);
+        sprintf(buf, "%" PRIu32, ncm_counter32(counters.in_rpcs));
+        lyd_new_term(cont, NULL, "in-rpcs", buf, 0, NULL);
+        sprintf(buf, "%" PRIu32, ncm_counter32(counters.in_bad_rpcs));
+        lyd_new_term(cont, NULL, "in-bad-rpcs", buf, 0, NULL);
+        sprintf(buf, "%" PRIu32, ncm_counter32(counters.out_rpc_errors));
+        lyd_new_term(cont, NULL, "out-rpc-errors", buf, 0, NULL);
+        sprintf(buf, "%" PRIu32, ncm_counter32(counters.out_notifications));
+        lyd_new_term(cont, NULL, "out-notifications", buf, 0, NULL);
+    }
 
     pthread_mutex_unlock(&stats.lock);
 
@@ -387,6 +628,24 @@ np2srv_ncm_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const cha
         goto error;
     }
 
+    if (subtrees & (NCM_CAPABILITIES | NCM_SCHEMAS)) {
+        /* cached capabilities and schemas, already valid */
+        pthread_mutex_lock(&stats.cache_lock);
+        r = ncm_cache_update(conn);
+        if (!r && (subtrees & NCM_CAPABILITIES)) {
+            r = ncm_cache_dup(root, "capabilities", NULL, 0);
+        }
+        if (!r && (subtrees & NCM_SCHEMAS)) {
+            key = np_xpath_list_key_value(request_xpath, "/ietf-netconf-monitoring:netconf-state/schemas/schema",
+                    "identifier", &key_len);
+            r = ncm_cache_dup(root, "schemas", key, key_len);
+        }
+        pthread_mutex_unlock(&stats.cache_lock);
+        if (r) {
+            goto error;
+        }
+    }
+
     *parent = root;
     return SR_ERR_OK;
 
@@ -16,29 +16,47 @@
 #define NP2SRV_NETCONF_MONITORING_H_
 
 #include <pthread.h>
+#include <stdint.h>
 
 #include <nc_server.h>
 #include <sysrepo.h>
 
+#include "compat.h"
+#include "metrics.h"
+
+/* counters of a single session, updated without any lock only by the threads using the session */
 struct ncm_session_stats {
-    uint32_t in_rpcs;
-    uint32_t in_bad_rpcs;
-    uint32_t out_rpc_errors;
-    uint32_t out_notifications;
+    ATOMIC64_T in_rpcs;
+    ATOMIC64_T in_bad_rpcs;
+    ATOMIC64_T out_rpc_errors;
+    ATOMIC64_T out_notifications;
+};
+
+/* snapshot of session counters */
+struct ncm_counters {
+    uint64_t in_rpcs;
+    uint64_t in_bad_rpcs;
+    uint64_t out_rpc_errors;
+    uint64_t out_notifications;
 };
 
 struct ncm {
     struct nc_session **sessions;
-    struct ncm_session_stats *session_stats;
+    struct ncm_session_stats **session_stats;   /* owned by the user sessions */
     uint32_t session_count;
 
     time_t netconf_start_time;
-    uint32_t in_bad_hellos;
-    uint32_t in_sessions;
-    uint32_t dropped_sessions;
-    struct ncm_session_stats global_stats;
+    ATOMIC64_T in_bad_hellos;
+    uint64_t in_sessions;
+    uint64_t dropped_sessions;
+    struct ncm_counters closed_stats;   /* summed counters of all the closed sessions */
 
     pthread_mutex_t lock;
+
+    /* cached capabilities and schemas, valid for a sysrepo content-id */
+    struct lyd_node *cache;
+    uint32_t cache_content_id;
+    pthread_mutex_t cache_lock;
 };
 
 void ncm_init(void);
@@ -52,7 +70,14 @@ void ncm_session_add(struct nc_session *session);
 void ncm_session_del(struct nc_session *session);
 void ncm_bad_hello(struct nc_session *session);
 
-uint32_t ncm_session_get_notification(struct nc_session *session);
+uint64_t ncm_session_get_notification(struct nc_session *session);
+
+/**
+ * @brief Print the monitoring counters as metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void ncm_metrics(struct np_metrics *m);
 
 int np2srv_ncm_oper_cb(sr_session_ctx_t *session, uint32_t sub_id, const char *module_name, const char *path,
         const char *request_xpath, uint32_t request_id, struct lyd_node **parent, void *private_data);
@@ -28,8 +28,11 @@
 #include "common.h"
 #include "compat.h"
 #include "config.h"
+#include "err_netconf.h"
+#include "filter_cache.h"
 #include "log.h"
 #include "netconf_acm.h"
+#include "stats.h"
 
 /**
  * @brief Perform origin filtering.
@@ -93,13 +96,13 @@ op_data_filter_origin(struct lyd_node **data, const struct lysc_ident *filter, i
 }
 
 int
-np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(op_path),
+np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *op_path,
         const struct lyd_node *input, sr_event_t event, uint32_t UNUSED(request_id), struct lyd_node *output,
         void *UNUSED(private_data))
 {
     struct lyd_node_term *leaf;
     struct lyd_node *node, *select_data = NULL, *data = NULL;
-    struct np2_filter filter = {0};
+    const struct np_filter_plan *plan = NULL;
     int rc = SR_ERR_OK;
     struct np2_user_sess *user_sess = NULL;
     uint32_t i, max_depth = 0;
@@ -108,12 +111,16 @@ np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
     NC_WD_MODE nc_wd;
     sr_get_oper_options_t get_opts = 0;
     const char *username;
+    struct timespec start;
 
     if (NP_IGNORE_RPC(session, event)) {
         /* ignore in this case */
         return SR_ERR_OK;
     }
 
+    /* measure the processing stages of this RPC */
+    np_stats_rpc_set(op_path + 1);
+
     /* get default value for with-defaults */
     nc_server_get_capab_withdefaults(&nc_wd, NULL);
 
@@ -129,7 +136,7 @@ np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
         ds = SR_DS_OPERATIONAL;
     } else {
         rc = SR_ERR_INVAL_ARG;
-        sr_session_set_error_message(session, "Datastore \"%s\" is not supported.", lyd_get_value(&leaf->node));
+        np_err_msg(session, "Datastore \"%s\" is not supported.", lyd_get_value(&leaf->node));
         goto cleanup;
     }
 
@@ -138,25 +145,12 @@ np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
     node = nodeset->count ? nodeset->dnodes[0] : NULL;
     ly_set_free(nodeset, NULL);
     if (node && !strcmp(node->schema->name, "subtree-filter")) {
-        if (op_filter_subtree2xpath(((struct lyd_node_any *)node)->value.tree, &filter)) {
-            rc = SR_ERR_INTERNAL;
-            goto cleanup;
-        }
+        rc = np_filter_plan_get((struct lyd_node_any *)node, NULL, &plan);
     } else {
-        filter.filters = malloc(sizeof *filter.filters);
-        if (!filter.filters) {
-            EMEM;
-            rc = SR_ERR_NO_MEMORY;
-            goto cleanup;
-        }
-        filter.count = 1;
-        filter.filters[0].str = node ? strdup(lyd_get_value(node)) : strdup("/*");
-        if (!filter.filters[0].str) {
-            EMEM;
-            rc = SR_ERR_NO_MEMORY;
-            goto cleanup;
-        }
-        filter.filters[0].selection = 1;
+        rc = np_filter_plan_get(NULL, node ? lyd_get_value(node) : "/*", &plan);
+    }
+    if (rc) {
+        goto cleanup;
     }
 
     /* config filter */
@@ -207,12 +201,17 @@ np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
     /*
      * create the data tree for the data reply
      */
-    if ((rc = op_filter_data_get(user_sess->sess, max_depth, get_opts, &filter, session, &select_data))) {
+    np_stats_stage_start(&start);
+    if ((rc = op_filter_data_get(user_sess->sess, max_depth, get_opts, &plan->filter, session, &select_data))) {
         goto cleanup;
     }
-    if ((rc = op_filter_data_filter(&select_data, &filter, 0, &data))) {
+    np_stats_stage_end(NP_STATS_DATA_GET, &start);
+
+    np_stats_stage_start(&start);
+    if ((rc = op_filter_data_filter(&select_data, &plan->filter, 0, &data))) {
         goto cleanup;
     }
+    np_stats_stage_end(NP_STATS_FILTER, &start);
 
     /* origin filter */
     lyd_find_xpath(input, "origin-filter | negated-origin-filter", &nodeset);
@@ -224,7 +223,9 @@ np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
 
     /* perform correct NACM filtering */
     sr_session_get_orig_data(session, 1, NULL, (const void **)&username);
+    np_stats_stage_start(&start);
     ncac_check_data_read_filter(&data, username);
+    np_stats_stage_end(NP_STATS_NACM_READ, &start);
 
     /* add output */
     if (lyd_new_any(output, NULL, "data", data, 1, LYD_ANYDATA_DATATREE, 1, NULL)) {
@@ -235,10 +236,11 @@ np2srv_rpc_getdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
     /* success */
 
 cleanup:
-    op_filter_erase(&filter);
+    np_filter_plan_release(plan);
     lyd_free_siblings(select_data);
     lyd_free_siblings(data);
     np_release_user_sess(user_sess);
+    np_stats_rpc_set(NULL);
     return rc;
 }
 
@@ -270,7 +272,7 @@ np2srv_rpc_editdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
         ds = SR_DS_CANDIDATE;
     } else {
         rc = SR_ERR_INVAL_ARG;
-        sr_session_set_error_message(session, "Datastore \"%s\" is not supported or writable.", lyd_get_value(&leaf->node));
+        np_err_msg(session, "Datastore \"%s\" is not supported or writable.", lyd_get_value(&leaf->node));
         goto cleanup;
     }
 
@@ -283,7 +285,8 @@ np2srv_rpc_editdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
     node = nodeset->dnodes[0];
     ly_set_free(nodeset, NULL);
     if (!strcmp(node->schema->name, "config")) {
-        config = op_parse_config((struct lyd_node_any *)node, LYD_PARSE_OPAQ | LYD_PARSE_ONLY, &rc, session);
+        /* input is not needed afterwards, take the config */
+        config = op_parse_config((struct lyd_node_any *)node, LYD_PARSE_OPAQ | LYD_PARSE_ONLY, 1, &rc, session);
         if (rc) {
             goto cleanup;
         }
@@ -296,7 +299,7 @@ np2srv_rpc_editdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
         }
 #else
         rc = SR_ERR_UNSUPPORTED;
-        sr_session_set_error_message(session, "URL not supported.");
+        np_err_msg(session, "URL not supported.");
         goto cleanup;
 #endif
     }
@@ -317,7 +320,7 @@ np2srv_rpc_editdata_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const
 
     rc = sr_apply_changes(user_sess->sess, np2srv.sr_timeout);
     if (rc != SR_ERR_OK) {
-        sr_session_dup_error(user_sess->sess, session);
+        np_err_dup(user_sess->sess, session);
         goto cleanup;
     }
 
@@ -113,7 +113,7 @@ np2srv_pubkey_auth_cb(const struct nc_session *session, ssh_key key, void *UNUSE
     f = fopen(line, "r");
     if (!f) {
         if (errno == ENOENT) {
-            VRB("User \"%s\" has no authorized_keys file.", username);
+            SUB_VRB(NP2LOG_TRANSPORT, "User \"%s\" has no authorized_keys file.", username);
         } else {
             ERR("Failed to open \"%s\" authorized_keys file (%s).", line, strerror(errno));
         }
@@ -431,7 +431,7 @@ np2srv_endpt_ssh_auth_users_oper_cb(sr_session_ctx_t *UNUSED(session), uint32_t
             }
 
             if (errno == EACCES) {
-                VRB("Skipping \"%s\" authorized key file (%s).", path, strerror(errno));
+                SUB_VRB(NP2LOG_TRANSPORT, "Skipping \"%s\" authorized key file (%s).", path, strerror(errno));
             }
 
             free(path);
@@ -18,6 +18,7 @@
 #include "netconf_subscribed_notifications.h"
 
 #include <assert.h>
+#include <inttypes.h>
 #include <pthread.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -33,6 +34,7 @@
 #include "log.h"
 #include "netconf_acm.h"
 #include "netconf_monitoring.h"
+#include "request_xpath.h"
 #include "subscribed_notifications.h"
 #include "yang_push.h"
 
@@ -114,6 +116,17 @@ error:
     return NULL;
 }
 
+void
+sub_ntf_lock(int write)
+{
+    /* LOCK */
+    if (write) {
+        pthread_rwlock_wrlock(&info.lock);
+    } else {
+        pthread_rwlock_rdlock(&info.lock);
+    }
+}
+
 void
 sub_ntf_unlock(void)
 {
@@ -161,6 +174,8 @@ sub_ntf_send_notif(struct nc_session *ncs, uint32_t nc_sub_id, struct timespec t
     if (ncac_check_operation(*ly_ntf, nc_session_get_username(ncs))) {
         /* denied */
         ATOMIC_INC_RELAXED(sub->denied_count);
+        SUB_DBG(NP2LOG_SUB_NTF, "Session %d: subscription %" PRIu32 " notification denied.", nc_session_get_id(ncs),
+                nc_sub_id);
 
         if (use_ntf) {
             /* free the notification since we are not using it */
@@ -216,6 +231,49 @@ sub_ntf_inc_denied(uint32_t nc_sub_id)
     ATOMIC_INC_RELAXED(sub->denied_count);
 }
 
+/**
+ * @brief Print a counter metric of all the subscriptions.
+ * sub-ntf lock is expected to be held.
+ *
+ * @param[in] m Metrics buffer.
+ * @param[in] name Metric family name.
+ * @param[in] help Metric description.
+ * @param[in] denied Whether to print the denied notifications counter, the sent notifications counter otherwise.
+ */
+static void
+sub_ntf_metrics_counter(struct np_metrics *m, const char *name, const char *help, int denied)
+{
+    struct np2srv_sub_ntf *sub;
+    const char *type;
+    uint32_t i;
+    uint64_t value;
+
+    np_metrics_family(m, name, "counter", help);
+    for (i = 0; i < info.count; ++i) {
+        sub = &info.subs[i];
+        type = (sub->type == SUB_TYPE_YANG_PUSH) ? "yang-push" : "subscribed-notifications";
+        value = denied ? ATOMIC_LOAD_RELAXED(sub->denied_count) : ATOMIC_LOAD_RELAXED(sub->sent_count);
+        np_metrics_printf(m, NP_METRICS_PREFIX "%s_total{id=\"%" PRIu32 "\",type=\"%s\"} %" PRIu64 "\n", name,
+                sub->nc_sub_id, type, value);
+    }
+}
+
+void
+sub_ntf_metrics(struct np_metrics *m)
+{
+    /* READ LOCK */
+    sub_ntf_lock(0);
+
+    np_metrics_gauge(m, "subscriptions", "Number of dynamic subscriptions.", info.count);
+    sub_ntf_metrics_counter(m, "subscription_sent_notifications", "Number of notifications sent for a subscription.",
+            0);
+    sub_ntf_metrics_counter(m, "subscription_denied_notifications",
+            "Number of notifications of a subscription denied by NACM.", 1);
+
+    /* UNLOCK */
+    sub_ntf_unlock();
+}
+
 /**
  * @brief Add a subscription into internal subscriptions.
  *
@@ -291,7 +349,28 @@ np2srv_sub_ntf_destroy(void)
             yang_push_terminate_async(info.subs[i].data);
             break;
         }
+        info.subs[i].terminating = 1;
+    }
+
+    /* UNLOCK */
+    pthread_rwlock_unlock(&info.lock);
+
+    /* wait for the tasks being executed, they may be waiting for the lock */
+    for (i = 0; i < info.count; ++i) {
+        switch (info.subs[i].type) {
+        case SUB_TYPE_SUB_NTF:
+            sub_ntf_terminate_wait(info.subs[i].data);
+            break;
+        case SUB_TYPE_YANG_PUSH:
+            yang_push_terminate_wait(info.subs[i].data);
+            break;
+        }
+    }
+
+    /* WRITE LOCK */
+    pthread_rwlock_wrlock(&info.lock);
 
+    for (i = 0; i < info.count; ++i) {
         free(info.subs[i].sub_ids);
         switch (info.subs[i].type) {
         case SUB_TYPE_SUB_NTF:
@@ -574,10 +653,12 @@ sub_ntf_terminate_sub(struct np2srv_sub_ntf *sub, struct nc_session *ncs)
     struct lyd_node *ly_ntf;
     char buf[11];
     uint32_t i, idx;
+    enum sub_ntf_type type;
+    void *data;
 
-    /* unsubscribe all sysrepo subscriptions */
+    /* unsubscribe all sysrepo subscriptions, yang-push subscriptions have none */
     for (i = 0; i < ATOMIC_LOAD_RELAXED(sub->sub_id_count); ++i) {
-        r = sr_unsubscribe_sub(np2srv.sr_notif_sub, sub->sub_ids[i]);
+        r = sr_unsubscribe_sub(*NP_NOTIF_SUB(sub->nc_id), sub->sub_ids[i]);
         if (r != SR_ERR_OK) {
             rc = r;
         }
@@ -595,6 +676,8 @@ sub_ntf_terminate_sub(struct np2srv_sub_ntf *sub, struct nc_session *ncs)
 
     /* handle corner cases when the asynchronous tasks have already started and are waiting for the lock */
     sub->terminating = 1;
+    type = sub->type;
+    data = sub->data;
 
     /* UNLOCK */
     pthread_rwlock_unlock(&info.lock);
@@ -602,6 +685,16 @@ sub_ntf_terminate_sub(struct np2srv_sub_ntf *sub, struct nc_session *ncs)
     /* give the tasks a chance to wake up */
     np_sleep(NP2SRV_SUB_NTF_TERMINATE_YIELD_SLEEP);
 
+    /* the data cannot be freed before the tasks already being executed finish */
+    switch (type) {
+    case SUB_TYPE_SUB_NTF:
+        sub_ntf_terminate_wait(data);
+        break;
+    case SUB_TYPE_YANG_PUSH:
+        yang_push_terminate_wait(data);
+        break;
+    }
+
     /* WRITE LOCK */
     pthread_rwlock_wrlock(&info.lock);
 
@@ -801,35 +894,49 @@ cleanup:
 
 int
 np2srv_oper_sub_ntf_streams_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
-        const char *UNUSED(path), const char *UNUSED(request_xpath), uint32_t UNUSED(request_id),
+        const char *UNUSED(path), const char *request_xpath, uint32_t UNUSED(request_id),
         struct lyd_node **parent, void *UNUSED(private_data))
 {
     struct lyd_node *root, *stream, *sr_data = NULL, *sr_mod, *rep_sup;
     sr_conn_ctx_t *conn;
     const struct ly_ctx *ly_ctx;
     const struct lys_module *mod;
-    const char *mod_name;
+    const struct np_mod_idx *mod_idx = NULL;
+    const char *mod_name, *name;
     char *buf;
+    size_t name_len;
     int rc;
 
     conn = sr_session_get_connection(session);
     ly_ctx = sr_get_context(conn);
 
+    /* only a single stream may be requested */
+    name = np_xpath_list_key_value(request_xpath, "/ietf-subscribed-notifications:streams/stream", "name", &name_len);
+
     if (lyd_new_path(NULL, ly_ctx, "/ietf-subscribed-notifications:streams", NULL, 0, &root)) {
         goto error;
     }
 
     /* generic stream */
-    if (lyd_new_path(root, NULL, "/ietf-subscribed-notifications:streams/stream[name='NETCONF']", NULL, 0, &stream)) {
-        goto error;
-    }
-    if (lyd_new_term(stream, stream->schema->module, "description",
-            "Default NETCONF stream containing notifications from all the modules."
-            " Replays only notifications for modules that support replay.", 0, NULL)) {
-        goto error;
-    }
-    if (lyd_new_term(stream, stream->schema->module, "replay-support", NULL, 0, NULL)) {
-        goto error;
+    if (!name || ((name_len == 7) && !strncmp(name, "NETCONF", 7))) {
+        if (lyd_new_path(root, NULL, "/ietf-subscribed-notifications:streams/stream[name='NETCONF']", NULL, 0,
+                &stream)) {
+            goto error;
+        }
+        if (lyd_new_term(stream, stream->schema->module, "description",
+                "Default NETCONF stream containing notifications from all the modules."
+                " Replays only notifications for modules that support replay.", 0, NULL)) {
+            goto error;
+        }
+        if (lyd_new_term(stream, stream->schema->module, "replay-support", NULL, 0, NULL)) {
+            goto error;
+        }
+
+        if (name) {
+            /* only the generic stream requested */
+            *parent = root;
+            return SR_ERR_OK;
+        }
     }
 
     /* go through all the sysrepo modules for individual streams */
@@ -838,18 +945,28 @@ np2srv_oper_sub_ntf_streams_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id
         ERR("Failed to get sysrepo module info data (%s).", sr_strerror(rc));
         goto error;
     }
+
+    /* modules with notifications */
+    mod_idx = np_mod_idx_get(conn);
+    if (!mod_idx) {
+        goto error;
+    }
     LY_LIST_FOR(lyd_child(sr_data), sr_mod) {
         if (strcmp(sr_mod->schema->name, "module")) {
             continue;
         }
 
         mod_name = lyd_get_value(lyd_child(sr_mod));
+        if (name && (strncmp(mod_name, name, name_len) || mod_name[name_len])) {
+            /* not requested */
+            continue;
+        }
 
         /* get the module */
         mod = ly_ctx_get_module_implemented(ly_ctx, mod_name);
         assert(mod);
 
-        if (!np_ly_mod_has_notif(mod)) {
+        if (!np_mod_idx_has(mod_idx->notif, mod_idx->notif_count, mod)) {
             /* no notifications in the module so do not consider it a stream */
             continue;
         }
@@ -876,11 +993,15 @@ np2srv_oper_sub_ntf_streams_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id
         }
     }
 
+    np_mod_idx_release();
     lyd_free_siblings(sr_data);
     *parent = root;
     return SR_ERR_OK;
 
 error:
+    if (mod_idx) {
+        np_mod_idx_release();
+    }
     lyd_free_tree(root);
     lyd_free_siblings(sr_data);
     return SR_ERR_INTERNAL;
@@ -888,18 +1009,28 @@ error:
 
 int
 np2srv_oper_sub_ntf_subscriptions_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
-        const char *UNUSED(path), const char *UNUSED(request_xpath), uint32_t UNUSED(request_id),
+        const char *UNUSED(path), const char *request_xpath, uint32_t UNUSED(request_id),
         struct lyd_node **parent, void *UNUSED(private_data))
 {
     const struct ly_ctx *ly_ctx;
     struct lyd_node *list, *receiver, *root;
     struct np2srv_sub_ntf *sub;
+    const char *key;
     char buf[26], *path = NULL, *datetime = NULL;
-    uint32_t i, excluded_count;
+    uint32_t i, nc_sub_id = 0;
+    uint64_t excluded_count;
+    size_t key_len;
     int rc = SR_ERR_OK;
 
     ly_ctx = sr_get_context(sr_session_get_connection(session));
 
+    /* only a single subscription may be requested */
+    key = np_xpath_list_key_value(request_xpath, "/ietf-subscribed-notifications:subscriptions/subscription", "id",
+            &key_len);
+    if (key) {
+        nc_sub_id = strtoul(key, NULL, 10);
+    }
+
     /* READ LOCK */
     pthread_rwlock_rdlock(&info.lock);
 
@@ -911,6 +1042,9 @@ np2srv_oper_sub_ntf_subscriptions_cb(sr_session_ctx_t *session, uint32_t UNUSED(
     /* go through all the subscriptions */
     for (i = 0; i < info.count; ++i) {
         sub = &info.subs[i];
+        if (nc_sub_id && (sub->nc_sub_id != nc_sub_id)) {
+            continue;
+        }
 
         /* subscription with id */
         sprintf(buf, "%" PRIu32, sub->nc_sub_id);
@@ -956,7 +1090,7 @@ np2srv_oper_sub_ntf_subscriptions_cb(sr_session_ctx_t *session, uint32_t UNUSED(
         receiver = lyd_child(receiver);
 
         /* sent-event-records */
-        sprintf(buf, "%" PRIu32, (uint32_t)ATOMIC_LOAD_RELAXED(sub->sent_count));
+        sprintf(buf, "%" PRIu64, (uint64_t)ATOMIC_LOAD_RELAXED(sub->sent_count));
         if (lyd_new_term(receiver, NULL, "sent-event-records", buf, 0, NULL)) {
             rc = SR_ERR_LY;
             goto cleanup;
@@ -975,7 +1109,7 @@ np2srv_oper_sub_ntf_subscriptions_cb(sr_session_ctx_t *session, uint32_t UNUSED(
         /* add denied */
         excluded_count += ATOMIC_LOAD_RELAXED(sub->denied_count);
 
-        sprintf(buf, "%" PRIu32, excluded_count);
+        sprintf(buf, "%" PRIu64, excluded_count);
         if (lyd_new_term(receiver, NULL, "excluded-event-records", buf, 0, NULL)) {
             rc = SR_ERR_LY;
             goto cleanup;
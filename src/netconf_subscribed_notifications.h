@@ -19,6 +19,7 @@
 #include <sysrepo.h>
 
 #include "common.h"
+#include "metrics.h"
 
 /**
  * @brief Type of a subscribed-notifications subscription.
@@ -45,8 +46,8 @@ struct np2srv_sub_ntf_info {
         struct timespec stop_time;
 
         int terminating;        /* set flag means the WRITE lock for this subscription will not be granted */
-        ATOMIC_T sent_count;    /* sent notifications counter */
-        ATOMIC_T denied_count;  /* counter of notifications denied by NACM */
+        ATOMIC64_T sent_count;      /* sent notifications counter */
+        ATOMIC64_T denied_count;    /* counter of notifications denied by NACM */
 
         enum sub_ntf_type type;
         void *data;
@@ -68,6 +69,13 @@ struct np2srv_sub_ntf_info {
  */
 struct np2srv_sub_ntf *sub_ntf_find_lock(uint32_t nc_sub_id, int write);
 
+/**
+ * @brief Lock the sub-ntf lock.
+ *
+ * @param[in] write Whether to write or read-lock.
+ */
+void sub_ntf_lock(int write);
+
 /**
  * @brief Unlock the sub-ntf lock.
  */
@@ -112,6 +120,13 @@ void sub_ntf_cb_lock_pass(uint32_t sub_id);
  */
 void sub_ntf_inc_denied(uint32_t nc_sub_id);
 
+/**
+ * @brief Print the subscription counters as metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void sub_ntf_metrics(struct np_metrics *m);
+
 /**
  * @brief Correctly terminate a ntf-sub subscription.
  * ntf-sub lock is expected to be held.
@@ -0,0 +1,398 @@
+/**
+ * @file oper_cache.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief cache of operational state data shared by get requests
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "oper_cache.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "compat.h"
+#include "config.h"
+#include "err_netconf.h"
+#include "log.h"
+
+/**
+ * @brief Operational state data selected by a single filter.
+ */
+struct np_oper_cache_entry {
+    char *xpath;
+    struct timespec time;       /* start time of the retrieval (NP_CLOCK_ID) */
+    struct lyd_node *data;      /* retrieved data, never modified */
+    int pending;                /* data are being retrieved */
+    int valid;                  /* data were retrieved successfully */
+    int linked;                 /* entry is in the cache */
+    uint32_t ref_count;         /* requests using the entry, cache lock */
+
+    struct np_oper_cache_entry *prev;
+    struct np_oper_cache_entry *next;
+};
+
+/**
+ * @brief Operational state data cache, the entries are ordered from the most recently used.
+ */
+static struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;        /* signalled when a retrieval finishes */
+    struct np_oper_cache_entry *first;
+    struct np_oper_cache_entry *last;
+    uint32_t count;
+
+    ATOMIC64_T hits;
+    ATOMIC64_T misses;
+    ATOMIC64_T coalesced;
+    ATOMIC64_T evictions;
+} oper_cache = {.lock = PTHREAD_MUTEX_INITIALIZER, .cond = PTHREAD_COND_INITIALIZER};
+
+/**
+ * @brief Get operational state data from sysrepo.
+ *
+ * @param[in] session Sysrepo session switched to the operational datastore.
+ * @param[in] xpath Filter selecting the data.
+ * @param[in] ev_sess Event sysrepo session for errors.
+ * @param[out] data Retrieved data.
+ * @return Sysrepo error value.
+ */
+static int
+np_oper_cache_sr_get(sr_session_ctx_t *session, const char *xpath, sr_session_ctx_t *ev_sess, struct lyd_node **data)
+{
+    const sr_error_info_t *err_info;
+    int rc;
+
+    rc = sr_get_data(session, xpath, 0, np2srv.sr_timeout, SR_OPER_NO_CONFIG, data);
+    if (rc) {
+        ERR("Getting data \"%s\" from sysrepo failed (%s).", xpath, sr_strerror(rc));
+        sr_session_get_error(session, &err_info);
+        np_err_msg(ev_sess, "%s", err_info->err[0].message);
+    }
+
+    return rc;
+}
+
+/**
+ * @brief Free a cache entry.
+ *
+ * @param[in] entry Cache entry to free.
+ */
+static void
+np_oper_cache_entry_free(struct np_oper_cache_entry *entry)
+{
+    free(entry->xpath);
+    lyd_free_siblings(entry->data);
+    free(entry);
+}
+
+/**
+ * @brief Remove an entry from the cache, it is freed once not used by any request.
+ * Cache lock held.
+ *
+ * @param[in] entry Cache entry to remove.
+ */
+static void
+np_oper_cache_entry_unlink(struct np_oper_cache_entry *entry)
+{
+    if (entry->prev) {
+        entry->prev->next = entry->next;
+    } else {
+        oper_cache.first = entry->next;
+    }
+    if (entry->next) {
+        entry->next->prev = entry->prev;
+    } else {
+        oper_cache.last = entry->prev;
+    }
+    entry->prev = NULL;
+    entry->next = NULL;
+    entry->linked = 0;
+    --oper_cache.count;
+
+    if (!entry->ref_count) {
+        np_oper_cache_entry_free(entry);
+    }
+}
+
+/**
+ * @brief Insert an entry as the most recently used one.
+ * Cache lock held.
+ *
+ * @param[in] entry Cache entry to insert.
+ */
+static void
+np_oper_cache_entry_insert(struct np_oper_cache_entry *entry)
+{
+    entry->prev = NULL;
+    entry->next = oper_cache.first;
+    if (oper_cache.first) {
+        oper_cache.first->prev = entry;
+    } else {
+        oper_cache.last = entry;
+    }
+    oper_cache.first = entry;
+    entry->linked = 1;
+    ++oper_cache.count;
+}
+
+/**
+ * @brief Check whether the data of an entry are too old to be shared.
+ *
+ * @param[in] entry Cache entry.
+ * @param[in] now Current time.
+ * @return Whether the entry is expired or not.
+ */
+static int
+np_oper_cache_entry_expired(const struct np_oper_cache_entry *entry, const struct timespec *now)
+{
+    return !entry->pending && (np_difftimespec(&entry->time, now) >= NP2SRV_OPER_CACHE_MAX_AGE);
+}
+
+/**
+ * @brief Remove all the expired entries and then the least recently used entries over the size limit.
+ * Cache lock held.
+ *
+ * @param[in] now Current time.
+ */
+static void
+np_oper_cache_evict(const struct timespec *now)
+{
+    struct np_oper_cache_entry *entry, *next;
+
+    for (entry = oper_cache.first; entry; entry = next) {
+        next = entry->next;
+        if (np_oper_cache_entry_expired(entry, now)) {
+            np_oper_cache_entry_unlink(entry);
+        }
+    }
+
+    while (oper_cache.count > NP2SRV_OPER_CACHE_SIZE) {
+        np_oper_cache_entry_unlink(oper_cache.last);
+        ATOMIC_INC_RELAXED(oper_cache.evictions);
+    }
+}
+
+/**
+ * @brief Release an entry used by a request.
+ * Cache lock held.
+ *
+ * @param[in] entry Cache entry.
+ */
+static void
+np_oper_cache_entry_release(struct np_oper_cache_entry *entry)
+{
+    --entry->ref_count;
+
+    if (entry->linked && !entry->valid && !entry->pending) {
+        /* failed retrieval */
+        np_oper_cache_entry_unlink(entry);
+    } else if (!entry->ref_count && !entry->linked) {
+        np_oper_cache_entry_free(entry);
+    }
+}
+
+/**
+ * @brief Get operational state data selected by a single filter, from the cache if possible.
+ *
+ * @param[in] session Sysrepo session switched to the operational datastore.
+ * @param[in] xpath Filter selecting the data.
+ * @param[in] ev_sess Event sysrepo session for errors.
+ * @param[out] data Retrieved data.
+ * @return Sysrepo error value.
+ */
+static int
+np_oper_cache_get(sr_session_ctx_t *session, const char *xpath, sr_session_ctx_t *ev_sess, struct lyd_node **data)
+{
+    struct np_oper_cache_entry *entry;
+    struct lyd_node *entry_data = NULL;
+    struct timespec now;
+    int rc = SR_ERR_OK, valid;
+
+    *data = NULL;
+
+    /* LOCK */
+    pthread_mutex_lock(&oper_cache.lock);
+
+    /* find the entry */
+    now = np_gettimespec();
+    for (entry = oper_cache.first; entry; entry = entry->next) {
+        if (!strcmp(entry->xpath, xpath)) {
+            break;
+        }
+    }
+    if (entry && np_oper_cache_entry_expired(entry, &now)) {
+        /* too old, retrieve the data again */
+        np_oper_cache_entry_unlink(entry);
+        entry = NULL;
+    }
+
+    if (entry) {
+        /* make it the most recently used */
+        ++entry->ref_count;
+        np_oper_cache_entry_unlink(entry);
+        np_oper_cache_entry_insert(entry);
+
+        if (entry->pending) {
+            /* wait for the concurrent retrieval */
+            ATOMIC_INC_RELAXED(oper_cache.coalesced);
+            while (entry->pending) {
+                pthread_cond_wait(&oper_cache.cond, &oper_cache.lock);
+            }
+        } else {
+            ATOMIC_INC_RELAXED(oper_cache.hits);
+        }
+        valid = entry->valid;
+
+        /* UNLOCK */
+        pthread_mutex_unlock(&oper_cache.lock);
+
+        if (valid && entry->data && lyd_dup_siblings(entry->data, NULL, LYD_DUP_RECURSIVE | LYD_DUP_WITH_FLAGS, data)) {
+            rc = SR_ERR_LY;
+        }
+
+        /* LOCK */
+        pthread_mutex_lock(&oper_cache.lock);
+
+        np_oper_cache_entry_release(entry);
+
+        /* UNLOCK */
+        pthread_mutex_unlock(&oper_cache.lock);
+
+        if (!valid) {
+            /* the concurrent retrieval failed, try again with the errors reported for this request */
+            rc = np_oper_cache_sr_get(session, xpath, ev_sess, data);
+        }
+        return rc;
+    }
+
+    /* retrieve the data into a new entry */
+    ATOMIC_INC_RELAXED(oper_cache.misses);
+    entry = calloc(1, sizeof *entry);
+    if (entry) {
+        entry->xpath = strdup(xpath);
+    }
+    if (!entry || !entry->xpath) {
+        /* UNLOCK */
+        pthread_mutex_unlock(&oper_cache.lock);
+
+        free(entry);
+        EMEM;
+        return SR_ERR_NO_MEMORY;
+    }
+    entry->time = now;
+    entry->pending = 1;
+    entry->ref_count = 1;
+    np_oper_cache_entry_insert(entry);
+
+    /* make room for it */
+    np_oper_cache_evict(&now);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&oper_cache.lock);
+
+    rc = np_oper_cache_sr_get(session, xpath, ev_sess, &entry_data);
+    if (!rc && entry_data && lyd_dup_siblings(entry_data, NULL, LYD_DUP_RECURSIVE | LYD_DUP_WITH_FLAGS, data)) {
+        rc = SR_ERR_LY;
+    }
+
+    /* LOCK */
+    pthread_mutex_lock(&oper_cache.lock);
+
+    entry->pending = 0;
+    if (!rc) {
+        entry->data = entry_data;
+        entry->valid = 1;
+    } else {
+        lyd_free_siblings(entry_data);
+    }
+    pthread_cond_broadcast(&oper_cache.cond);
+    np_oper_cache_entry_release(entry);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&oper_cache.lock);
+
+    return rc;
+}
+
+int
+np_oper_cache_data_get(sr_session_ctx_t *session, const struct np2_filter *filter, sr_session_ctx_t *ev_sess,
+        struct lyd_node **data)
+{
+    struct lyd_node *node;
+    uint32_t i;
+    int rc;
+
+    if (!NP2SRV_OPER_CACHE_MAX_AGE || !NP2SRV_OPER_CACHE_SIZE) {
+        /* no cache */
+        return op_filter_data_get(session, 0, SR_OPER_NO_CONFIG, filter, ev_sess, data);
+    }
+
+    for (i = 0; i < filter->count; ++i) {
+        /* get the selected data */
+        if ((rc = np_oper_cache_get(session, filter->filters[i].str, ev_sess, &node))) {
+            return rc;
+        }
+
+        /* merge */
+        if (lyd_merge_siblings(data, node, LYD_MERGE_DESTRUCT)) {
+            lyd_free_siblings(node);
+            return SR_ERR_LY;
+        }
+    }
+
+    return SR_ERR_OK;
+}
+
+void
+np_oper_cache_destroy(void)
+{
+    /* LOCK */
+    pthread_mutex_lock(&oper_cache.lock);
+
+    while (oper_cache.first) {
+        np_oper_cache_entry_unlink(oper_cache.first);
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&oper_cache.lock);
+}
+
+void
+np_oper_cache_metrics(struct np_metrics *m)
+{
+    uint32_t count;
+
+    /* LOCK */
+    pthread_mutex_lock(&oper_cache.lock);
+
+    count = oper_cache.count;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&oper_cache.lock);
+
+    np_metrics_gauge(m, "oper_cache_entries", "Number of cached operational state data snapshots.", count);
+    np_metrics_counter(m, "oper_cache_hits", "Number of operational state data retrievals served from the cache.",
+            ATOMIC_LOAD_RELAXED(oper_cache.hits));
+    np_metrics_counter(m, "oper_cache_misses", "Number of operational state data retrieved from sysrepo.",
+            ATOMIC_LOAD_RELAXED(oper_cache.misses));
+    np_metrics_counter(m, "oper_cache_coalesced", "Number of operational state data retrievals that waited for "
+            "a concurrent identical retrieval.", ATOMIC_LOAD_RELAXED(oper_cache.coalesced));
+    np_metrics_counter(m, "oper_cache_evictions", "Number of cached operational state data evicted because of the "
+            "size limit.", ATOMIC_LOAD_RELAXED(oper_cache.evictions));
+}
@@ -0,0 +1,51 @@
+/**
+ * @file oper_cache.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief cache of operational state data shared by get requests header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_OPER_CACHE_H_
+#define NP2SRV_OPER_CACHE_H_
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "metrics.h"
+
+/**
+ * @brief Get operational state data (without configuration) selected by filters and merge them into a data tree.
+ * Data of every filter not older than the maximum age are shared by all the requests and concurrent identical
+ * requests wait for a single retrieval. At most the cache size of the most recently used data are kept. Without
+ * a maximum age or cache size, the data are always retrieved.
+ *
+ * @param[in] session Sysrepo session switched to the operational datastore.
+ * @param[in] filter Filters selecting the data.
+ * @param[in] ev_sess Event sysrepo session for errors.
+ * @param[in,out] data Data tree to merge the data into.
+ * @return Sysrepo error value.
+ */
+int np_oper_cache_data_get(sr_session_ctx_t *session, const struct np2_filter *filter, sr_session_ctx_t *ev_sess,
+        struct lyd_node **data);
+
+/**
+ * @brief Free all the cached data.
+ */
+void np_oper_cache_destroy(void);
+
+/**
+ * @brief Print the cache metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void np_oper_cache_metrics(struct np_metrics *m);
+
+#endif /* NP2SRV_OPER_CACHE_H_ */
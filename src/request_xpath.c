@@ -0,0 +1,253 @@
+/**
+ * @file request_xpath.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief parsing of request XPaths of operational callbacks
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "request_xpath.h"
+
+#include <ctype.h>
+#include <string.h>
+
+/**
+ * @brief Learn the length of a node name with an optional prefix.
+ *
+ * @param[in] xpath Path pointing to the name.
+ * @return Length of the name, 0 if there is no valid name.
+ */
+static size_t
+np_xpath_name_len(const char *xpath)
+{
+    size_t len;
+    int prefix = 0;
+
+    if (!isalpha(xpath[0]) && (xpath[0] != '_')) {
+        return 0;
+    }
+
+    for (len = 1; xpath[len]; ++len) {
+        if (xpath[len] == ':') {
+            if (prefix || (!isalpha(xpath[len + 1]) && (xpath[len + 1] != '_'))) {
+                return 0;
+            }
+            prefix = 1;
+        } else if (!isalnum(xpath[len]) && (xpath[len] != '_') && (xpath[len] != '-') && (xpath[len] != '.')) {
+            break;
+        }
+    }
+
+    return len;
+}
+
+/**
+ * @brief Skip the prefix of a node name.
+ *
+ * @param[in,out] name Node name, is moved after the prefix.
+ * @param[in,out] len Length of @p name, is adjusted.
+ */
+static void
+np_xpath_skip_prefix(const char **name, size_t *len)
+{
+    const char *colon;
+
+    colon = memchr(*name, ':', *len);
+    if (colon) {
+        ++colon;
+        *len -= colon - *name;
+        *name = colon;
+    }
+}
+
+/**
+ * @brief Parse a single node name of a simple path.
+ *
+ * @param[in] xpath Path pointing to the leading '/'.
+ * @param[out] name Node name without a prefix.
+ * @param[out] name_len Length of @p name.
+ * @return Path following the node name, NULL if there is no simple node.
+ */
+static const char *
+np_xpath_parse_name(const char *xpath, const char **name, size_t *name_len)
+{
+    size_t len;
+
+    if (xpath[0] != '/') {
+        return NULL;
+    }
+    ++xpath;
+
+    len = np_xpath_name_len(xpath);
+    if (!len || (xpath[len] && (xpath[len] != '/') && (xpath[len] != '['))) {
+        /* not a simple node name */
+        return NULL;
+    }
+
+    *name = xpath;
+    *name_len = len;
+    np_xpath_skip_prefix(name, name_len);
+    return xpath + len;
+}
+
+/**
+ * @brief Parse a predicate of a simple path in the form of "[key='literal']" or "[key="literal"]".
+ *
+ * @param[in] xpath Path pointing to the '['.
+ * @param[out] key Key name without a prefix.
+ * @param[out] key_len Length of @p key.
+ * @param[out] value Literal value.
+ * @param[out] value_len Length of @p value.
+ * @return Path following the predicate, NULL if it is not a simple predicate.
+ */
+static const char *
+np_xpath_parse_pred(const char *xpath, const char **key, size_t *key_len, const char **value, size_t *value_len)
+{
+    const char *end;
+    size_t len;
+
+    if (xpath[0] != '[') {
+        return NULL;
+    }
+    ++xpath;
+
+    /* key name, optionally with a prefix */
+    len = np_xpath_name_len(xpath);
+    if (!len || (xpath[len] != '=')) {
+        return NULL;
+    }
+    *key = xpath;
+    *key_len = len;
+    np_xpath_skip_prefix(key, key_len);
+    xpath += len + 1;
+
+    /* quoted literal followed by the end of the predicate */
+    if ((xpath[0] != '\'') && (xpath[0] != '\"')) {
+        return NULL;
+    }
+    end = strchr(xpath + 1, xpath[0]);
+    if (!end || (end[1] != ']')) {
+        return NULL;
+    }
+    *value = xpath + 1;
+    *value_len = end - (xpath + 1);
+
+    return end + 2;
+}
+
+/**
+ * @brief Skip all the predicates of a node, they must all be simple.
+ *
+ * @param[in] xpath Path following the node name.
+ * @return Path following the predicates, NULL if any of them is not simple.
+ */
+static const char *
+np_xpath_skip_preds(const char *xpath)
+{
+    const char *key, *value;
+    size_t key_len, value_len;
+
+    while (xpath && (xpath[0] == '[')) {
+        xpath = np_xpath_parse_pred(xpath, &key, &key_len, &value, &value_len);
+    }
+
+    return xpath;
+}
+
+/**
+ * @brief Match a request XPath against a simple path, node by node, ignoring prefixes. The nodes of the path
+ * must have no predicates because they could refer to nodes not created, and the rest of the request XPath
+ * must consist only of simple nodes and predicates referring to the nodes in the narrowed subtree.
+ *
+ * @param[in] request_xpath Requested XPath.
+ * @param[in] path Simple path.
+ * @return Request XPath following the last node of @p path, NULL if not matched.
+ */
+static const char *
+np_xpath_match_path(const char *request_xpath, const char *path)
+{
+    const char *rx, *tail, *name, *rname;
+    size_t len, rlen;
+
+    if (!request_xpath) {
+        return NULL;
+    }
+
+    rx = request_xpath;
+    while (path[0]) {
+        path = np_xpath_parse_name(path, &name, &len);
+        rx = np_xpath_parse_name(rx, &rname, &rlen);
+        if (!path || !rx || (len != rlen) || strncmp(name, rname, len)) {
+            return NULL;
+        }
+
+        if (path[0] && (rx[0] == '[')) {
+            /* a predicate of a parent node */
+            return NULL;
+        }
+    }
+
+    /* the rest of the request must not select any other nodes */
+    tail = np_xpath_skip_preds(rx);
+    while (tail && tail[0]) {
+        tail = np_xpath_parse_name(tail, &name, &len);
+        tail = tail ? np_xpath_skip_preds(tail) : NULL;
+    }
+    if (!tail) {
+        return NULL;
+    }
+
+    return rx;
+}
+
+const char *
+np_xpath_child_name(const char *request_xpath, const char *path, size_t *name_len)
+{
+    const char *rx, *name;
+
+    rx = np_xpath_match_path(request_xpath, path);
+    if (!rx || (rx[0] == '[')) {
+        /* not matched or a predicate of the parent node */
+        return NULL;
+    }
+
+    if (!np_xpath_parse_name(rx, &name, name_len)) {
+        return NULL;
+    }
+
+    return name;
+}
+
+const char *
+np_xpath_list_key_value(const char *request_xpath, const char *list_path, const char *key, size_t *value_len)
+{
+    const char *rx, *pred_key, *value;
+    size_t key_len, len;
+
+    rx = np_xpath_match_path(request_xpath, list_path);
+    if (!rx) {
+        return NULL;
+    }
+
+    while (rx[0] == '[') {
+        rx = np_xpath_parse_pred(rx, &pred_key, &key_len, &value, &len);
+        if (!rx) {
+            return NULL;
+        }
+
+        if ((key_len == strlen(key)) && !strncmp(pred_key, key, key_len)) {
+            *value_len = len;
+            return value;
+        }
+    }
+
+    return NULL;
+}
@@ -0,0 +1,49 @@
+/**
+ * @file request_xpath.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief parsing of request XPaths of operational callbacks header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_REQUEST_XPATH_H_
+#define NP2SRV_REQUEST_XPATH_H_
+
+#include <stddef.h>
+
+/*
+ * The operational callbacks may create only the data selected by the request XPath. Only a request XPath
+ * of simple child nodes with predicates in the form of "[key='literal']" is understood, any other XPath
+ * selects all the data. Note that get requests are always widened to whole modules ("/mod:*") so the data
+ * are narrowed only for get-data and other sysrepo readers.
+ */
+
+/**
+ * @brief Learn the child node selected by a request XPath of an operational callback.
+ *
+ * @param[in] request_xpath Requested XPath, may be NULL.
+ * @param[in] path Simple path with a prefix only in the first node, such as "/mod:cont/list".
+ * @param[out] name_len Length of the returned name.
+ * @return Name of the child of @p path selected by @p request_xpath, NULL if none or the XPath is too complex.
+ */
+const char *np_xpath_child_name(const char *request_xpath, const char *path, size_t *name_len);
+
+/**
+ * @brief Learn the key value of the list instance selected by a request XPath of an operational callback.
+ *
+ * @param[in] request_xpath Requested XPath, may be NULL.
+ * @param[in] list_path Simple path of the list with a prefix only in the first node, such as "/mod:cont/list".
+ * @param[in] key Name of the key.
+ * @param[out] value_len Length of the returned value.
+ * @return Value of @p key selected by @p request_xpath, NULL if none or the XPath is too complex.
+ */
+const char *np_xpath_list_key_value(const char *request_xpath, const char *list_path, const char *key,
+        size_t *value_len);
+
+#endif /* NP2SRV_REQUEST_XPATH_H_ */
@@ -0,0 +1,522 @@
+/**
+ * @file stats.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief RPC latency statistics
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "stats.h"
+
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "compat.h"
+#include "log.h"
+#include "stats_hist.h"
+
+/* index of the RPC for all the RPCs over the limit */
+#define STATS_RPC_OTHER 0
+
+/* no RPC is being processed */
+#define STATS_RPC_NONE UINT32_MAX
+
+/**
+ * @brief Statistics of a single thread, written only by the thread.
+ */
+struct np_stats_thread {
+    pthread_mutex_t lock;       /* protects hist, never contended by the owner thread */
+    struct np_stats_hist hist[NP2SRV_STATS_RPC_MAX][NP_STATS_STAGE_COUNT];
+
+    /* owner thread only */
+    uint32_t rpc_idx;           /* processed RPC */
+    struct timespec rpc_start;  /* when the RPC was received */
+    struct timespec reply_start;    /* when the RPC reply was created */
+    int reply_pending;          /* RPC reply is being sent */
+
+    int dead;                   /* the owner thread has terminated, stats lock */
+    struct np_stats_thread *next;
+};
+
+/**
+ * @brief Latency statistics of all the threads.
+ */
+static struct {
+    char *rpcs[NP2SRV_STATS_RPC_MAX];   /* RPC names, index 0 is for all the other RPCs */
+    ATOMIC_T rpc_count;
+    struct np_stats_thread *threads;
+
+    pthread_mutex_t lock;
+    pthread_key_t key;
+    pthread_once_t key_once;
+} stats = {.rpc_count = 1, .lock = PTHREAD_MUTEX_INITIALIZER, .key_once = PTHREAD_ONCE_INIT};
+
+/**
+ * @brief Stage names, as in the netopeer2-server module.
+ */
+static const char *stats_stage_name[NP_STATS_STAGE_COUNT] = {"nacm", "execution", "data-get", "filter", "nacm-read",
+    "reply", "total"};
+
+/**
+ * @brief Destructor of thread statistics, they are kept for another thread.
+ *
+ * @param[in] arg Thread statistics.
+ */
+static void
+np_stats_thread_release(void *arg)
+{
+    struct np_stats_thread *thr = arg;
+
+    /* LOCK */
+    pthread_mutex_lock(&stats.lock);
+
+    thr->dead = 1;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&stats.lock);
+}
+
+/**
+ * @brief Create the thread statistics key.
+ */
+static void
+np_stats_key_create(void)
+{
+    pthread_key_create(&stats.key, np_stats_thread_release);
+}
+
+/**
+ * @brief Get statistics of this thread, if it has any.
+ *
+ * @return Thread statistics, NULL if none.
+ */
+static struct np_stats_thread *
+np_stats_thread_find(void)
+{
+    pthread_once(&stats.key_once, np_stats_key_create);
+
+    return pthread_getspecific(stats.key);
+}
+
+/**
+ * @brief Get statistics of this thread.
+ *
+ * @return Thread statistics, NULL on error.
+ */
+static struct np_stats_thread *
+np_stats_thread_get(void)
+{
+    struct np_stats_thread *thr;
+
+    thr = np_stats_thread_find();
+    if (thr) {
+        return thr;
+    }
+
+    /* LOCK */
+    pthread_mutex_lock(&stats.lock);
+
+    /* reuse statistics of a terminated thread, the counters are only summed */
+    for (thr = stats.threads; thr && !thr->dead; thr = thr->next) {}
+    if (thr) {
+        thr->dead = 0;
+    } else {
+        thr = calloc(1, sizeof *thr);
+        if (!thr) {
+            /* UNLOCK */
+            pthread_mutex_unlock(&stats.lock);
+            EMEM;
+            return NULL;
+        }
+        pthread_mutex_init(&thr->lock, NULL);
+        thr->next = stats.threads;
+        stats.threads = thr;
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&stats.lock);
+
+    thr->rpc_idx = STATS_RPC_NONE;
+    thr->reply_pending = 0;
+    pthread_setspecific(stats.key, thr);
+    return thr;
+}
+
+void
+np2srv_stats_destroy(void)
+{
+    struct np_stats_thread *thr, *next;
+    uint32_t i;
+
+    /* LOCK */
+    pthread_mutex_lock(&stats.lock);
+
+    for (thr = stats.threads; thr; thr = next) {
+        next = thr->next;
+        pthread_mutex_destroy(&thr->lock);
+        free(thr);
+    }
+    stats.threads = NULL;
+
+    for (i = 1; i < ATOMIC_LOAD_RELAXED(stats.rpc_count); ++i) {
+        free(stats.rpcs[i]);
+        stats.rpcs[i] = NULL;
+    }
+    ATOMIC_STORE_RELAXED(stats.rpc_count, 1);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&stats.lock);
+}
+
+/**
+ * @brief Get the index of an RPC, it is added if not yet known.
+ *
+ * @param[in] rpc RPC name with its module.
+ * @return RPC index.
+ */
+static uint32_t
+np_stats_rpc_idx(const char *rpc)
+{
+    uint32_t i, count;
+
+    /* names are never changed once added */
+    count = ATOMIC_LOAD_ACQUIRE(stats.rpc_count);
+    for (i = 1; i < count; ++i) {
+        if (!strcmp(stats.rpcs[i], rpc)) {
+            return i;
+        }
+    }
+
+    /* LOCK */
+    pthread_mutex_lock(&stats.lock);
+
+    /* it could have been added meanwhile */
+    count = ATOMIC_LOAD_RELAXED(stats.rpc_count);
+    for ( ; i < count; ++i) {
+        if (!strcmp(stats.rpcs[i], rpc)) {
+            break;
+        }
+    }
+    if (i == count) {
+        if ((count < NP2SRV_STATS_RPC_MAX) && (stats.rpcs[count] = strdup(rpc))) {
+            ATOMIC_STORE_RELEASE(stats.rpc_count, count + 1);
+        } else {
+            i = STATS_RPC_OTHER;
+        }
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&stats.lock);
+
+    return i;
+}
+
+/**
+ * @brief Account a measured time to the RPC processed by a thread.
+ *
+ * @param[in] thr Thread statistics.
+ * @param[in] stage Measured stage.
+ * @param[in] start Start time.
+ * @param[in] end End time.
+ */
+static void
+np_stats_add(struct np_stats_thread *thr, enum np_stats_stage stage, const struct timespec *start,
+        const struct timespec *end)
+{
+    struct np_stats_hist *hist;
+    int64_t usec;
+    uint32_t value;
+
+    usec = ((int64_t)end->tv_sec - start->tv_sec) * 1000000L + (end->tv_nsec - start->tv_nsec) / 1000L;
+    if (usec < 0) {
+        usec = 0;
+    } else if (usec > UINT32_MAX) {
+        usec = UINT32_MAX;
+    }
+    value = usec;
+
+    hist = &thr->hist[thr->rpc_idx][stage];
+
+    /* LOCK */
+    pthread_mutex_lock(&thr->lock);
+
+    np_stats_hist_add(hist, value);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&thr->lock);
+}
+
+void
+np_stats_rpc_set(const char *rpc)
+{
+    struct np_stats_thread *thr;
+
+    thr = rpc ? np_stats_thread_get() : np_stats_thread_find();
+    if (!thr) {
+        return;
+    }
+
+    thr->rpc_idx = rpc ? np_stats_rpc_idx(rpc) : STATS_RPC_NONE;
+}
+
+void
+np_stats_rpc_begin(const struct lyd_node *rpc)
+{
+    struct np_stats_thread *thr;
+    char buf[256];
+
+    thr = np_stats_thread_get();
+    if (!thr) {
+        return;
+    }
+
+    snprintf(buf, sizeof buf, "%s:%s", rpc->schema->module->name, LYD_NAME(rpc));
+    thr->rpc_idx = np_stats_rpc_idx(buf);
+    thr->rpc_start = np_gettimespec();
+    thr->reply_pending = 0;
+}
+
+void
+np_stats_rpc_end(void)
+{
+    struct np_stats_thread *thr;
+
+    thr = np_stats_thread_find();
+    if (!thr || (thr->rpc_idx == STATS_RPC_NONE)) {
+        return;
+    }
+
+    thr->reply_start = np_gettimespec();
+    thr->reply_pending = 1;
+}
+
+void
+np_stats_rpc_replied(void)
+{
+    struct np_stats_thread *thr;
+    struct timespec end;
+
+    thr = np_stats_thread_find();
+    if (!thr || !thr->reply_pending) {
+        return;
+    }
+
+    end = np_gettimespec();
+    np_stats_add(thr, NP_STATS_REPLY, &thr->reply_start, &end);
+    np_stats_add(thr, NP_STATS_TOTAL, &thr->rpc_start, &end);
+
+    thr->rpc_idx = STATS_RPC_NONE;
+    thr->reply_pending = 0;
+}
+
+void
+np_stats_stage_start(struct timespec *start)
+{
+    *start = np_gettimespec();
+}
+
+void
+np_stats_stage_end(enum np_stats_stage stage, const struct timespec *start)
+{
+    struct np_stats_thread *thr;
+    struct timespec end;
+
+    thr = np_stats_thread_find();
+    if (!thr || (thr->rpc_idx == STATS_RPC_NONE)) {
+        /* not processing an RPC */
+        return;
+    }
+
+    end = np_gettimespec();
+    np_stats_add(thr, stage, start, &end);
+}
+
+/**
+ * @brief Sum the histograms of all the threads. Stats lock is expected to be held.
+ *
+ * @param[in] rpc_idx RPC index.
+ * @param[in] stage Measured stage.
+ * @param[out] hist Summed histogram.
+ */
+static void
+np_stats_hist_sum(uint32_t rpc_idx, enum np_stats_stage stage, struct np_stats_hist *hist)
+{
+    struct np_stats_thread *thr;
+    const struct np_stats_hist *thr_hist;
+
+    memset(hist, 0, sizeof *hist);
+
+    for (thr = stats.threads; thr; thr = thr->next) {
+        thr_hist = &thr->hist[rpc_idx][stage];
+
+        /* LOCK */
+        pthread_mutex_lock(&thr->lock);
+
+        np_stats_hist_merge(hist, thr_hist);
+
+        /* UNLOCK */
+        pthread_mutex_unlock(&thr->lock);
+    }
+}
+
+/**
+ * @brief Get the name of an RPC. Stats lock is expected to be held.
+ *
+ * @param[in] rpc_idx RPC index.
+ * @return RPC name.
+ */
+static const char *
+np_stats_rpc_name(uint32_t rpc_idx)
+{
+    return (rpc_idx == STATS_RPC_OTHER) ? "other" : stats.rpcs[rpc_idx];
+}
+
+void
+np_stats_print(void)
+{
+    struct np_stats_hist hist;
+    uint32_t i, stage;
+
+    /* LOCK */
+    pthread_mutex_lock(&stats.lock);
+
+    for (i = 0; i < ATOMIC_LOAD_RELAXED(stats.rpc_count); ++i) {
+        for (stage = 0; stage < NP_STATS_STAGE_COUNT; ++stage) {
+            np_stats_hist_sum(i, stage, &hist);
+            if (!hist.count) {
+                continue;
+            }
+
+            /* explicitly requested, print regardless of the verbose level */
+            np2log_sub_printf(NP2LOG_STATS, NC_VERB_VERBOSE, "RPC \"%s\" stage \"%s\": count %" PRIu64 ", total %"
+                    PRIu64 " us, p50 %" PRIu32 " us, p90 %" PRIu32 " us, p99 %" PRIu32 " us, max %" PRIu32 " us.",
+                    np_stats_rpc_name(i), stats_stage_name[stage], hist.count, hist.sum,
+                    np_stats_hist_percentile(&hist, 50), np_stats_hist_percentile(&hist, 90),
+                    np_stats_hist_percentile(&hist, 99), hist.max);
+        }
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&stats.lock);
+}
+
+/**
+ * @brief Add a histogram as operational data.
+ *
+ * @param[in] parent RPC list instance.
+ * @param[in] stage Measured stage.
+ * @param[in] hist Histogram to add.
+ * @return 0 on success, -1 on error.
+ */
+static int
+np_stats_oper_hist(struct lyd_node *parent, enum np_stats_stage stage, const struct np_stats_hist *hist)
+{
+    struct lyd_node *list, *bucket;
+    char buf[21];
+    uint32_t i;
+
+    if (lyd_new_list(parent, NULL, "stage", 0, &list, stats_stage_name[stage])) {
+        return -1;
+    }
+
+#define NP_STATS_OPER_TERM(name, format, value) \
+    sprintf(buf, format, value); \
+    if (lyd_new_term(list, NULL, name, buf, 0, NULL)) { \
+        return -1; \
+    }
+
+    NP_STATS_OPER_TERM("count", "%" PRIu64, hist->count);
+    NP_STATS_OPER_TERM("total-time", "%" PRIu64, hist->sum);
+    NP_STATS_OPER_TERM("max-time", "%" PRIu32, hist->max);
+    NP_STATS_OPER_TERM("p50-time", "%" PRIu32, np_stats_hist_percentile(hist, 50));
+    NP_STATS_OPER_TERM("p90-time", "%" PRIu32, np_stats_hist_percentile(hist, 90));
+    NP_STATS_OPER_TERM("p99-time", "%" PRIu32, np_stats_hist_percentile(hist, 99));
+
+#undef NP_STATS_OPER_TERM
+
+    /* non-empty buckets */
+    for (i = 0; i < STATS_BUCKETS; ++i) {
+        if (!hist->buckets[i]) {
+            continue;
+        }
+
+        sprintf(buf, "%" PRIu32, np_stats_bucket_low(i));
+        if (lyd_new_list(list, NULL, "bucket", 0, &bucket, buf)) {
+            return -1;
+        }
+        sprintf(buf, "%" PRIu32, hist->buckets[i]);
+        if (lyd_new_term(bucket, NULL, "count", buf, 0, NULL)) {
+            return -1;
+        }
+    }
+
+    return 0;
+}
+
+int
+np2srv_stats_oper_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *UNUSED(module_name),
+        const char *UNUSED(path), const char *UNUSED(request_xpath), uint32_t UNUSED(request_id),
+        struct lyd_node **parent, void *UNUSED(private_data))
+{
+    const struct ly_ctx *ly_ctx;
+    struct lyd_node *root = NULL, *list;
+    struct np_stats_hist hist;
+    uint32_t i, stage;
+    int rc = SR_ERR_OK;
+
+    ly_ctx = sr_get_context(sr_session_get_connection(session));
+
+    if (lyd_new_path(NULL, ly_ctx, "/netopeer2-server:rpc-statistics", NULL, 0, &root)) {
+        return SR_ERR_LY;
+    }
+
+    /* LOCK */
+    pthread_mutex_lock(&stats.lock);
+
+    for (i = 0; i < ATOMIC_LOAD_RELAXED(stats.rpc_count); ++i) {
+        list = NULL;
+        for (stage = 0; stage < NP_STATS_STAGE_COUNT; ++stage) {
+            np_stats_hist_sum(i, stage, &hist);
+            if (!hist.count) {
+                continue;
+            }
+
+            if (!list && lyd_new_list(root, NULL, "rpc", 0, &list, np_stats_rpc_name(i))) {
+                rc = SR_ERR_LY;
+                goto cleanup;
+            }
+            if (np_stats_oper_hist(list, stage, &hist)) {
+                rc = SR_ERR_LY;
+                goto cleanup;
+            }
+        }
+    }
+
+cleanup:
+    /* UNLOCK */
+    pthread_mutex_unlock(&stats.lock);
+
+    if (rc) {
+        lyd_free_tree(root);
+    } else {
+        *parent = root;
+    }
+    return rc;
+}
@@ -0,0 +1,93 @@
+/**
+ * @file stats.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief RPC latency statistics header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_STATS_H_
+#define NP2SRV_STATS_H_
+
+#include <time.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+/**
+ * @brief Measured stages of RPC processing.
+ */
+enum np_stats_stage {
+    NP_STATS_NACM = 0,      /**< NACM check of the operation */
+    NP_STATS_EXEC,          /**< sysrepo RPC execution */
+    NP_STATS_DATA_GET,      /**< data retrieval from sysrepo */
+    NP_STATS_FILTER,        /**< data filtering */
+    NP_STATS_NACM_READ,     /**< NACM filtering of read data */
+    NP_STATS_REPLY,         /**< reply serialization and sending */
+    NP_STATS_TOTAL,         /**< whole RPC processing */
+
+    NP_STATS_STAGE_COUNT    /**< number of stages */
+};
+
+/**
+ * @brief Free all the statistics.
+ */
+void np2srv_stats_destroy(void);
+
+/**
+ * @brief Set the RPC processed by this thread, all the measured stages are accounted to it.
+ *
+ * @param[in] rpc RPC name with its module, NULL if no RPC is processed anymore.
+ */
+void np_stats_rpc_set(const char *rpc);
+
+/**
+ * @brief Start processing an RPC in this thread, all the measured stages are accounted to it.
+ *
+ * @param[in] rpc Received RPC.
+ */
+void np_stats_rpc_begin(const struct lyd_node *rpc);
+
+/**
+ * @brief RPC reply was created, its serialization and sending follows.
+ */
+void np_stats_rpc_end(void);
+
+/**
+ * @brief RPC reply was sent, finish processing the RPC in this thread.
+ */
+void np_stats_rpc_replied(void);
+
+/**
+ * @brief Get the start time of a measured stage.
+ *
+ * @param[out] start Start time.
+ */
+void np_stats_stage_start(struct timespec *start);
+
+/**
+ * @brief Account a measured stage to the RPC processed by this thread, if any.
+ *
+ * @param[in] stage Measured stage.
+ * @param[in] start Start time of the stage.
+ */
+void np_stats_stage_end(enum np_stats_stage stage, const struct timespec *start);
+
+/**
+ * @brief Print the statistics of all the RPCs into the log.
+ */
+void np_stats_print(void);
+
+/**
+ * @brief Provide the statistics as operational data.
+ */
+int np2srv_stats_oper_cb(sr_session_ctx_t *session, uint32_t sub_id, const char *module_name, const char *path,
+        const char *request_xpath, uint32_t request_id, struct lyd_node **parent, void *private_data);
+
+#endif /* NP2SRV_STATS_H_ */
@@ -0,0 +1,97 @@
+/**
+ * @file stats_hist.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief latency histograms of RPC statistics
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "stats_hist.h"
+
+#include <stdint.h>
+
+uint32_t
+np_stats_bucket(uint32_t value)
+{
+    uint32_t msb;
+
+    if (value < STATS_SUB_COUNT) {
+        /* linear buckets for the smallest values */
+        return value;
+    }
+
+    msb = 31 - __builtin_clz(value);
+    return ((msb - STATS_SUB_BITS + 1) << STATS_SUB_BITS) + ((value >> (msb - STATS_SUB_BITS)) & (STATS_SUB_COUNT - 1));
+}
+
+uint32_t
+np_stats_bucket_low(uint32_t bucket)
+{
+    uint32_t msb;
+
+    if (bucket < STATS_SUB_COUNT) {
+        return bucket;
+    }
+
+    msb = (bucket >> STATS_SUB_BITS) + STATS_SUB_BITS - 1;
+    return (STATS_SUB_COUNT + (bucket & (STATS_SUB_COUNT - 1))) << (msb - STATS_SUB_BITS);
+}
+
+void
+np_stats_hist_add(struct np_stats_hist *hist, uint32_t value)
+{
+    ++hist->buckets[np_stats_bucket(value)];
+    ++hist->count;
+    hist->sum += value;
+    if (value > hist->max) {
+        hist->max = value;
+    }
+}
+
+void
+np_stats_hist_merge(struct np_stats_hist *hist, const struct np_stats_hist *src)
+{
+    uint32_t i;
+
+    if (!src->count) {
+        return;
+    }
+
+    for (i = 0; i < STATS_BUCKETS; ++i) {
+        hist->buckets[i] += src->buckets[i];
+    }
+    hist->count += src->count;
+    hist->sum += src->sum;
+    if (src->max > hist->max) {
+        hist->max = src->max;
+    }
+}
+
+uint32_t
+np_stats_hist_percentile(const struct np_stats_hist *hist, uint32_t percent)
+{
+    uint64_t target, count = 0;
+    uint32_t i;
+
+    target = (hist->count * percent + 99) / 100;
+    for (i = 0; i < STATS_BUCKETS; ++i) {
+        count += hist->buckets[i];
+        if (count >= target) {
+            break;
+        }
+    }
+    if ((i >= STATS_BUCKETS - 1) || (np_stats_bucket_low(i + 1) - 1 > hist->max)) {
+        /* the maximum is more precise */
+        return hist->max;
+    }
+
+    return np_stats_bucket_low(i + 1) - 1;
+}
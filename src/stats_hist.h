@@ -0,0 +1,78 @@
+/**
+ * @file stats_hist.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief latency histograms of RPC statistics header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_STATS_HIST_H_
+#define NP2SRV_STATS_HIST_H_
+
+#include <stdint.h>
+
+/* number of bits of a value used for the linear sub-buckets of every power of 2 */
+#define STATS_SUB_BITS 2
+#define STATS_SUB_COUNT (1 << STATS_SUB_BITS)
+
+/* number of buckets covering all the 32-bit values */
+#define STATS_BUCKETS ((32 - STATS_SUB_BITS + 1) << STATS_SUB_BITS)
+
+/**
+ * @brief Latency histogram with logarithmic buckets split into linear sub-buckets, values in microseconds.
+ */
+struct np_stats_hist {
+    uint32_t buckets[STATS_BUCKETS];
+    uint64_t count;
+    uint64_t sum;
+    uint32_t max;
+};
+
+/**
+ * @brief Get the histogram bucket of a value.
+ *
+ * @param[in] value Value to bucket.
+ * @return Bucket index.
+ */
+uint32_t np_stats_bucket(uint32_t value);
+
+/**
+ * @brief Get the lowest value of a histogram bucket.
+ *
+ * @param[in] bucket Bucket index.
+ * @return Lowest value in the bucket.
+ */
+uint32_t np_stats_bucket_low(uint32_t bucket);
+
+/**
+ * @brief Add a value into a histogram.
+ *
+ * @param[in] hist Histogram.
+ * @param[in] value Value to add.
+ */
+void np_stats_hist_add(struct np_stats_hist *hist, uint32_t value);
+
+/**
+ * @brief Add all the values of a histogram into another one.
+ *
+ * @param[in] hist Histogram to add to.
+ * @param[in] src Histogram to add.
+ */
+void np_stats_hist_merge(struct np_stats_hist *hist, const struct np_stats_hist *src);
+
+/**
+ * @brief Get a percentile of a histogram.
+ *
+ * @param[in] hist Histogram.
+ * @param[in] percent Percentile to get.
+ * @return Highest value of the bucket with the percentile.
+ */
+uint32_t np_stats_hist_percentile(const struct np_stats_hist *hist, uint32_t percent);
+
+#endif /* NP2SRV_STATS_HIST_H_ */
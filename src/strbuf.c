@@ -0,0 +1,104 @@
+/**
+ * @file strbuf.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief growable string buffer
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "strbuf.h"
+
+#include <assert.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "log.h"
+
+int
+np_strbuf_reserve(struct np_strbuf *sbuf, size_t len)
+{
+    size_t new_size;
+    char *mem;
+
+    if (sbuf->len + len < sbuf->size) {
+        return 0;
+    }
+
+    new_size = sbuf->size ? sbuf->size : 64;
+    while (sbuf->len + len >= new_size) {
+        new_size *= 2;
+    }
+
+    mem = realloc(sbuf->buf, new_size);
+    if (!mem) {
+        EMEM;
+        return -1;
+    }
+    sbuf->buf = mem;
+    sbuf->size = new_size;
+
+    return 0;
+}
+
+int
+np_strbuf_append(struct np_strbuf *sbuf, const char *str)
+{
+    size_t len = strlen(str);
+
+    if (np_strbuf_reserve(sbuf, len)) {
+        return -1;
+    }
+
+    memcpy(sbuf->buf + sbuf->len, str, len + 1);
+    sbuf->len += len;
+    return 0;
+}
+
+int
+np_strbuf_printf(struct np_strbuf *sbuf, const char *format, ...)
+{
+    va_list ap;
+    int len;
+
+    va_start(ap, format);
+    len = vsnprintf(sbuf->buf ? sbuf->buf + sbuf->len : NULL, sbuf->size - sbuf->len, format, ap);
+    va_end(ap);
+    if (len < 0) {
+        return -1;
+    }
+
+    if (sbuf->len + len >= sbuf->size) {
+        /* enlarge the buffer and print again */
+        if (np_strbuf_reserve(sbuf, len)) {
+            return -1;
+        }
+
+        va_start(ap, format);
+        vsnprintf(sbuf->buf + sbuf->len, sbuf->size - sbuf->len, format, ap);
+        va_end(ap);
+    }
+
+    sbuf->len += len;
+    return 0;
+}
+
+void
+np_strbuf_truncate(struct np_strbuf *sbuf, size_t len)
+{
+    assert(len <= sbuf->len);
+
+    sbuf->len = len;
+    if (sbuf->buf) {
+        sbuf->buf[len] = '\0';
+    }
+}
@@ -0,0 +1,65 @@
+/**
+ * @file strbuf.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief growable string buffer header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_STRBUF_H_
+#define NP2SRV_STRBUF_H_
+
+#include <stddef.h>
+
+/**
+ * @brief Growable string with a cached length, the buffer is doubled when enlarged. Zeroed structure is an empty
+ * string and the buffer is freed by the caller.
+ */
+struct np_strbuf {
+    char *buf;      /* string, NULL if nothing was appended */
+    size_t len;     /* length of the string */
+    size_t size;    /* size of the buffer */
+};
+
+/**
+ * @brief Make sure a string buffer can fit additional characters.
+ *
+ * @param[in] sbuf String buffer.
+ * @param[in] len Number of characters to fit, without the terminating zero.
+ * @return 0 on success, -1 on error.
+ */
+int np_strbuf_reserve(struct np_strbuf *sbuf, size_t len);
+
+/**
+ * @brief Append a string to a string buffer.
+ *
+ * @param[in] sbuf String buffer.
+ * @param[in] str String to append.
+ * @return 0 on success, -1 on error.
+ */
+int np_strbuf_append(struct np_strbuf *sbuf, const char *str);
+
+/**
+ * @brief Append a formatted string to a string buffer.
+ *
+ * @param[in] sbuf String buffer.
+ * @param[in] format Format of the string to append.
+ * @return 0 on success, -1 on error.
+ */
+int np_strbuf_printf(struct np_strbuf *sbuf, const char *format, ...);
+
+/**
+ * @brief Truncate a string buffer to a previous length, the buffer is kept.
+ *
+ * @param[in] sbuf String buffer.
+ * @param[in] len Length to truncate to.
+ */
+void np_strbuf_truncate(struct np_strbuf *sbuf, size_t len);
+
+#endif /* NP2SRV_STRBUF_H_ */
@@ -82,66 +82,73 @@ cleanup:
  * @param[in] stop Subscription stop time.
  * @param[in] private_data User data to set when subscribing.
  * @param[in] ev_sess Event session for reporting errors.
+ * @param[in] sub_ctx Subscription context to use.
  * @param[out] sub_ids Generated sysrepo subscription IDs, the first one is used as sub-ntf subscription ID.
  * @param[out] sub_id_count Number of @p sub_ids.
  * @return Sysrepo error value.
  */
 static int
 sub_ntf_sr_subscribe(sr_session_ctx_t *user_sess, const char *stream, const char *xpath, time_t start,
-        time_t stop, void *private_data, sr_session_ctx_t *ev_sess, uint32_t **sub_ids, uint32_t *sub_id_count)
+        time_t stop, void *private_data, sr_session_ctx_t *ev_sess, sr_subscription_ctx_t **sub_ctx, uint32_t **sub_ids,
+        uint32_t *sub_id_count)
 {
-    const struct ly_ctx *ly_ctx = sr_get_context(sr_session_get_connection(user_sess));
-    const struct lys_module *ly_mod;
+    const struct np_mod_idx *mod_idx;
+    const struct lys_module **mods = NULL;
     int rc;
     const sr_error_info_t *err_info;
-    uint32_t idx;
-    void *mem;
+    uint32_t idx, mod_count;
 
     *sub_ids = NULL;
     *sub_id_count = 0;
 
     if (!strcmp(stream, "NETCONF")) {
-        /* subscribe to all modules with notifications */
-        idx = 0;
-        while ((ly_mod = ly_ctx_get_module_iter(ly_ctx, &idx))) {
-            if (!ly_mod->implemented) {
-                continue;
-            }
-
-            if (np_ly_mod_has_notif(ly_mod)) {
-                /* allocate a new sub ID */
-                mem = realloc(*sub_ids, (*sub_id_count + 1) * sizeof **sub_ids);
-                if (!mem) {
-                    EMEM;
-                    rc = SR_ERR_NO_MEMORY;
-                    goto error;
-                }
-                *sub_ids = mem;
-
-                /* a notification was found, subscribe to the module */
-                rc = sr_event_notif_subscribe_tree(user_sess, ly_mod->name, xpath, start, stop, np2srv_rpc_establish_sub_ntf_cb,
-                        private_data, SR_SUBSCR_CTX_REUSE, &np2srv.sr_notif_sub);
-                if (rc != SR_ERR_OK) {
-                    sr_session_get_error(user_sess, &err_info);
-                    sr_session_set_error_message(ev_sess, err_info->err[0].message);
-                    goto error;
-                }
+        /* learn all modules with notifications, do not keep the index locked while subscribing */
+        mod_idx = np_mod_idx_get(sr_session_get_connection(user_sess));
+        if (!mod_idx) {
+            rc = SR_ERR_INTERNAL;
+            goto error;
+        }
+        mod_count = mod_idx->notif_count;
+        mods = malloc(mod_count * sizeof *mods);
+        *sub_ids = malloc(mod_count * sizeof **sub_ids);
+        if (mod_count && (!mods || !*sub_ids)) {
+            np_mod_idx_release();
+            EMEM;
+            rc = SR_ERR_NO_MEMORY;
+            goto error;
+        }
+        if (mod_count) {
+            memcpy(mods, mod_idx->notif, mod_count * sizeof *mods);
+        }
+        np_mod_idx_release();
 
-                /* add new sub ID */
-                (*sub_ids)[*sub_id_count] = sr_subscription_get_last_sub_id(np2srv.sr_notif_sub);
-                ++(*sub_id_count);
+        /* subscribe to all of them */
+        for (idx = 0; idx < mod_count; ++idx) {
+            rc = sr_event_notif_subscribe_tree(user_sess, mods[idx]->name, xpath, start, stop,
+                    np2srv_rpc_establish_sub_ntf_cb, private_data, SR_SUBSCR_CTX_REUSE, sub_ctx);
+            if (rc != SR_ERR_OK) {
+                sr_session_get_error(user_sess, &err_info);
+                sr_session_set_error_message(ev_sess, err_info->err[0].message);
+                goto error;
             }
+
+            /* add new sub ID */
+            (*sub_ids)[*sub_id_count] = sr_subscription_get_last_sub_id(*sub_ctx);
+            ++(*sub_id_count);
         }
+        free(mods);
     } else {
         /* allocate a new single sub ID */
         *sub_ids = malloc(sizeof **sub_ids);
         if (!*sub_ids) {
+            EMEM;
+            rc = SR_ERR_NO_MEMORY;
             goto error;
         }
 
         /* subscribe to the specific module (stream) */
         rc = sr_event_notif_subscribe_tree(user_sess, stream, xpath, start, stop, np2srv_rpc_establish_sub_ntf_cb, private_data,
-                SR_SUBSCR_CTX_REUSE, &np2srv.sr_notif_sub);
+                SR_SUBSCR_CTX_REUSE, sub_ctx);
         if (rc != SR_ERR_OK) {
             sr_session_get_error(user_sess, &err_info);
             sr_session_set_error_message(ev_sess, err_info->err[0].message);
@@ -149,15 +156,16 @@ sub_ntf_sr_subscribe(sr_session_ctx_t *user_sess, const char *stream, const char
         }
 
         /* add new sub ID */
-        (*sub_ids)[0] = sr_subscription_get_last_sub_id(np2srv.sr_notif_sub);
+        (*sub_ids)[0] = sr_subscription_get_last_sub_id(*sub_ctx);
         *sub_id_count = 1;
     }
 
     return SR_ERR_OK;
 
 error:
+    free(mods);
     for (idx = 0; idx < *sub_id_count; ++idx) {
-        sr_unsubscribe_sub(np2srv.sr_notif_sub, (*sub_ids)[idx]);
+        sr_unsubscribe_sub(*sub_ctx, (*sub_ids)[idx]);
     }
     free(*sub_ids);
     *sub_ids = NULL;
@@ -351,7 +359,7 @@ sub_ntf_rpc_establish_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc,
     /* subscribe to sysrepo notifications, cb_arg is managed (freed) by the callback */
     sub_id_count = 0;
     rc = sub_ntf_sr_subscribe(user_sess->sess, stream, xp, start, sub->stop_time.tv_sec, &sn_data->cb_arg, ev_sess,
-            &sub->sub_ids, &sub_id_count);
+            NP_NOTIF_SUB(sub->nc_id), &sub->sub_ids, &sub_id_count);
     ATOMIC_STORE_RELAXED(sub->sub_id_count, sub_id_count);
     if (rc != SR_ERR_OK) {
         goto cleanup;
@@ -396,7 +404,7 @@ sub_ntf_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc, st
     }
 
     /* learn the current filter */
-    rc = sr_event_notif_sub_get_info(np2srv.sr_notif_sub, nc_sub_id, NULL, &cur_xp, NULL, &cur_stop, NULL);
+    rc = sr_event_notif_sub_get_info(*NP_NOTIF_SUB(sub->nc_id), nc_sub_id, NULL, &cur_xp, NULL, &cur_stop, NULL);
     if (rc != SR_ERR_OK) {
         goto cleanup;
     }
@@ -406,7 +414,7 @@ sub_ntf_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc, st
         for (i = 0; i < sub->sub_id_count; ++i) {
             /* "pass" the lock to the callback */
             sub_ntf_cb_lock_pass(sub->sub_ids[i]);
-            rc = sr_event_notif_sub_modify_xpath(np2srv.sr_notif_sub, sub->sub_ids[i], xp);
+            rc = sr_event_notif_sub_modify_xpath(*NP_NOTIF_SUB(sub->nc_id), sub->sub_ids[i], xp);
             if (rc != SR_ERR_OK) {
                 goto cleanup;
             }
@@ -417,7 +425,7 @@ sub_ntf_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc, st
         for (i = 0; i < sub->sub_id_count; ++i) {
             /* "pass" the lock to the callback */
             sub_ntf_cb_lock_pass(sub->sub_ids[i]);
-            rc = sr_event_notif_sub_modify_stop_time(np2srv.sr_notif_sub, sub->sub_ids[i], stop.tv_sec);
+            rc = sr_event_notif_sub_modify_stop_time(*NP_NOTIF_SUB(sub->nc_id), sub->sub_ids[i], stop.tv_sec);
             if (rc != SR_ERR_OK) {
                 goto cleanup;
             }
@@ -518,7 +526,7 @@ sub_ntf_config_filters(sr_session_ctx_t *ev_sess, const struct lyd_node *filter,
             for (i = 0; i < sub->sub_id_count; ++i) {
                 /* "pass" the lock to the callback */
                 sub_ntf_cb_lock_pass(sub->sub_ids[i]);
-                r = sr_event_notif_sub_modify_xpath(np2srv.sr_notif_sub, sub->sub_ids[i], xp);
+                r = sr_event_notif_sub_modify_xpath(*NP_NOTIF_SUB(sub->nc_id), sub->sub_ids[i], xp);
                 if (r != SR_ERR_OK) {
                     rc = r;
                 }
@@ -601,7 +609,8 @@ sub_ntf_oper_receiver_excluded(struct np2srv_sub_ntf *sub)
     /* excluded-event-records */
     for (i = 0; i < ATOMIC_LOAD_RELAXED(sub->sub_id_count); ++i) {
         /* get filter-out count for the subscription */
-        r = sr_event_notif_sub_get_info(np2srv.sr_notif_sub, sub->sub_ids[i], NULL, NULL, NULL, NULL, &filtered_out);
+        r = sr_event_notif_sub_get_info(*NP_NOTIF_SUB(sub->nc_id), sub->sub_ids[i], NULL, NULL, NULL, NULL,
+                &filtered_out);
         if (r != SR_ERR_OK) {
             return r;
         }
@@ -618,6 +627,13 @@ sub_ntf_terminate_async(void *data)
     (void)data;
 }
 
+void
+sub_ntf_terminate_wait(void *data)
+{
+    /* there are no asynchronous tasks except for the sysrepo subscriptions */
+    (void)data;
+}
+
 void
 sub_ntf_data_destroy(void *data)
 {
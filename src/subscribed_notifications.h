@@ -120,6 +120,14 @@ uint32_t sub_ntf_oper_receiver_excluded(struct np2srv_sub_ntf *sub);
  */
 void sub_ntf_terminate_async(void *data);
 
+/**
+ * @brief Wait for the terminated asynchronous tasks that are being executed now to finish so that the data
+ * can be freed. sub-ntf lock must not be held because the tasks may be waiting for it.
+ *
+ * @param[in] data Type-specific data.
+ */
+void sub_ntf_terminate_wait(void *data);
+
 /**
  * @brief Free type-specific data.
  *
@@ -0,0 +1,575 @@
+/**
+ * @file timer_wheel.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief central hierarchical timer wheel
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#define _GNU_SOURCE
+
+#include "timer_wheel.h"
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "common.h"
+#include "compat.h"
+#include "log.h"
+
+/* number of bits of a tick used for indexing one level, determines the number of slots in a level */
+#define TW_LVL_BITS 6
+#define TW_LVL_SIZE (1 << TW_LVL_BITS)
+#define TW_LVL_MASK (TW_LVL_SIZE - 1)
+#define TW_LVL_COUNT 4
+
+/* maximum number of ticks a timer can be scheduled in advance, later timers are cascaded again */
+#define TW_MAX_TICKS ((1ULL << (TW_LVL_BITS * TW_LVL_COUNT)) - 1)
+
+/* timer flags */
+#define TW_TIMER_ARMED 0x01     /**< timer is in a wheel slot */
+#define TW_TIMER_QUEUED 0x02    /**< timer expired and is waiting for a thread */
+
+/**
+ * @brief Hierarchical timer wheel, level 0 has the resolution of a single tick and every next level
+ * has the resolution of a whole lower level.
+ */
+static struct {
+    struct np_timer *slots[TW_LVL_COUNT][TW_LVL_SIZE];
+    struct timespec base;   /* time of tick 0 */
+    uint64_t tick;          /* next tick to process */
+    uint32_t armed_count;   /* number of timers in all the slots */
+
+    struct np_timer *run_first;
+    struct np_timer *run_last;
+    uint32_t run_count;     /* number of timers in the run queue */
+    uint64_t skip_count;    /* number of expirations skipped because the previous one was still queued */
+
+    pthread_mutex_t lock;
+    pthread_cond_t tick_cond;
+    pthread_cond_t run_cond;
+    pthread_cond_t done_cond;   /* signalled whenever a callback returns */
+    int quit;
+
+    pthread_t ticker;
+    pthread_t threads[NP2SRV_TIMER_THREAD_COUNT];
+    struct np_timer *running[NP2SRV_TIMER_THREAD_COUNT];   /* timer whose callback a thread is calling, if any */
+    uint32_t thread_count;
+} tw = {
+    .lock = PTHREAD_MUTEX_INITIALIZER,
+    .run_cond = PTHREAD_COND_INITIALIZER,
+    .done_cond = PTHREAD_COND_INITIALIZER
+};
+
+/**
+ * @brief Get the wheel tick of a timestamp.
+ *
+ * @param[in] ts Timestamp to transform.
+ * @param[in] round_up Whether to round up or down.
+ * @return Tick of @p ts, 0 if before the wheel base.
+ */
+static uint64_t
+tw_ts2tick(const struct timespec *ts, int round_up)
+{
+    const int64_t tick_nsec = NP2SRV_TIMER_WHEEL_TICK * 1000000LL;
+    int64_t nsec;
+
+    nsec = (((int64_t)ts->tv_sec) - ((int64_t)tw.base.tv_sec)) * 1000000000LL;
+    nsec += ((int64_t)ts->tv_nsec) - ((int64_t)tw.base.tv_nsec);
+    if (nsec <= 0) {
+        return 0;
+    }
+
+    if (round_up) {
+        nsec += tick_nsec - 1;
+    }
+    return nsec / tick_nsec;
+}
+
+/**
+ * @brief Get the timestamp of a wheel tick.
+ *
+ * @param[in] tick Tick to transform.
+ * @return Timestamp of @p tick.
+ */
+static struct timespec
+tw_tick2ts(uint64_t tick)
+{
+    struct timespec ts;
+    uint64_t nsec;
+
+    nsec = tw.base.tv_nsec + tick * NP2SRV_TIMER_WHEEL_TICK * 1000000ULL;
+    ts.tv_sec = tw.base.tv_sec + nsec / 1000000000ULL;
+    ts.tv_nsec = nsec % 1000000000ULL;
+
+    return ts;
+}
+
+/**
+ * @brief Add a timer into the correct wheel slot based on its expiration time. Timer wheel lock held.
+ *
+ * @param[in] tmr Timer to add.
+ */
+static void
+tw_slot_add(struct np_timer *tmr)
+{
+    struct np_timer **slot;
+    uint64_t delta;
+    uint32_t lvl;
+
+    /* learn the tick, an expired timer is scheduled for the next processed tick */
+    tmr->tick = tw_ts2tick(&tmr->expire, 1);
+    if (tmr->tick < tw.tick) {
+        tmr->tick = tw.tick;
+    }
+    delta = tmr->tick - tw.tick;
+    if (delta > TW_MAX_TICKS) {
+        /* too far in the future, will be cascaded again once reached */
+        delta = TW_MAX_TICKS;
+        tmr->tick = tw.tick + delta;
+    }
+
+    /* find the level and its slot */
+    for (lvl = 0; (lvl < TW_LVL_COUNT - 1) && (delta >= (1ULL << ((lvl + 1) * TW_LVL_BITS))); ++lvl) {}
+    slot = &tw.slots[lvl][(tmr->tick >> (lvl * TW_LVL_BITS)) & TW_LVL_MASK];
+
+    /* link it */
+    tmr->next = *slot;
+    if (tmr->next) {
+        tmr->next->pprev = &tmr->next;
+    }
+    tmr->pprev = slot;
+    *slot = tmr;
+
+    tmr->flags |= TW_TIMER_ARMED;
+    ++tw.armed_count;
+}
+
+/**
+ * @brief Remove a timer from its wheel slot. Timer wheel lock held.
+ *
+ * @param[in] tmr Timer to remove.
+ */
+static void
+tw_slot_del(struct np_timer *tmr)
+{
+    if (!(tmr->flags & TW_TIMER_ARMED)) {
+        return;
+    }
+
+    *tmr->pprev = tmr->next;
+    if (tmr->next) {
+        tmr->next->pprev = tmr->pprev;
+    }
+    tmr->next = NULL;
+    tmr->pprev = NULL;
+
+    tmr->flags &= ~TW_TIMER_ARMED;
+    --tw.armed_count;
+}
+
+/**
+ * @brief Append an expired timer to the run queue. Timer wheel lock held.
+ *
+ * @param[in] tmr Timer to append.
+ */
+static void
+tw_run_append(struct np_timer *tmr)
+{
+    if (tmr->flags & TW_TIMER_QUEUED) {
+        /* still waiting from the previous expiration, skip this one */
+        ++tw.skip_count;
+        return;
+    }
+
+    tmr->run_next = NULL;
+    tmr->run_prev = tw.run_last;
+    if (tw.run_last) {
+        tw.run_last->run_next = tmr;
+    } else {
+        tw.run_first = tmr;
+    }
+    tw.run_last = tmr;
+    ++tw.run_count;
+
+    tmr->flags |= TW_TIMER_QUEUED;
+}
+
+/**
+ * @brief Remove a timer from the run queue. Timer wheel lock held.
+ *
+ * @param[in] tmr Timer to remove.
+ */
+static void
+tw_run_del(struct np_timer *tmr)
+{
+    if (!(tmr->flags & TW_TIMER_QUEUED)) {
+        return;
+    }
+
+    if (tmr->run_prev) {
+        tmr->run_prev->run_next = tmr->run_next;
+    } else {
+        tw.run_first = tmr->run_next;
+    }
+    if (tmr->run_next) {
+        tmr->run_next->run_prev = tmr->run_prev;
+    } else {
+        tw.run_last = tmr->run_prev;
+    }
+    tmr->run_next = NULL;
+    tmr->run_prev = NULL;
+    --tw.run_count;
+
+    tmr->flags &= ~TW_TIMER_QUEUED;
+}
+
+/**
+ * @brief Check whether a callback of a timer is being called by another thread. Timer wheel lock held.
+ *
+ * @param[in] tmr Timer to check.
+ * @return Whether the callback of @p tmr is running or not.
+ */
+static int
+tw_is_running(const struct np_timer *tmr)
+{
+    uint32_t i;
+
+    for (i = 0; i < tw.thread_count; ++i) {
+        if ((tw.running[i] == tmr) && !pthread_equal(tw.threads[i], pthread_self())) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Process the next wheel tick. Timer wheel lock held.
+ *
+ * @param[in] now Current time.
+ */
+static void
+tw_tick(const struct timespec *now)
+{
+    struct np_timer *tmr, *next;
+    uint64_t cur = tw.tick;
+    uint32_t lvl, idx;
+    int64_t missed_ms;
+    uint64_t skip_ms;
+
+    /* cascade timers from the higher levels whenever a lower level wraps around */
+    for (lvl = 1; lvl < TW_LVL_COUNT; ++lvl) {
+        if ((cur >> ((lvl - 1) * TW_LVL_BITS)) & TW_LVL_MASK) {
+            break;
+        }
+
+        idx = (cur >> (lvl * TW_LVL_BITS)) & TW_LVL_MASK;
+        for (tmr = tw.slots[lvl][idx]; tmr; tmr = next) {
+            next = tmr->next;
+            tw_slot_del(tmr);
+            tw_slot_add(tmr);
+        }
+    }
+
+    ++tw.tick;
+
+    /* expire all the timers of this tick */
+    idx = cur & TW_LVL_MASK;
+    for (tmr = tw.slots[0][idx]; tmr; tmr = next) {
+        next = tmr->next;
+        tw_slot_del(tmr);
+
+        if (tmr->interval_ms) {
+            /* skip all the missed periods, if any, and schedule the next expiration (64-bit, the timer may have
+             * been set long in the past) */
+            missed_ms = (((int64_t)now->tv_sec) - ((int64_t)tmr->expire.tv_sec)) * 1000LL;
+            missed_ms += (((int64_t)now->tv_nsec) - ((int64_t)tmr->expire.tv_nsec)) / 1000000LL;
+            if (missed_ms > 0) {
+                skip_ms = (missed_ms / tmr->interval_ms) * tmr->interval_ms;
+                tmr->expire.tv_sec += skip_ms / 1000;
+                np_addtimespec(&tmr->expire, skip_ms % 1000);
+            }
+            np_addtimespec(&tmr->expire, tmr->interval_ms);
+            tw_slot_add(tmr);
+        }
+
+        tw_run_append(tmr);
+    }
+
+    if (tw.run_first) {
+        pthread_cond_broadcast(&tw.run_cond);
+    }
+}
+
+/**
+ * @brief Learn the next tick that needs to be processed. Timer wheel lock held.
+ *
+ * @return Next tick with timers to expire or to cascade.
+ */
+static uint64_t
+tw_next_tick(void)
+{
+    uint64_t tick;
+
+    for (tick = tw.tick; tick < tw.tick + TW_LVL_SIZE; ++tick) {
+        if (!(tick & TW_LVL_MASK)) {
+            /* cascade */
+            break;
+        }
+        if (tw.slots[0][tick & TW_LVL_MASK]) {
+            /* expiration */
+            break;
+        }
+    }
+
+    return tick;
+}
+
+/**
+ * @brief Timer wheel thread advancing the wheel and queueing expired timers.
+ */
+static void *
+tw_ticker_thread(void *UNUSED(arg))
+{
+    struct timespec now, wake;
+    uint64_t now_tick;
+
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    while (!tw.quit) {
+        now = np_gettimespec();
+        now_tick = tw_ts2tick(&now, 0);
+
+        if (!tw.armed_count) {
+            /* no timers, skip all the empty ticks and wait for one */
+            tw.tick = now_tick + 1;
+            pthread_cond_wait(&tw.tick_cond, &tw.lock);
+            continue;
+        }
+
+        /* process all the ticks that are due */
+        while (tw.tick <= now_tick) {
+            tw_tick(&now);
+        }
+
+        /* sleep until the next interesting tick or until a timer is armed */
+        wake = tw_tick2ts(tw_next_tick());
+        pthread_cond_timedwait(&tw.tick_cond, &tw.lock, &wake);
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+
+    return NULL;
+}
+
+/**
+ * @brief Timer wheel thread calling callbacks of expired timers.
+ */
+static void *
+tw_run_thread(void *arg)
+{
+    uint32_t idx = (uintptr_t)arg;
+    struct np_timer *tmr;
+    np_timer_cb cb;
+    void *cb_arg;
+
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    while (1) {
+        while (!tw.quit && !tw.run_first) {
+            pthread_cond_wait(&tw.run_cond, &tw.lock);
+        }
+        if (tw.quit) {
+            break;
+        }
+
+        /* dequeue the timer, it must not be accessed after the lock is released */
+        tmr = tw.run_first;
+        tw_run_del(tmr);
+        cb = tmr->cb;
+        cb_arg = tmr->arg;
+        tw.running[idx] = tmr;
+
+        /* UNLOCK */
+        pthread_mutex_unlock(&tw.lock);
+
+        cb(cb_arg);
+
+        /* LOCK */
+        pthread_mutex_lock(&tw.lock);
+
+        /* the timer may have been freed by the callback, only wake up anyone waiting for it */
+        tw.running[idx] = NULL;
+        pthread_cond_broadcast(&tw.done_cond);
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+
+    return NULL;
+}
+
+int
+np2srv_timer_wheel_init(void)
+{
+    pthread_condattr_t attr;
+    uint32_t i;
+    int r;
+
+    tw.base = np_gettimespec();
+    tw.tick = 0;
+    tw.quit = 0;
+
+    /* the ticker waits on the same clock the timers use */
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, NP_CLOCK_ID);
+    pthread_cond_init(&tw.tick_cond, &attr);
+    pthread_condattr_destroy(&attr);
+
+    if ((r = pthread_create(&tw.ticker, NULL, tw_ticker_thread, NULL))) {
+        ERR("Failed to create timer wheel thread (%s).", strerror(r));
+        return -1;
+    }
+
+    for (i = 0; i < NP2SRV_TIMER_THREAD_COUNT; ++i) {
+        if ((r = pthread_create(&tw.threads[i], NULL, tw_run_thread, (void *)(uintptr_t)i))) {
+            ERR("Failed to create timer thread (%s).", strerror(r));
+            return -1;
+        }
+        ++tw.thread_count;
+    }
+
+    return 0;
+}
+
+void
+np2srv_timer_wheel_destroy(void)
+{
+    uint32_t i;
+
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    tw.quit = 1;
+    pthread_cond_broadcast(&tw.tick_cond);
+    pthread_cond_broadcast(&tw.run_cond);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+
+    if (tw.ticker) {
+        pthread_join(tw.ticker, NULL);
+    }
+    for (i = 0; i < tw.thread_count; ++i) {
+        pthread_join(tw.threads[i], NULL);
+    }
+    pthread_cond_destroy(&tw.tick_cond);
+}
+
+void
+np_timer_init(struct np_timer *tmr, np_timer_cb cb, void *arg)
+{
+    memset(tmr, 0, sizeof *tmr);
+    tmr->cb = cb;
+    tmr->arg = arg;
+}
+
+void
+np_timer_set(struct np_timer *tmr, struct timespec expire, uint32_t interval_ms)
+{
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    /* re-arm, the timer may stay queued if already expired */
+    tw_slot_del(tmr);
+    tmr->expire = expire;
+    tmr->interval_ms = interval_ms;
+    tw_slot_add(tmr);
+
+    /* the ticker may need to wake up sooner */
+    pthread_cond_signal(&tw.tick_cond);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+}
+
+void
+np_timer_disarm(struct np_timer *tmr)
+{
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    tw_slot_del(tmr);
+    tw_run_del(tmr);
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+}
+
+void
+np_timer_disarm_sync(struct np_timer *tmr)
+{
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    tw_slot_del(tmr);
+    tw_run_del(tmr);
+
+    /* wait for the callback to finish, unless it is the one disarming its timer */
+    while (tw_is_running(tmr)) {
+        pthread_cond_wait(&tw.done_cond, &tw.lock);
+    }
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+}
+
+int
+np_timer_is_pending(struct np_timer *tmr)
+{
+    int pending;
+
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    pending = tmr->flags ? 1 : 0;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+
+    return pending;
+}
+
+void
+np_timer_metrics(struct np_metrics *m)
+{
+    uint32_t armed_count, run_count;
+    uint64_t skip_count;
+
+    /* LOCK */
+    pthread_mutex_lock(&tw.lock);
+
+    armed_count = tw.armed_count;
+    run_count = tw.run_count;
+    skip_count = tw.skip_count;
+
+    /* UNLOCK */
+    pthread_mutex_unlock(&tw.lock);
+
+    np_metrics_gauge(m, "timers_armed", "Number of armed timers.", armed_count);
+    np_metrics_gauge(m, "timers_queued", "Number of expired timers waiting for a thread.", run_count);
+    np_metrics_counter(m, "timers_skipped", "Number of timer expirations skipped because of a busy timer.", skip_count);
+}
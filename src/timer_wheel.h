@@ -0,0 +1,112 @@
+/**
+ * @file timer_wheel.h
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief central hierarchical timer wheel header
+ *
+ * Copyright (c) 2021 CESNET, z.s.p.o.
+ *
+ * This source code is licensed under BSD 3-Clause License (the "License").
+ * You may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://opensource.org/licenses/BSD-3-Clause
+ */
+
+#ifndef NP2SRV_TIMER_WHEEL_H_
+#define NP2SRV_TIMER_WHEEL_H_
+
+#include <stdint.h>
+#include <time.h>
+
+#include "metrics.h"
+
+/**
+ * @brief Timer callback, called by one of the timer wheel threads.
+ */
+typedef void (*np_timer_cb)(void *arg);
+
+/**
+ * @brief Timer serviced by the central timer wheel.
+ */
+struct np_timer {
+    /* parameters */
+    np_timer_cb cb;
+    void *arg;
+    struct timespec expire;     /* next absolute expiration time (NP_CLOCK_ID) */
+    uint32_t interval_ms;       /* period of a periodic timer, 0 for a one-shot timer */
+
+    /* internal data, timer wheel lock */
+    uint64_t tick;              /* wheel tick the timer is scheduled for */
+    struct np_timer *next;      /* wheel slot list */
+    struct np_timer **pprev;
+    struct np_timer *run_next;  /* list of expired timers waiting for a thread */
+    struct np_timer *run_prev;
+    uint8_t flags;
+};
+
+/**
+ * @brief Initialize the timer wheel and start its threads.
+ *
+ * @return 0 on success, -1 on error.
+ */
+int np2srv_timer_wheel_init(void);
+
+/**
+ * @brief Stop the timer wheel threads. All the timers are expected to be disarmed.
+ */
+void np2srv_timer_wheel_destroy(void);
+
+/**
+ * @brief Initialize a timer, it is not armed.
+ *
+ * @param[in] tmr Timer to initialize.
+ * @param[in] cb Callback to be called on expiration.
+ * @param[in] arg Argument for @p cb.
+ */
+void np_timer_init(struct np_timer *tmr, np_timer_cb cb, void *arg);
+
+/**
+ * @brief Arm a timer or re-arm an already armed one.
+ *
+ * If @p expire is in the past, the timer expires right away and, if periodic, its next expiration is aligned
+ * to @p expire and @p interval_ms, the same way as for POSIX absolute timers.
+ *
+ * @param[in] tmr Timer to arm.
+ * @param[in] expire Absolute time of the first expiration.
+ * @param[in] interval_ms Period of the timer, 0 for a one-shot timer.
+ */
+void np_timer_set(struct np_timer *tmr, struct timespec expire, uint32_t interval_ms);
+
+/**
+ * @brief Disarm a timer. Once this function returns, its callback will not be called unless it is already running.
+ *
+ * @param[in] tmr Timer to disarm.
+ */
+void np_timer_disarm(struct np_timer *tmr);
+
+/**
+ * @brief Disarm a timer and wait until its callback returns if it is being called by another thread. Once this
+ * function returns, the timer can be freed.
+ *
+ * Must not be called while holding any lock the callback may be waiting for.
+ *
+ * @param[in] tmr Timer to disarm.
+ */
+void np_timer_disarm_sync(struct np_timer *tmr);
+
+/**
+ * @brief Check whether a timer is armed or has expired and its callback was not yet called.
+ *
+ * @param[in] tmr Timer to check.
+ * @return Whether the timer is pending or not.
+ */
+int np_timer_is_pending(struct np_timer *tmr);
+
+/**
+ * @brief Print the timer wheel queue depths as metrics.
+ *
+ * @param[in] m Metrics buffer.
+ */
+void np_timer_metrics(struct np_metrics *m);
+
+#endif /* NP2SRV_TIMER_WHEEL_H_ */
@@ -17,7 +17,7 @@
 #include "yang_push.h"
 
 #include <assert.h>
-#include <signal.h>
+#include <inttypes.h>
 #include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
@@ -32,6 +32,107 @@
 #include "netconf_acm.h"
 #include "netconf_subscribed_notifications.h"
 
+/**
+ * @brief Group of periodic yang-push subscriptions with the same datastore, filter, period, and anchor time
+ * sharing a single data retrieval every period.
+ */
+struct yang_push_group {
+    uint32_t id;
+    sr_datastore_t datastore;
+    char *xpath;
+    uint32_t period_ms;
+    struct timespec anchor_time;
+
+    sr_session_ctx_t *sess;
+    struct np_timer update_timer;
+    pthread_mutex_t update_lock;    /* held while the updates of a period are being sent */
+    struct yang_push_data **members;
+    uint32_t member_count;
+};
+
+/**
+ * @brief All the periodic subscription groups, protected by the sub-ntf lock.
+ */
+static struct {
+    struct yang_push_group **groups;
+    uint32_t count;
+    uint32_t last_id;
+} yp_groups;
+
+/**
+ * @brief Subscription with changes dispatched by a change dispatcher.
+ */
+struct yang_push_dispatch_member {
+    struct yang_push_data *yp_data;
+    char *xpath;                    /* filter of the subscription, NULL if the whole module is selected */
+    struct ly_set *schemas;         /* schema nodes selected by xpath, NULL if the whole module is selected */
+    int instance_filter;            /* xpath must be evaluated on the changed data */
+
+    /* data of the dispatched change event */
+    struct ly_set *filter_nodes;    /* diff nodes selected by xpath, evaluated only if needed */
+    uint32_t *changes;              /* indices of the changes selected by the filter */
+    uint32_t change_count;
+    uint32_t change_size;
+};
+
+/**
+ * @brief Change dispatcher members with filters selecting a schema node.
+ */
+struct yang_push_dispatch_schema {
+    const struct lysc_node *schema;
+    uint32_t *members;
+    uint32_t member_count;
+};
+
+/**
+ * @brief Change dispatcher, a single sysrepo module change subscription for all the on-change subscriptions
+ * of a module and its datastore.
+ */
+struct yang_push_dispatch {
+    const struct lys_module *ly_mod;
+    sr_datastore_t datastore;
+
+    sr_session_ctx_t *sess;
+    sr_subscription_ctx_t **sub_ctx;
+    uint32_t sub_id;
+    pthread_mutex_t lock;           /* held while the changes of an event are being dispatched */
+    struct yang_push_dispatch_member *members;
+    uint32_t member_count;
+
+    /* filter index */
+    struct yang_push_dispatch_schema *schema_idx;   /* sorted by the schema nodes */
+    uint32_t schema_idx_count;
+    uint32_t *module_members;       /* members selecting any change of the module */
+    uint32_t module_member_count;
+};
+
+/**
+ * @brief All the change dispatchers, protected by the sub-ntf lock.
+ */
+static struct {
+    struct yang_push_dispatch **dispatch;
+    uint32_t count;
+    uint32_t last_ctx;
+} yp_dispatch;
+
+/**
+ * @brief Single change of a dispatched change event.
+ */
+struct yang_push_change {
+    sr_change_oper_t op;
+    const struct lyd_node *node;
+    const char *prev_value;
+    const char *prev_list;
+};
+
+/**
+ * @brief NACM read access of a schema node cached for the user of an on-change subscription.
+ */
+struct yang_push_nacm_verdict {
+    const struct lysc_node *schema;
+    enum ncac_access access;
+};
+
 /**
  * @brief Transform yang-push operation into string.
  *
@@ -164,22 +265,59 @@ yang_push_op_sr2yp(sr_change_oper_t op, const struct lyd_node *node)
     return 0;
 }
 
+/**
+ * @brief Set the value of a YANG patch edit.
+ *
+ * @param[in] ly_edit Edit to modify, any previous value is replaced.
+ * @param[in] node Changed node with the value, NULL to only remove the previous value.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_notif_change_edit_value(struct lyd_node *ly_edit, const struct lyd_node *node)
+{
+    struct lyd_node *value_tree;
+
+    /* remove the previous value */
+    if (!lyd_find_path(ly_edit, "value", 0, &value_tree)) {
+        lyd_free_tree(value_tree);
+    }
+
+    if (!node) {
+        return SR_ERR_OK;
+    }
+
+    /* duplicate value tree without metadata */
+    if (lyd_dup_single(node, NULL, LYD_DUP_RECURSIVE | LYD_DUP_NO_META | LYD_DUP_WITH_FLAGS, &value_tree)) {
+        return SR_ERR_LY;
+    }
+
+    /* value */
+    if (lyd_new_any(ly_edit, NULL, "value", value_tree, 1, LYD_ANYDATA_DATATREE, 0, NULL)) {
+        return SR_ERR_LY;
+    }
+
+    return SR_ERR_OK;
+}
+
 /**
  * @brief Append a new edit (change) to a YANG patch.
  *
  * @param[in] ly_yp YANG patch node to append to.
  * @param[in] yp_op yang-push operation.
  * @param[in] node Changed node.
+ * @param[in] target Path of @p node, generated if NULL.
  * @param[in] prev_value Previous leaf-list value, if any.
  * @param[in] prev_list Previous list value, if any.
  * @param[in] yp_data yang-push data.
+ * @param[out] edit Optional created edit.
  * @return Sysrepo error value.
  */
 static int
 yang_push_notif_change_edit_append(struct lyd_node *ly_yp, enum yang_push_op yp_op, const struct lyd_node *node,
-        const char *prev_value, const char *prev_list, struct yang_push_data *yp_data)
+        const char *target, const char *prev_value, const char *prev_list, struct yang_push_data *yp_data,
+        struct lyd_node **edit)
 {
-    struct lyd_node *ly_edit, *ly_target, *value_tree;
+    struct lyd_node *ly_edit;
     char buf[26], *path = NULL, *point = NULL;
     uint32_t edit_id;
     int rc = SR_ERR_OK;
@@ -201,32 +339,32 @@ yang_push_notif_change_edit_append(struct lyd_node *ly_yp, enum yang_push_op yp_
     }
 
     /* target */
-    path = lyd_path(node, LYD_PATH_STD, NULL, 0);
-    if (!path) {
-        rc = SR_ERR_LY;
-        goto cleanup;
+    if (!target) {
+        path = lyd_path(node, LYD_PATH_STD, NULL, 0);
+        if (!path) {
+            rc = SR_ERR_LY;
+            goto cleanup;
+        }
+        target = path;
     }
-    if (lyd_new_term(ly_edit, NULL, "target", path, 0, &ly_target)) {
+    if (lyd_new_term(ly_edit, NULL, "target", target, 0, NULL)) {
         rc = SR_ERR_LY;
         goto cleanup;
     }
 
-    /* remember the node schema */
-    ly_target->priv = (void *)node->schema;
-
     if ((yp_op == YP_OP_INSERT) || (yp_op == YP_OP_MOVE)) {
         /* point */
         if (node->schema->nodetype == LYS_LEAFLIST) {
             assert(prev_value);
             if (prev_value[0]) {
-                if (asprintf(&point, "%s[.='%s']", path, prev_value) == -1) {
+                if (asprintf(&point, "%s[.='%s']", target, prev_value) == -1) {
                     rc = SR_ERR_NO_MEMORY;
                     goto cleanup;
                 }
             }
         } else {
             if (prev_list[0]) {
-                if (asprintf(&point, "%s%s", path, prev_list) == -1) {
+                if (asprintf(&point, "%s%s", target, prev_list) == -1) {
                     rc = SR_ERR_NO_MEMORY;
                     goto cleanup;
                 }
@@ -253,19 +391,17 @@ yang_push_notif_change_edit_append(struct lyd_node *ly_yp, enum yang_push_op yp_
     }
 
     if ((yp_op == YP_OP_INSERT) || (yp_op == YP_OP_CREATE) || (yp_op == YP_OP_REPLACE)) {
-        /* duplicate value tree without metadata */
-        if (lyd_dup_single(node, NULL, LYD_DUP_RECURSIVE | LYD_DUP_NO_META | LYD_DUP_WITH_FLAGS, &value_tree)) {
-            rc = SR_ERR_LY;
-            goto cleanup;
-        }
-
         /* value */
-        if (lyd_new_any(ly_edit, NULL, "value", value_tree, 1, LYD_ANYDATA_DATATREE, 0, NULL)) {
-            rc = SR_ERR_LY;
+        rc = yang_push_notif_change_edit_value(ly_edit, node);
+        if (rc != SR_ERR_OK) {
             goto cleanup;
         }
     }
 
+    if (edit) {
+        *edit = ly_edit;
+    }
+
 cleanup:
     free(path);
     free(point);
@@ -273,295 +409,1137 @@ cleanup:
 }
 
 /**
- * @brief Send an on-change push-change-update yang-push notification.
+ * @brief Find an edit in the edit index of an on-change yang-push subscription.
  *
- * @param[in] ncs NETCONF session.
- * @param[in] yp_data yang-push data with the notification.
- * @param[in] nc_sub_id NC sub ID of the subscription.
- * @return Sysrepo error value.
+ * @param[in] yp_data yang-push data with the index.
+ * @param[in] target Edit target to find.
+ * @param[out] pos Position of the found edit or where it would be inserted.
+ * @return Whether the edit was found or not.
  */
 static int
-yang_push_notif_change_send(struct nc_session *ncs, struct yang_push_data *yp_data, uint32_t nc_sub_id)
+yang_push_edit_idx_find(const struct yang_push_data *yp_data, const char *target, uint32_t *pos)
 {
-    struct lyd_node_any *ly_value;
-    struct lyd_node *ly_target, *next, *iter;
-    struct ly_set *set = NULL;
-    uint32_t i, removed;
-    int rc = SR_ERR_OK;
-
-    assert(yp_data->ly_change_ntf);
+    uint32_t lo = 0, hi = yp_data->edit_idx_count, mid;
+    int r;
 
-    /* NACM filtering */
-    if (lyd_find_xpath(yp_data->ly_change_ntf, "/ietf-yang-push:push-change-update/datastore-changes/yang-patch/edit", &set)) {
-        rc = SR_ERR_LY;
-        goto cleanup;
-    }
-    removed = 0;
-    for (i = 0; i < set->count; ++i) {
-        /* check the change itself */
-        lyd_find_path(set->dnodes[i], "target", 0, &ly_target);
-        if (!NCAC_ACCESS_IS_NODE_PERMIT(ncac_allowed_node(NULL, lyd_get_value(ly_target), ly_target->priv,
-                nc_session_get_username(ncs), NCAC_OP_READ))) {
-            /* not allowed, remove this change */
-            lyd_free_tree(set->dnodes[i]);
-            ++removed;
-            continue;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        r = strcmp(yp_data->edit_idx[mid].target, target);
+        if (!r) {
+            *pos = mid;
+            return 1;
+        } else if (r < 0) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
         }
+    }
 
-        if (!lyd_find_path(set->dnodes[i], "value", 0, (struct lyd_node **)&ly_value)) {
-            assert(ly_value->value_type == LYD_ANYDATA_DATATREE);
+    *pos = lo;
+    return 0;
+}
 
-            /* filter out any nested nodes */
-            LY_LIST_FOR_SAFE(lyd_child(ly_value->value.tree), next, iter) {
-                ncac_check_data_read_filter(&iter, nc_session_get_username(ncs));
-            }
-        }
-    }
+/**
+ * @brief Insert an edit into the edit index of an on-change yang-push subscription.
+ *
+ * @param[in] yp_data yang-push data with the index.
+ * @param[in] pos Position to insert at.
+ * @param[in] target Edit target, is spent on success.
+ * @param[in] edit Edit to insert.
+ * @param[in] op Edit operation.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_edit_idx_insert(struct yang_push_data *yp_data, uint32_t pos, char *target, struct lyd_node *edit,
+        enum yang_push_op op)
+{
+    void *mem;
 
-    if (removed == set->count) {
-        /* no change is actually readable, notification denied */
-        sub_ntf_inc_denied(nc_sub_id);
-        goto cleanup;
+    mem = realloc(yp_data->edit_idx, (yp_data->edit_idx_count + 1) * sizeof *yp_data->edit_idx);
+    if (!mem) {
+        EMEM;
+        return SR_ERR_NO_MEMORY;
     }
+    yp_data->edit_idx = mem;
 
-    /* send the notification */
-    rc = sub_ntf_send_notif(ncs, nc_sub_id, np_gettimespec(), &yp_data->ly_change_ntf, 1);
-
-    if (rc == SR_ERR_OK) {
-        /* set last_notif timestamp */
-        yp_data->last_notif = np_gettimespec();
+    if (pos < yp_data->edit_idx_count) {
+        memmove(&yp_data->edit_idx[pos + 1], &yp_data->edit_idx[pos],
+                (yp_data->edit_idx_count - pos) * sizeof *yp_data->edit_idx);
     }
+    yp_data->edit_idx[pos].target = target;
+    yp_data->edit_idx[pos].edit = edit;
+    yp_data->edit_idx[pos].op = op;
+    ++yp_data->edit_idx_count;
 
-cleanup:
-    ly_set_free(set, NULL);
-    lyd_free_tree(yp_data->ly_change_ntf);
-    yp_data->ly_change_ntf = NULL;
-    return rc;
+    return SR_ERR_OK;
 }
 
 /**
- * @brief Timer callback for dampened on-change yang-push changes.
+ * @brief Remove edits from a push-change-update notification and its index.
+ *
+ * @param[in] yp_data yang-push data with the index.
+ * @param[in] pos Position of the first edit to remove.
+ * @param[in] count Number of edits to remove.
  */
 static void
-yang_push_damp_timer_cb(union sigval sval)
+yang_push_edit_idx_remove(struct yang_push_data *yp_data, uint32_t pos, uint32_t count)
 {
-    struct yang_push_cb_arg *arg = sval.sival_ptr;
+    uint32_t i;
 
-    /* READ LOCK */
-    if (!sub_ntf_find_lock(arg->nc_sub_id, 0)) {
+    if (!count) {
         return;
     }
 
-    /* NOTIF LOCK */
-    pthread_mutex_lock(&arg->yp_data->notif_lock);
+    for (i = pos; i < pos + count; ++i) {
+        lyd_free_tree(yp_data->edit_idx[i].edit);
+        free(yp_data->edit_idx[i].target);
+    }
 
-    /* send the postponed on-change notification */
-    yang_push_notif_change_send(arg->ncs, arg->yp_data, arg->nc_sub_id);
+    yp_data->edit_idx_count -= count;
+    if (pos < yp_data->edit_idx_count) {
+        memmove(&yp_data->edit_idx[pos], &yp_data->edit_idx[pos + count],
+                (yp_data->edit_idx_count - pos) * sizeof *yp_data->edit_idx);
+    }
+}
 
-    /* NOTIF UNLOCK */
-    pthread_mutex_unlock(&arg->yp_data->notif_lock);
+/**
+ * @brief Clear the edit index of an on-change yang-push subscription, the edits themselves are not freed.
+ *
+ * @param[in] yp_data yang-push data with the index.
+ */
+static void
+yang_push_edit_idx_clear(struct yang_push_data *yp_data)
+{
+    uint32_t i;
 
-    /* UNLOCK */
-    sub_ntf_unlock();
+    for (i = 0; i < yp_data->edit_idx_count; ++i) {
+        free(yp_data->edit_idx[i].target);
+    }
+    free(yp_data->edit_idx);
+    yp_data->edit_idx = NULL;
+    yp_data->edit_idx_count = 0;
 }
 
 /**
- * @brief Check whether an on-change yang-push notification is ready to be sent or will be postponed.
+ * @brief Learn NACM read access of a changed node for the user of an on-change subscription,
+ * use the cached access of its schema node if possible.
  *
- * @param[in] yp_data yang-push data.
- * @param[out] ready Whether the notification can be sent or was scheduled to be sent later.
+ * @param[in] yp_data yang-push data with the cache.
+ * @param[in] target Path of the changed node.
+ * @param[in] schema Schema node of the changed node.
+ * @param[out] access NCAC access of the node.
  * @return Sysrepo error value.
  */
 static int
-yang_push_notif_change_ready(struct yang_push_data *yp_data, int *ready)
+yang_push_nacm_access(struct yang_push_data *yp_data, const char *target, const struct lysc_node *schema,
+        enum ncac_access *access)
 {
-    struct timespec next_notif, cur_time;
-    int32_t next_notif_in;
-    struct itimerspec trspec;
+    uint32_t version, lo = 0, hi, mid;
+    int schema_access;
+    void *mem;
 
-    if (!yp_data->dampening_period_ms) {
-        /* always ready */
-        *ready = 1;
-        return SR_ERR_OK;
+    /* any NACM configuration change invalidates the cache */
+    version = ncac_get_version();
+    if (version != yp_data->nacm_version) {
+        free(yp_data->nacm_cache);
+        yp_data->nacm_cache = NULL;
+        yp_data->nacm_cache_count = 0;
+        yp_data->nacm_version = version;
+    }
+
+    /* cached access */
+    hi = yp_data->nacm_cache_count;
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (yp_data->nacm_cache[mid].schema == schema) {
+            *access = yp_data->nacm_cache[mid].access;
+            return SR_ERR_OK;
+        } else if ((uintptr_t)yp_data->nacm_cache[mid].schema < (uintptr_t)schema) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
     }
 
-    /* check current timer */
-    if (timer_gettime(yp_data->damp_timer, &trspec) == -1) {
-        return SR_ERR_SYS;
-    }
-    if (trspec.it_value.tv_sec || trspec.it_value.tv_nsec) {
-        /* timer is already set */
-        *ready = 0;
+    /* check the access */
+    *access = ncac_allowed_node_read(target, schema, nc_session_get_username(yp_data->cb_arg.ncs), &schema_access);
+    if (!schema_access) {
+        /* depends on the instance, cannot be cached */
         return SR_ERR_OK;
     }
 
-    /* learn when the next notification is due */
-    cur_time = np_gettimespec();
-    next_notif = yp_data->last_notif;
-    np_addtimespec(&next_notif, yp_data->dampening_period_ms);
-    next_notif_in = np_difftimespec(&cur_time, &next_notif);
-
-    if (next_notif_in <= 0) {
-        /* can be sent */
-        *ready = 1;
-        return SR_ERR_OK;
+    /* cache it */
+    mem = realloc(yp_data->nacm_cache, (yp_data->nacm_cache_count + 1) * sizeof *yp_data->nacm_cache);
+    if (!mem) {
+        EMEM;
+        return SR_ERR_NO_MEMORY;
     }
-
-    /* schedule the notification */
-    trspec.it_value = next_notif;
-    if (timer_settime(yp_data->damp_timer, TIMER_ABSTIME, &trspec, NULL) == -1) {
-        return SR_ERR_SYS;
+    yp_data->nacm_cache = mem;
+    if (lo < yp_data->nacm_cache_count) {
+        memmove(&yp_data->nacm_cache[lo + 1], &yp_data->nacm_cache[lo],
+                (yp_data->nacm_cache_count - lo) * sizeof *yp_data->nacm_cache);
     }
+    yp_data->nacm_cache[lo].schema = schema;
+    yp_data->nacm_cache[lo].access = *access;
+    ++yp_data->nacm_cache_count;
 
-    *ready = 0;
     return SR_ERR_OK;
 }
 
 /**
- * @brief Module change callback for yang-push changes.
+ * @brief Add a change into a YANG patch, coalesce it with a previous change of the same node, if possible.
+ * Changes the user has no read access to are not added and the value of the change is NACM filtered.
+ *
+ * @param[in] ly_yp YANG patch node to add to.
+ * @param[in] yp_op yang-push operation.
+ * @param[in] node Changed node.
+ * @param[in] prev_value Previous leaf-list value, if any.
+ * @param[in] prev_list Previous list value, if any.
+ * @param[in] yp_data yang-push data with the edit index.
+ * @return Sysrepo error value.
  */
 static int
-np2srv_change_yang_push_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *module_name,
-        const char *xpath, sr_event_t UNUSED(event), uint32_t UNUSED(request_id), void *private_data)
+yang_push_notif_change_edit_add(struct lyd_node *ly_yp, enum yang_push_op yp_op, const struct lyd_node *node,
+        const char *prev_value, const char *prev_list, struct yang_push_data *yp_data)
 {
-    struct yang_push_cb_arg *arg = private_data;
-    char *xp = NULL, buf[26];
-    sr_change_iter_t *iter = NULL;
-    sr_change_oper_t op;
-    const struct lyd_node *node;
-    struct lyd_node *ly_yp = NULL;
-    const char *prev_value, *prev_list;
-    enum yang_push_op yp_op;
-    int ready, r;
-    uint32_t patch_id;
-
-    assert(!arg->yp_data->periodic);
+    struct yang_push_edit_idx *idx = NULL;
+    struct lyd_node *ly_edit, *ly_op, *ly_value;
+    char *target = NULL, *prefix = NULL;
+    uint32_t pos, desc_pos, i;
+    enum yang_push_op new_op;
+    enum ncac_access access;
+    int rc = SR_ERR_OK;
 
-    if (xpath) {
-        r = asprintf(&xp, "%s//.", xpath);
-    } else {
-        r = asprintf(&xp, "/%s:*//.", module_name);
+    target = lyd_path(node, LYD_PATH_STD, NULL, 0);
+    if (!target) {
+        rc = SR_ERR_LY;
+        goto cleanup;
     }
-    if (r == -1) {
-        EMEM;
+
+    /* NACM check of the change itself */
+    rc = yang_push_nacm_access(yp_data, target, node->schema, &access);
+    if (rc != SR_ERR_OK) {
         goto cleanup;
     }
-    if (sr_get_changes_iter(session, xp, &iter) != SR_ERR_OK) {
+    if (!NCAC_ACCESS_IS_NODE_PERMIT(access)) {
+        /* not allowed, skip this change */
+        yp_data->change_denied = 1;
         goto cleanup;
     }
 
-    /* NOTIF LOCK */
-    pthread_mutex_lock(&arg->yp_data->notif_lock);
-
-    while (sr_get_change_tree_next(session, iter, &op, &node, &prev_value, &prev_list, NULL) == SR_ERR_OK) {
-        /* learn yang-push operation */
-        yp_op = yang_push_op_sr2yp(op, node);
-        if (arg->yp_data->excluded_change[yp_op]) {
-            /* excluded */
-            ATOMIC_INC_RELAXED(arg->yp_data->excluded_op_count);
-            continue;
+    if (yp_op == YP_OP_DELETE) {
+        /* any previous changes of the descendants are overwritten */
+        if (asprintf(&prefix, "%s/", target) == -1) {
+            rc = SR_ERR_NO_MEMORY;
+            goto cleanup;
         }
+        yang_push_edit_idx_find(yp_data, prefix, &desc_pos);
+        for (i = desc_pos; (i < yp_data->edit_idx_count) &&
+                !strncmp(yp_data->edit_idx[i].target, prefix, strlen(prefix)); ++i) {}
+        yang_push_edit_idx_remove(yp_data, desc_pos, i - desc_pos);
+    }
 
-        /* there is a change */
-        if (!arg->yp_data->ly_change_ntf) {
-            /* create basic structure for push-change-update notification */
-            sprintf(buf, "%" PRIu32, arg->nc_sub_id);
-            if (lyd_new_path(NULL, sr_get_context(np2srv.sr_conn), "/ietf-yang-push:push-change-update/id", buf, 0,
-                    &arg->yp_data->ly_change_ntf)) {
-                goto cleanup_unlock;
-            }
-
-            /* generate a new patch-id */
-            patch_id = ATOMIC_INC_RELAXED(arg->yp_data->patch_id);
-            sprintf(buf, "patch-%" PRIu32, patch_id);
-            if (lyd_new_path(arg->yp_data->ly_change_ntf, NULL, "datastore-changes/yang-patch/patch-id", buf, 0, NULL)) {
-                goto cleanup_unlock;
-            }
+    /* find a previous change of the node */
+    if (yang_push_edit_idx_find(yp_data, target, &pos)) {
+        idx = &yp_data->edit_idx[pos];
 
-            /* initialize edit-id */
-            ATOMIC_STORE_RELAXED(arg->yp_data->edit_id, 1);
+        if ((idx->op == YP_OP_CREATE) && (yp_op == YP_OP_DELETE)) {
+            /* created and deleted, no change at all */
+            yang_push_edit_idx_remove(yp_data, pos, 1);
+            goto cleanup;
         }
-        if (!ly_yp) {
-            ly_yp = lyd_child(lyd_child(arg->yp_data->ly_change_ntf)->next);
+
+        if ((idx->op == YP_OP_REPLACE) && (yp_op == YP_OP_DELETE)) {
+            /* only the delete matters */
+            new_op = YP_OP_DELETE;
+        } else if (((idx->op == YP_OP_CREATE) || (idx->op == YP_OP_INSERT) || (idx->op == YP_OP_REPLACE)) &&
+                (yp_op == YP_OP_REPLACE)) {
+            /* last value wins */
+            new_op = idx->op;
+        } else if ((idx->op == YP_OP_DELETE) && (yp_op == YP_OP_CREATE)) {
+            /* deleted and created again */
+            new_op = YP_OP_REPLACE;
+        } else {
+            /* cannot be coalesced (ordered changes), append the change */
+            new_op = YP_OP_OPERATION_COUNT;
         }
 
-        /* append a new edit */
-        if (yang_push_notif_change_edit_append(ly_yp, yp_op, node, prev_value, prev_list, arg->yp_data)) {
-            goto cleanup_unlock;
+        if (new_op != YP_OP_OPERATION_COUNT) {
+            /* update the previous edit in place */
+            ly_edit = idx->edit;
+            if (new_op != idx->op) {
+                lyd_find_path(ly_edit, "operation", 0, &ly_op);
+                if (lyd_change_term(ly_op, yang_push_op2str(new_op))) {
+                    rc = SR_ERR_LY;
+                    goto cleanup;
+                }
+                idx->op = new_op;
+            }
+            rc = yang_push_notif_change_edit_value(ly_edit, (new_op == YP_OP_DELETE) ? NULL : node);
+            if (rc != SR_ERR_OK) {
+                goto cleanup;
+            }
+            goto filter;
         }
     }
 
-    if (!arg->yp_data->ly_change_ntf) {
-        /* there are actually no changes */
-        goto cleanup_unlock;
+    /* append a new edit */
+    rc = yang_push_notif_change_edit_append(ly_yp, yp_op, node, target, prev_value, prev_list, yp_data, &ly_edit);
+    if (rc != SR_ERR_OK) {
+        goto cleanup;
     }
 
-    /* check whether the notification can be sent now */
-    if (yang_push_notif_change_ready(arg->yp_data, &ready)) {
-        goto cleanup_unlock;
+    /* index it, any previous edit of the node is not relevant anymore */
+    if (idx) {
+        idx->edit = ly_edit;
+        idx->op = yp_op;
+    } else {
+        rc = yang_push_edit_idx_insert(yp_data, pos, target, ly_edit, yp_op);
+        if (rc != SR_ERR_OK) {
+            goto cleanup;
+        }
+        target = NULL;
     }
 
-    /* send the notification */
-    if (ready && yang_push_notif_change_send(arg->ncs, arg->yp_data, arg->nc_sub_id)) {
-        goto cleanup_unlock;
+filter:
+    if ((access != NCAC_ACCESS_PERMIT) && !lyd_find_path(ly_edit, "value", 0, &ly_value)) {
+        /* filter out any nested nodes */
+        ncac_check_data_read_filter_children(((struct lyd_node_any *)ly_value)->value.tree,
+                nc_session_get_username(yp_data->cb_arg.ncs));
     }
 
-cleanup_unlock:
-    /* NOTIF UNLOCK */
-    pthread_mutex_unlock(&arg->yp_data->notif_lock);
-
 cleanup:
-    free(xp);
-    sr_free_change_iter(iter);
-
-    /* return value is ignored anyway */
-    return SR_ERR_OK;
+    free(target);
+    free(prefix);
+    return rc;
 }
 
 /**
- * @brief Subscribe to module changes of a module.
+ * @brief Move edits of a push-change-update notification exceeding the maximum edit count into a new notification.
  *
- * @param[in] ly_mod Module to subscribe to.
- * @param[in] user_sess User sysrepo session.
- * @param[in] xpath XPath filter to use.
- * @param[in] private_data Private data to set for the callback.
- * @param[in] ev_sess Event sysrepo session for errors.
- * @param[in,out] sub_ids Array of SR sub IDs to add to.
- * @param[in,out] sub_id_count Number of items in @p sub_ids.
+ * @param[in] ly_ntf Notification to split.
+ * @param[in] yp_data yang-push data.
+ * @param[in] nc_sub_id NC sub ID of the subscription.
+ * @param[out] ly_ntf_rest Notification with the remaining edits, NULL if there are none.
  * @return Sysrepo error value.
  */
 static int
-yang_push_sr_subscribe_mod(const struct lys_module *ly_mod, sr_session_ctx_t *user_sess, const char *xpath,
-        void *private_data, sr_session_ctx_t *ev_sess, uint32_t **sub_ids, uint32_t *sub_id_count)
+yang_push_notif_change_split(struct lyd_node *ly_ntf, struct yang_push_data *yp_data, uint32_t nc_sub_id,
+        struct lyd_node **ly_ntf_rest)
 {
-    void *mem;
-    const sr_error_info_t *err_info;
-    int rc;
+    struct lyd_node *ly_yp, *ly_edit, *next;
+    uint32_t edit_count = 0, patch_id;
+    char buf[26];
 
-    /* allocate a new sub ID */
-    mem = realloc(*sub_ids, (*sub_id_count + 1) * sizeof **sub_ids);
-    if (!mem) {
-        EMEM;
-        return SR_ERR_NO_MEMORY;
-    }
-    *sub_ids = mem;
+    *ly_ntf_rest = NULL;
 
-    /* subscribe to the module */
-    rc = sr_module_change_subscribe(user_sess, ly_mod->name, xpath, np2srv_change_yang_push_cb, private_data,
-            0, SR_SUBSCR_CTX_REUSE | SR_SUBSCR_PASSIVE | SR_SUBSCR_DONE_ONLY, &np2srv.sr_data_sub);
-    if (rc != SR_ERR_OK) {
-        sr_session_get_error(user_sess, &err_info);
-        sr_session_set_error_message(ev_sess, err_info->err[0].message);
-        return rc;
+    /* find the first edit over the limit */
+    ly_yp = lyd_child(lyd_child(ly_ntf)->next);
+    LY_LIST_FOR(lyd_child(ly_yp), ly_edit) {
+        if (!strcmp(LYD_NAME(ly_edit), "edit") && (++edit_count > NP2SRV_YANG_PUSH_MAX_EDITS)) {
+            break;
+        }
+    }
+    if (!ly_edit) {
+        /* small enough */
+        return SR_ERR_OK;
     }
 
-    /* add new sub ID */
-    (*sub_ids)[*sub_id_count] = sr_subscription_get_last_sub_id(np2srv.sr_data_sub);
-    ++(*sub_id_count);
-
+    /* create basic structure for another push-change-update notification with a new patch-id */
+    sprintf(buf, "%" PRIu32, nc_sub_id);
+    if (lyd_new_path(NULL, LYD_CTX(ly_ntf), "/ietf-yang-push:push-change-update/id", buf, 0, ly_ntf_rest)) {
+        return SR_ERR_LY;
+    }
+    patch_id = ATOMIC_INC_RELAXED(yp_data->patch_id);
+    sprintf(buf, "patch-%" PRIu32, patch_id);
+    if (lyd_new_path(*ly_ntf_rest, NULL, "datastore-changes/yang-patch/patch-id", buf, 0, NULL)) {
+        return SR_ERR_LY;
+    }
+    ly_yp = lyd_child(lyd_child(*ly_ntf_rest)->next);
+
+    /* move all the remaining edits */
+    LY_LIST_FOR_SAFE(ly_edit, next, ly_edit) {
+        lyd_unlink_tree(ly_edit);
+        if (lyd_insert_child(ly_yp, ly_edit)) {
+            lyd_free_tree(ly_edit);
+            return SR_ERR_LY;
+        }
+    }
+
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Send an on-change push-change-update yang-push notification.
+ *
+ * @param[in] ncs NETCONF session.
+ * @param[in] yp_data yang-push data with the notification.
+ * @param[in] nc_sub_id NC sub ID of the subscription.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_notif_change_send(struct nc_session *ncs, struct yang_push_data *yp_data, uint32_t nc_sub_id)
+{
+    struct lyd_node *ly_yp, *ly_ntf = NULL;
+    int rc = SR_ERR_OK;
+
+    assert(yp_data->ly_change_ntf);
+
+    /* the edits are final */
+    yang_push_edit_idx_clear(yp_data);
+
+    /* the changes are already NACM filtered */
+    ly_yp = lyd_child(lyd_child(yp_data->ly_change_ntf)->next);
+    if (!lyd_child(ly_yp)->next) {
+        /* only patch-id, all the changes were coalesced away or denied */
+        if (yp_data->change_denied) {
+            /* no change is actually readable, notification denied */
+            sub_ntf_inc_denied(nc_sub_id);
+        }
+        goto cleanup;
+    }
+
+    /* send the notification, split into several patches if too large */
+    do {
+        rc = yang_push_notif_change_split(yp_data->ly_change_ntf, yp_data, nc_sub_id, &ly_ntf);
+        if (rc != SR_ERR_OK) {
+            goto cleanup;
+        }
+
+        SUB_DBG(NP2LOG_YANG_PUSH, "Session %d: subscription %" PRIu32 " sending push-change-update.",
+                nc_session_get_id(ncs), nc_sub_id);
+        rc = sub_ntf_send_notif(ncs, nc_sub_id, np_gettimespec(), &yp_data->ly_change_ntf, 1);
+        yp_data->ly_change_ntf = ly_ntf;
+        ly_ntf = NULL;
+    } while ((rc == SR_ERR_OK) && yp_data->ly_change_ntf);
+
+    if (rc == SR_ERR_OK) {
+        /* set last_notif timestamp */
+        yp_data->last_notif = np_gettimespec();
+    }
+
+cleanup:
+    lyd_free_tree(ly_ntf);
+    lyd_free_tree(yp_data->ly_change_ntf);
+    yp_data->ly_change_ntf = NULL;
+    yp_data->change_denied = 0;
+    return rc;
+}
+
+/**
+ * @brief Timer callback for dampened on-change yang-push changes.
+ *
+ * The argument is the subscription ID so that nothing of the subscription is accessed before it is found.
+ */
+static void
+yang_push_damp_timer_cb(void *cb_arg)
+{
+    struct np2srv_sub_ntf *sub;
+    struct yang_push_data *yp_data;
+
+    /* READ LOCK */
+    sub = sub_ntf_find_lock((uintptr_t)cb_arg, 0);
+    if (!sub) {
+        return;
+    }
+    yp_data = sub->data;
+
+    /* NOTIF LOCK */
+    pthread_mutex_lock(&yp_data->notif_lock);
+
+    /* send the postponed on-change notification, if not sent meanwhile */
+    if (yp_data->ly_change_ntf) {
+        yang_push_notif_change_send(yp_data->cb_arg.ncs, yp_data, yp_data->cb_arg.nc_sub_id);
+    }
+
+    /* NOTIF UNLOCK */
+    pthread_mutex_unlock(&yp_data->notif_lock);
+
+    /* UNLOCK */
+    sub_ntf_unlock();
+}
+
+/**
+ * @brief Check whether an on-change yang-push notification is ready to be sent or will be postponed.
+ *
+ * @param[in] yp_data yang-push data.
+ * @param[out] ready Whether the notification can be sent or was scheduled to be sent later.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_notif_change_ready(struct yang_push_data *yp_data, int *ready)
+{
+    struct timespec next_notif, cur_time;
+    int32_t next_notif_in;
+
+    if (!yp_data->dampening_period_ms) {
+        /* always ready */
+        *ready = 1;
+        return SR_ERR_OK;
+    }
+
+    /* check current timer */
+    if (np_timer_is_pending(&yp_data->damp_timer)) {
+        /* timer is already set */
+        *ready = 0;
+        return SR_ERR_OK;
+    }
+
+    /* learn when the next notification is due */
+    cur_time = np_gettimespec();
+    next_notif = yp_data->last_notif;
+    np_addtimespec(&next_notif, yp_data->dampening_period_ms);
+    next_notif_in = np_difftimespec(&cur_time, &next_notif);
+
+    if (next_notif_in <= 0) {
+        /* can be sent */
+        *ready = 1;
+        return SR_ERR_OK;
+    }
+
+    /* schedule the notification */
+    np_timer_set(&yp_data->damp_timer, next_notif, 0);
+
+    *ready = 0;
     return SR_ERR_OK;
 }
 
+/**
+ * @brief Add the dispatched changes of an on-change subscription into its push-change-update notification and send it,
+ * if ready.
+ *
+ * @param[in] member Dispatcher member with the indices of its changes.
+ * @param[in] changes All the dispatched changes.
+ */
+static void
+yang_push_notif_change_add(const struct yang_push_dispatch_member *member, const struct yang_push_change *changes)
+{
+    struct yang_push_data *yp_data = member->yp_data;
+    const struct yang_push_change *change;
+    struct lyd_node *ly_yp = NULL;
+    enum yang_push_op yp_op;
+    char buf[26];
+    int ready;
+    uint32_t i, patch_id;
+
+    assert(!yp_data->periodic);
+
+    /* NOTIF LOCK */
+    pthread_mutex_lock(&yp_data->notif_lock);
+
+    for (i = 0; i < member->change_count; ++i) {
+        change = &changes[member->changes[i]];
+
+        /* learn yang-push operation */
+        yp_op = yang_push_op_sr2yp(change->op, change->node);
+        if (yp_data->excluded_change[yp_op]) {
+            /* excluded */
+            ATOMIC_INC_RELAXED(yp_data->excluded_op_count);
+            continue;
+        }
+
+        /* there is a change */
+        if (!yp_data->ly_change_ntf) {
+            /* create basic structure for push-change-update notification */
+            sprintf(buf, "%" PRIu32, yp_data->cb_arg.nc_sub_id);
+            if (lyd_new_path(NULL, sr_get_context(np2srv.sr_conn), "/ietf-yang-push:push-change-update/id", buf, 0,
+                    &yp_data->ly_change_ntf)) {
+                goto cleanup;
+            }
+
+            /* generate a new patch-id */
+            patch_id = ATOMIC_INC_RELAXED(yp_data->patch_id);
+            sprintf(buf, "patch-%" PRIu32, patch_id);
+            if (lyd_new_path(yp_data->ly_change_ntf, NULL, "datastore-changes/yang-patch/patch-id", buf, 0, NULL)) {
+                goto cleanup;
+            }
+
+            /* initialize edit-id */
+            ATOMIC_STORE_RELAXED(yp_data->edit_id, 1);
+        }
+        if (!ly_yp) {
+            ly_yp = lyd_child(lyd_child(yp_data->ly_change_ntf)->next);
+        }
+
+        /* add the edit, coalesced with previous changes of the node */
+        if (yang_push_notif_change_edit_add(ly_yp, yp_op, change->node, change->prev_value, change->prev_list,
+                yp_data)) {
+            goto cleanup;
+        }
+    }
+
+    if (!yp_data->ly_change_ntf) {
+        /* there are actually no changes */
+        goto cleanup;
+    }
+
+    /* check whether the notification can be sent now */
+    if (yang_push_notif_change_ready(yp_data, &ready)) {
+        goto cleanup;
+    }
+
+    /* send the notification */
+    if (ready) {
+        yang_push_notif_change_send(yp_data->cb_arg.ncs, yp_data, yp_data->cb_arg.nc_sub_id);
+    }
+
+cleanup:
+    /* NOTIF UNLOCK */
+    pthread_mutex_unlock(&yp_data->notif_lock);
+}
+
+/**
+ * @brief Find the members of a change dispatcher with filters selecting a schema node.
+ *
+ * @param[in] disp Change dispatcher.
+ * @param[in] schema Schema node to find.
+ * @return Filter index item, NULL if there is none.
+ */
+static const struct yang_push_dispatch_schema *
+yang_push_dispatch_schema_find(const struct yang_push_dispatch *disp, const struct lysc_node *schema)
+{
+    uint32_t lo = 0, hi = disp->schema_idx_count, mid;
+
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (disp->schema_idx[mid].schema == schema) {
+            return &disp->schema_idx[mid];
+        } else if ((uintptr_t)disp->schema_idx[mid].schema < (uintptr_t)schema) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief Check whether a changed node is selected by the instance filter of a change dispatcher member.
+ *
+ * @param[in] member Change dispatcher member.
+ * @param[in] diff Diff with all the changes.
+ * @param[in] node Changed node in @p diff.
+ * @return Whether the node or any of its parents is selected by the filter.
+ */
+static int
+yang_push_dispatch_instance_match(struct yang_push_dispatch_member *member, const struct lyd_node *diff,
+        const struct lyd_node *node)
+{
+    if (!member->filter_nodes) {
+        /* evaluate the filter on the diff once for all the changes, the same way sysrepo would */
+        if (lyd_find_xpath(diff, member->xpath, &member->filter_nodes)) {
+            ERR("Evaluating yang-push filter \"%s\" failed.", member->xpath);
+            return 0;
+        }
+    }
+
+    for ( ; node; node = lyd_parent(node)) {
+        if (ly_set_contains(member->filter_nodes, node, NULL)) {
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
+/**
+ * @brief Add a change to a change dispatcher member, if selected by its filter.
+ *
+ * @param[in] member Change dispatcher member.
+ * @param[in] diff Diff with all the changes.
+ * @param[in] node Changed node in @p diff.
+ * @param[in] change Index of the change.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_dispatch_member_add(struct yang_push_dispatch_member *member, const struct lyd_node *diff,
+        const struct lyd_node *node, uint32_t change)
+{
+    void *mem;
+
+    if (member->change_count && (member->changes[member->change_count - 1] == change)) {
+        /* already added */
+        return SR_ERR_OK;
+    }
+
+    if (member->instance_filter && !yang_push_dispatch_instance_match(member, diff, node)) {
+        /* not selected */
+        return SR_ERR_OK;
+    }
+
+    if (member->change_count == member->change_size) {
+        mem = realloc(member->changes, (member->change_size ? member->change_size * 2 : 8) * sizeof *member->changes);
+        if (!mem) {
+            EMEM;
+            return SR_ERR_NO_MEMORY;
+        }
+        member->changes = mem;
+        member->change_size = member->change_size ? member->change_size * 2 : 8;
+    }
+    member->changes[member->change_count] = change;
+    ++member->change_count;
+
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Add a change to all the change dispatcher members with a filter selecting it.
+ *
+ * @param[in] disp Change dispatcher.
+ * @param[in] diff Diff with all the changes.
+ * @param[in] node Changed node in @p diff.
+ * @param[in] change Index of the change.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_dispatch_match(struct yang_push_dispatch *disp, const struct lyd_node *diff, const struct lyd_node *node,
+        uint32_t change)
+{
+    const struct yang_push_dispatch_schema *idx;
+    const struct lysc_node *schema;
+    uint32_t i;
+    int rc;
+
+    /* members with filters selecting the whole module */
+    for (i = 0; i < disp->module_member_count; ++i) {
+        if ((rc = yang_push_dispatch_member_add(&disp->members[disp->module_members[i]], diff, node, change))) {
+            return rc;
+        }
+    }
+
+    /* members with filters selecting the node or any of its parents */
+    for (schema = node->schema; schema; schema = schema->parent) {
+        idx = yang_push_dispatch_schema_find(disp, schema);
+        if (!idx) {
+            continue;
+        }
+
+        for (i = 0; i < idx->member_count; ++i) {
+            if ((rc = yang_push_dispatch_member_add(&disp->members[idx->members[i]], diff, node, change))) {
+                return rc;
+            }
+        }
+    }
+
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Module change callback of a yang-push change dispatcher, iterates the changes once for all
+ * the on-change subscriptions.
+ */
+static int
+np2srv_change_yang_push_cb(sr_session_ctx_t *session, uint32_t UNUSED(sub_id), const char *module_name,
+        const char *UNUSED(xpath), sr_event_t UNUSED(event), uint32_t UNUSED(request_id), void *private_data)
+{
+    struct yang_push_dispatch *disp = private_data;
+    struct yang_push_dispatch_member *member;
+    struct yang_push_change *changes = NULL, *change;
+    const struct lyd_node *diff;
+    sr_change_iter_t *iter = NULL;
+    char *xp = NULL;
+    uint32_t i, change_count = 0, change_size = 0;
+    void *mem;
+
+    if (asprintf(&xp, "/%s:*//.", module_name) == -1) {
+        EMEM;
+        goto cleanup;
+    }
+    if (sr_get_changes_iter(session, xp, &iter) != SR_ERR_OK) {
+        goto cleanup;
+    }
+    diff = sr_get_change_diff(session);
+
+    /* DISPATCH LOCK */
+    pthread_mutex_lock(&disp->lock);
+
+    while (1) {
+        if (change_count == change_size) {
+            mem = realloc(changes, (change_size ? change_size * 2 : 32) * sizeof *changes);
+            if (!mem) {
+                EMEM;
+                goto cleanup_unlock;
+            }
+            changes = mem;
+            change_size = change_size ? change_size * 2 : 32;
+        }
+
+        /* get the next change */
+        change = &changes[change_count];
+        if (sr_get_change_tree_next(session, iter, &change->op, &change->node, &change->prev_value, &change->prev_list,
+                NULL) != SR_ERR_OK) {
+            break;
+        }
+
+        /* pass it to all the subscriptions with a filter selecting it */
+        if (yang_push_dispatch_match(disp, diff, change->node, change_count)) {
+            goto cleanup_unlock;
+        }
+        ++change_count;
+    }
+
+    for (i = 0; i < disp->member_count; ++i) {
+        member = &disp->members[i];
+        if (member->change_count) {
+            yang_push_notif_change_add(member, changes);
+        } else {
+            /* nothing selected by the filter */
+            ATOMIC_INC_RELAXED(member->yp_data->filtered_out_count);
+        }
+    }
+
+cleanup_unlock:
+    for (i = 0; i < disp->member_count; ++i) {
+        member = &disp->members[i];
+        member->change_count = 0;
+        ly_set_free(member->filter_nodes, NULL);
+        member->filter_nodes = NULL;
+    }
+
+    /* DISPATCH UNLOCK */
+    pthread_mutex_unlock(&disp->lock);
+
+cleanup:
+    free(xp);
+    free(changes);
+    sr_free_change_iter(iter);
+
+    /* return value is ignored anyway */
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Free the filter index of a change dispatcher.
+ *
+ * @param[in] disp Change dispatcher.
+ */
+static void
+yang_push_dispatch_index_clear(struct yang_push_dispatch *disp)
+{
+    uint32_t i;
+
+    for (i = 0; i < disp->schema_idx_count; ++i) {
+        free(disp->schema_idx[i].members);
+    }
+    free(disp->schema_idx);
+    disp->schema_idx = NULL;
+    disp->schema_idx_count = 0;
+
+    free(disp->module_members);
+    disp->module_members = NULL;
+    disp->module_member_count = 0;
+}
+
+/**
+ * @brief Add a member into the filter index of a change dispatcher.
+ *
+ * @param[in] disp Change dispatcher.
+ * @param[in] schema Schema node selected by the member filter.
+ * @param[in] member Index of the member.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_dispatch_index_add(struct yang_push_dispatch *disp, const struct lysc_node *schema, uint32_t member)
+{
+    struct yang_push_dispatch_schema *idx;
+    uint32_t lo = 0, hi = disp->schema_idx_count, mid;
+    void *mem;
+
+    /* find the schema node */
+    while (lo < hi) {
+        mid = lo + (hi - lo) / 2;
+        if (disp->schema_idx[mid].schema == schema) {
+            lo = mid;
+            break;
+        } else if ((uintptr_t)disp->schema_idx[mid].schema < (uintptr_t)schema) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    if ((lo == disp->schema_idx_count) || (disp->schema_idx[lo].schema != schema)) {
+        /* insert a new schema node */
+        mem = realloc(disp->schema_idx, (disp->schema_idx_count + 1) * sizeof *disp->schema_idx);
+        if (!mem) {
+            return SR_ERR_NO_MEMORY;
+        }
+        disp->schema_idx = mem;
+        if (lo < disp->schema_idx_count) {
+            memmove(&disp->schema_idx[lo + 1], &disp->schema_idx[lo],
+                    (disp->schema_idx_count - lo) * sizeof *disp->schema_idx);
+        }
+        memset(&disp->schema_idx[lo], 0, sizeof *disp->schema_idx);
+        disp->schema_idx[lo].schema = schema;
+        ++disp->schema_idx_count;
+    }
+    idx = &disp->schema_idx[lo];
+
+    /* add the member */
+    mem = realloc(idx->members, (idx->member_count + 1) * sizeof *idx->members);
+    if (!mem) {
+        return SR_ERR_NO_MEMORY;
+    }
+    idx->members = mem;
+    idx->members[idx->member_count] = member;
+    ++idx->member_count;
+
+    return SR_ERR_OK;
+}
+
+/**
+ * @brief Rebuild the filter index of a change dispatcher after its members changed.
+ * If it fails, no changes are dispatched.
+ *
+ * @param[in] disp Change dispatcher.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_dispatch_index(struct yang_push_dispatch *disp)
+{
+    struct yang_push_dispatch_member *member;
+    uint32_t i, j;
+    void *mem;
+    int rc = SR_ERR_OK;
+
+    yang_push_dispatch_index_clear(disp);
+
+    for (i = 0; i < disp->member_count; ++i) {
+        member = &disp->members[i];
+
+        if (!member->schemas) {
+            /* any change of the module may be selected */
+            mem = realloc(disp->module_members, (disp->module_member_count + 1) * sizeof *disp->module_members);
+            if (!mem) {
+                rc = SR_ERR_NO_MEMORY;
+                goto cleanup;
+            }
+            disp->module_members = mem;
+            disp->module_members[disp->module_member_count] = i;
+            ++disp->module_member_count;
+            continue;
+        }
+
+        for (j = 0; j < member->schemas->count; ++j) {
+            if ((rc = yang_push_dispatch_index_add(disp, member->schemas->snodes[j], i))) {
+                goto cleanup;
+            }
+        }
+    }
+
+cleanup:
+    if (rc) {
+        EMEM;
+        yang_push_dispatch_index_clear(disp);
+    }
+    return rc;
+}
+
+/**
+ * @brief Free a change dispatcher, unsubscribe it first.
+ *
+ * @param[in] disp Change dispatcher to free.
+ */
+static void
+yang_push_dispatch_free(struct yang_push_dispatch *disp)
+{
+    if (!disp) {
+        return;
+    }
+
+    assert(!disp->member_count);
+
+    /* once unsubscribed, the callback is not running and will not be called */
+    if (disp->sub_id) {
+        sr_unsubscribe_sub(*disp->sub_ctx, disp->sub_id);
+    }
+    sr_session_stop(disp->sess);
+    yang_push_dispatch_index_clear(disp);
+    pthread_mutex_destroy(&disp->lock);
+    free(disp->members);
+    free(disp);
+}
+
+/**
+ * @brief Add an on-change subscription into the change dispatcher of a module and its datastore, create a new
+ * dispatcher if there is none.
+ * sub-ntf WRITE lock held.
+ *
+ * @param[in] ly_mod Module to subscribe to.
+ * @param[in] yp_data yang-push data of the subscription.
+ * @param[in] ev_sess Event sysrepo session for errors, if any.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_dispatch_join(const struct lys_module *ly_mod, struct yang_push_data *yp_data, sr_session_ctx_t *ev_sess)
+{
+    struct yang_push_dispatch *disp = NULL, *new_disp = NULL;
+    struct yang_push_dispatch_member *member;
+    const sr_error_info_t *err_info;
+    uint32_t i;
+    void *mem;
+    int rc = SR_ERR_OK;
+
+    assert(!yp_data->periodic);
+
+    for (i = 0; i < yp_dispatch.count; ++i) {
+        if ((yp_dispatch.dispatch[i]->ly_mod == ly_mod) && (yp_dispatch.dispatch[i]->datastore == yp_data->datastore)) {
+            disp = yp_dispatch.dispatch[i];
+            break;
+        }
+    }
+
+    mem = realloc(yp_data->dispatch, (yp_data->dispatch_count + 1) * sizeof *yp_data->dispatch);
+    if (!mem) {
+        rc = SR_ERR_NO_MEMORY;
+        goto cleanup;
+    }
+    yp_data->dispatch = mem;
+
+    if (!disp) {
+        /* create a new dispatcher */
+        disp = new_disp = calloc(1, sizeof *disp);
+        if (!disp) {
+            rc = SR_ERR_NO_MEMORY;
+            goto cleanup;
+        }
+        pthread_mutex_init(&disp->lock, NULL);
+        disp->ly_mod = ly_mod;
+        disp->datastore = yp_data->datastore;
+
+        mem = realloc(yp_dispatch.dispatch, (yp_dispatch.count + 1) * sizeof *yp_dispatch.dispatch);
+        if (!mem) {
+            rc = SR_ERR_NO_MEMORY;
+            goto cleanup;
+        }
+        yp_dispatch.dispatch = mem;
+
+        /* a separate session for the dispatcher subscription, it does not depend on any NETCONF session */
+        rc = sr_session_start(np2srv.sr_conn, disp->datastore, &disp->sess);
+        if (rc != SR_ERR_OK) {
+            goto cleanup;
+        }
+
+        /* subscribe to all the changes of the module, the dispatchers are spread among the contexts and
+         * a context is created with its own thread by the first subscription */
+        disp->sub_ctx = &np2srv.sr_yp_sub[yp_dispatch.last_ctx++ % NP2SRV_YANG_PUSH_THREAD_COUNT];
+        rc = sr_module_change_subscribe(disp->sess, ly_mod->name, NULL, np2srv_change_yang_push_cb, disp, 0,
+                SR_SUBSCR_CTX_REUSE | SR_SUBSCR_DONE_ONLY, disp->sub_ctx);
+        if (rc != SR_ERR_OK) {
+            if (ev_sess) {
+                sr_session_get_error(disp->sess, &err_info);
+                sr_session_set_error_message(ev_sess, err_info->err[0].message);
+            }
+            goto cleanup;
+        }
+        disp->sub_id = sr_subscription_get_last_sub_id(*disp->sub_ctx);
+    }
+
+    /* DISPATCH LOCK */
+    pthread_mutex_lock(&disp->lock);
+
+    /* add the subscription */
+    mem = realloc(disp->members, (disp->member_count + 1) * sizeof *disp->members);
+    if (!mem) {
+        /* DISPATCH UNLOCK */
+        pthread_mutex_unlock(&disp->lock);
+        rc = SR_ERR_NO_MEMORY;
+        goto cleanup;
+    }
+    disp->members = mem;
+    member = &disp->members[disp->member_count];
+    memset(member, 0, sizeof *member);
+    member->yp_data = yp_data;
+    if (yp_data->xpath) {
+        member->xpath = strdup(yp_data->xpath);
+        if (!member->xpath) {
+            /* DISPATCH UNLOCK */
+            pthread_mutex_unlock(&disp->lock);
+            rc = SR_ERR_NO_MEMORY;
+            goto cleanup;
+        }
+
+        /* precompile the filter into the schema nodes it selects, if possible */
+        if (lys_find_xpath(ly_mod->ctx, NULL, member->xpath, 0, &member->schemas)) {
+            /* filter every change of the module */
+            member->schemas = NULL;
+            member->instance_filter = 1;
+        } else {
+            /* predicates and functions depend on the data */
+            member->instance_filter = strpbrk(member->xpath, "[(") ? 1 : 0;
+        }
+    }
+    ++disp->member_count;
+    rc = yang_push_dispatch_index(disp);
+
+    /* DISPATCH UNLOCK */
+    pthread_mutex_unlock(&disp->lock);
+
+    /* the subscription is a member now, even on error */
+    yp_data->dispatch[yp_data->dispatch_count] = disp;
+    ++yp_data->dispatch_count;
+    if (new_disp) {
+        yp_dispatch.dispatch[yp_dispatch.count] = disp;
+        ++yp_dispatch.count;
+        new_disp = NULL;
+    }
+
+cleanup:
+    yang_push_dispatch_free(new_disp);
+    return rc;
+}
+
+/**
+ * @brief Remove an on-change subscription from all its change dispatchers, free the dispatchers left empty.
+ * sub-ntf WRITE lock held.
+ *
+ * @param[in] yp_data yang-push data of the subscription.
+ */
+static void
+yang_push_dispatch_leave(struct yang_push_data *yp_data)
+{
+    struct yang_push_dispatch *disp;
+    struct yang_push_dispatch_member *member;
+    uint32_t i, j;
+
+    for (i = 0; i < yp_data->dispatch_count; ++i) {
+        disp = yp_data->dispatch[i];
+
+        /* DISPATCH LOCK, waits for any changes being dispatched */
+        pthread_mutex_lock(&disp->lock);
+
+        /* remove the subscription */
+        for (j = 0; disp->members[j].yp_data != yp_data; ++j) {}
+        member = &disp->members[j];
+        free(member->xpath);
+        ly_set_free(member->schemas, NULL);
+        free(member->changes);
+        --disp->member_count;
+        if (j < disp->member_count) {
+            *member = disp->members[disp->member_count];
+        }
+        yang_push_dispatch_index(disp);
+
+        /* DISPATCH UNLOCK */
+        pthread_mutex_unlock(&disp->lock);
+
+        if (!disp->member_count) {
+            /* remove the dispatcher */
+            for (j = 0; yp_dispatch.dispatch[j] != disp; ++j) {}
+            --yp_dispatch.count;
+            if (j < yp_dispatch.count) {
+                yp_dispatch.dispatch[j] = yp_dispatch.dispatch[yp_dispatch.count];
+            }
+            yang_push_dispatch_free(disp);
+        }
+    }
+
+    free(yp_data->dispatch);
+    yp_data->dispatch = NULL;
+    yp_data->dispatch_count = 0;
+}
+
 /**
  * @brief Collect all modules with data selected by an XPath.
  *
@@ -623,80 +1601,75 @@ cleanup:
 }
 
 /**
- * @brief Create all sysrepo subscriptions for a single sub-ntf subscription.
+ * @brief Join the change dispatchers of all the modules with data selected by an on-change subscription.
+ * sub-ntf WRITE lock held.
  *
- * @param[in] user_sess User session to use for sysrepo calls.
- * @param[in] stream Stream to subscribe to.
- * @param[in] xpath Filter to use.
- * @param[in] start Replay start time.
- * @param[in] stop Subscription stop time.
- * @param[in] private_data User data to set when subscribing.
- * @param[in] ev_sess Event session for reporting errors.
- * @param[out] sub_ids Generated sysrepo subscription IDs, the first one is used as sub-ntf subscription ID.
- * @param[out] sub_id_count Number of @p sub_ids.
+ * @param[in] yp_data yang-push data of the subscription.
+ * @param[in] ev_sess Event session for reporting errors, if any.
  * @return Sysrepo error value.
  */
 static int
-yang_push_sr_subscribe(sr_session_ctx_t *user_sess, sr_datastore_t ds, const char *xpath, void *private_data,
-        sr_session_ctx_t *ev_sess, uint32_t **sub_ids, uint32_t *sub_id_count)
+yang_push_sr_subscribe(struct yang_push_data *yp_data, sr_session_ctx_t *ev_sess)
 {
-    const struct ly_ctx *ly_ctx = sr_get_context(sr_session_get_connection(user_sess));
-    const struct lys_module *ly_mod;
+    const struct ly_ctx *ly_ctx = sr_get_context(np2srv.sr_conn);
+    const struct np_mod_idx *mod_idx;
+    const struct lys_module **mods = NULL;
     struct ly_set *mod_set = NULL;
+    sr_datastore_t ds = yp_data->datastore;
     int rc;
-    uint32_t idx, config_mask = (ds == SR_DS_OPERATIONAL) ? LYS_CONFIG_MASK : LYS_CONFIG_W;
-
-    *sub_ids = NULL;
-    *sub_id_count = 0;
+    uint32_t idx, mod_count, config_mask = (ds == SR_DS_OPERATIONAL) ? LYS_CONFIG_MASK : LYS_CONFIG_W;
 
-    /* switch to the correct datastore */
-    sr_session_switch_ds(user_sess, ds);
-
-    if (!xpath) {
-        /* subscribe to all modules with (configuration) data */
-        idx = 0;
-        while ((ly_mod = ly_ctx_get_module_iter(ly_ctx, &idx))) {
-            if (!ly_mod->implemented) {
-                continue;
-            }
+    if (!yp_data->xpath) {
+        /* learn all modules with (configuration) data, do not keep the index locked while subscribing */
+        mod_idx = np_mod_idx_get(np2srv.sr_conn);
+        if (!mod_idx) {
+            rc = SR_ERR_INTERNAL;
+            goto error;
+        }
+        mod_count = (ds == SR_DS_OPERATIONAL) ? mod_idx->data_count : mod_idx->config_count;
+        mods = malloc(mod_count * sizeof *mods);
+        if (mod_count && !mods) {
+            np_mod_idx_release();
+            EMEM;
+            rc = SR_ERR_NO_MEMORY;
+            goto error;
+        }
+        if (mod_count) {
+            memcpy(mods, (ds == SR_DS_OPERATIONAL) ? mod_idx->data : mod_idx->config, mod_count * sizeof *mods);
+        }
+        np_mod_idx_release();
 
-            if (np_ly_mod_has_data(ly_mod, config_mask)) {
-                /* subscribe to the module */
-                rc = yang_push_sr_subscribe_mod(ly_mod, user_sess, xpath, private_data, ev_sess, sub_ids, sub_id_count);
-                if (rc != SR_ERR_OK) {
-                    goto error;
-                }
+        /* subscribe to all of them */
+        for (idx = 0; idx < mod_count; ++idx) {
+            rc = yang_push_dispatch_join(mods[idx], yp_data, ev_sess);
+            if (rc != SR_ERR_OK) {
+                goto error;
             }
         }
     } else {
         /* subscribe to all the relevant modules with the filter */
-        rc = yang_push_sr_subscribe_filter_collect_mods(ly_ctx, xpath, config_mask, &mod_set);
+        rc = yang_push_sr_subscribe_filter_collect_mods(ly_ctx, yp_data->xpath, config_mask, &mod_set);
         if (rc != SR_ERR_OK) {
             goto error;
         }
 
         for (idx = 0; idx < mod_set->count; ++idx) {
             /* subscribe to the module */
-            rc = yang_push_sr_subscribe_mod(mod_set->objs[idx], user_sess, xpath, private_data, ev_sess, sub_ids,
-                    sub_id_count);
+            rc = yang_push_dispatch_join(mod_set->objs[idx], yp_data, ev_sess);
             if (rc != SR_ERR_OK) {
                 goto error;
             }
         }
     }
 
+    free(mods);
     ly_set_free(mod_set, NULL);
     return SR_ERR_OK;
 
 error:
+    free(mods);
     ly_set_free(mod_set, NULL);
-
-    for (idx = 0; idx < *sub_id_count; ++idx) {
-        sr_unsubscribe_sub(np2srv.sr_data_sub, (*sub_ids)[idx]);
-    }
-    free(*sub_ids);
-    *sub_ids = NULL;
-    *sub_id_count = 0;
+    yang_push_dispatch_leave(yp_data);
     return rc;
 }
 
@@ -816,132 +1789,658 @@ yang_push_rpc_filter2xpath(sr_session_ctx_t *user_sess, const struct lyd_node *r
         }
     }
 
-cleanup:
-    lyd_free_tree(subtree);
-    op_filter_erase(&filter);
-    return rc;
+cleanup:
+    lyd_free_tree(subtree);
+    op_filter_erase(&filter);
+    return rc;
+}
+
+/**
+ * @brief Send a push-update yang-push notification with prepared datastore contents.
+ *
+ * @param[in] ncs NETCONF session.
+ * @param[in] nc_sub_id NC sub ID of the subscription.
+ * @param[in] data Datastore contents to use, are spent. Ignored if @p data_xml is set.
+ * @param[in] data_xml Printed datastore contents to use, are copied.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_notif_update_send_data(struct nc_session *ncs, uint32_t nc_sub_id, struct lyd_node *data, const char *data_xml)
+{
+    struct lyd_node *ly_ntf = NULL;
+    char buf[11];
+    int rc = SR_ERR_OK;
+
+    /* create the notification */
+    sprintf(buf, "%" PRIu32, nc_sub_id);
+    if (lyd_new_path(NULL, sr_get_context(np2srv.sr_conn), "/ietf-yang-push:push-update/id", buf, 0, &ly_ntf)) {
+        rc = SR_ERR_LY;
+        goto cleanup;
+    }
+
+    /* datastore-contents */
+    if (data_xml) {
+        if (lyd_new_any(ly_ntf, NULL, "datastore-contents", data_xml, 0, LYD_ANYDATA_XML, 0, NULL)) {
+            rc = SR_ERR_LY;
+            goto cleanup;
+        }
+    } else {
+        if (lyd_new_any(ly_ntf, NULL, "datastore-contents", data, 1, LYD_ANYDATA_DATATREE, 0, NULL)) {
+            rc = SR_ERR_LY;
+            goto cleanup;
+        }
+        data = NULL;
+    }
+
+    /* send the notification */
+    rc = sub_ntf_send_notif(ncs, nc_sub_id, np_gettimespec(), &ly_ntf, 1);
+    if (rc != SR_ERR_OK) {
+        goto cleanup;
+    }
+
+cleanup:
+    if (!data_xml) {
+        lyd_free_siblings(data);
+    }
+    lyd_free_tree(ly_ntf);
+    return rc;
+}
+
+/**
+ * @brief Send a push-update yang-push notification.
+ *
+ * @param[in] ncs NETCONF session.
+ * @param[in] yp_data yang-push data with the datastore, filter, and counters.
+ * @param[in] nc_sub_id NC sub ID of the subscription.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_notif_update_send(struct nc_session *ncs, struct yang_push_data *yp_data, uint32_t nc_sub_id)
+{
+    struct np2_user_sess *user_sess;
+    struct lyd_node *data = NULL;
+    int rc = SR_ERR_OK;
+
+    /* get user session from NETCONF session */
+    user_sess = nc_session_get_data(ncs);
+    ATOMIC_INC_RELAXED(user_sess->ref_count);
+
+    /* switch to the datastore */
+    sr_session_switch_ds(user_sess->sess, yp_data->datastore);
+
+    /* get the data from sysrepo */
+    rc = sr_get_data(user_sess->sess, yp_data->xpath ? yp_data->xpath : "/*", 0, np2srv.sr_timeout, 0, &data);
+    if (rc != SR_ERR_OK) {
+        goto cleanup;
+    }
+
+    /* NACM filter */
+    ncac_check_data_read_filter(&data, nc_session_get_username(ncs));
+
+    /* send the notification */
+    rc = yang_push_notif_update_send_data(ncs, nc_sub_id, data, NULL);
+    data = NULL;
+
+cleanup:
+    lyd_free_siblings(data);
+    np_release_user_sess(user_sess);
+    return rc;
+}
+
+/**
+ * @brief Send a periodic update of a subscription with delta updates, push-update notification with the complete data
+ * if a full update is due, otherwise push-change-update notification with the changes since the previous update.
+ *
+ * @param[in] ncs NETCONF session.
+ * @param[in] yp_data yang-push data of the subscription.
+ * @param[in] nc_sub_id NC sub ID of the subscription.
+ * @param[in] data NACM-filtered datastore contents, are spent.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_notif_delta_send(struct nc_session *ncs, struct yang_push_data *yp_data, uint32_t nc_sub_id,
+        struct lyd_node *data)
+{
+    struct lyd_node *ly_ntf = NULL, *ly_yp, *diff = NULL, *root, *elem, *dup = NULL;
+    struct lyd_meta *meta;
+    const char *op, *prev;
+    enum yang_push_op yp_op;
+    uint32_t edit_count = 0, patch_id;
+    char buf[26];
+    int rc = SR_ERR_OK;
+
+    assert(yp_data->periodic && yp_data->full_sync_period);
+
+    if (!(yp_data->update_count % yp_data->full_sync_period)) {
+        /* full update, the data are still needed for the next update */
+        if (data && lyd_dup_siblings(data, NULL, LYD_DUP_RECURSIVE, &dup)) {
+            rc = SR_ERR_LY;
+            goto cleanup;
+        }
+        rc = yang_push_notif_update_send_data(ncs, nc_sub_id, dup, NULL);
+        goto cleanup;
+    }
+
+    /* learn the changes since the previous update */
+    if (lyd_diff_siblings(yp_data->last_data, data, 0, &diff)) {
+        rc = SR_ERR_LY;
+        goto cleanup;
+    }
+    if (!diff) {
+        /* no changes, nothing to send */
+        goto cleanup;
+    }
+
+    /* create basic structure for push-change-update notification */
+    sprintf(buf, "%" PRIu32, nc_sub_id);
+    if (lyd_new_path(NULL, sr_get_context(np2srv.sr_conn), "/ietf-yang-push:push-change-update/id", buf, 0, &ly_ntf)) {
+        rc = SR_ERR_LY;
+        goto cleanup;
+    }
+
+    /* generate a new patch-id */
+    patch_id = ATOMIC_INC_RELAXED(yp_data->patch_id);
+    sprintf(buf, "patch-%" PRIu32, patch_id);
+    if (lyd_new_path(ly_ntf, NULL, "datastore-changes/yang-patch/patch-id", buf, 0, NULL)) {
+        rc = SR_ERR_LY;
+        goto cleanup;
+    }
+    ly_yp = lyd_child(lyd_child(ly_ntf)->next);
+
+    /* initialize edit-id */
+    ATOMIC_STORE_RELAXED(yp_data->edit_id, 1);
+
+    /* append an edit for every changed node in the diff */
+    LY_LIST_FOR(diff, root) {
+        LYD_TREE_DFS_BEGIN(root, elem) {
+            meta = lyd_find_meta(elem->meta, NULL, "yang:operation");
+            op = meta ? lyd_get_meta_value(meta) : "none";
+
+            /* previous instance of user-ordered lists and leaf-lists */
+            meta = lyd_find_meta(elem->meta, NULL, (elem->schema->nodetype == LYS_LEAFLIST) ? "yang:value" : "yang:key");
+            prev = meta ? lyd_get_meta_value(meta) : "";
+
+            switch (op[0]) {
+            case 'c':
+                /* "create", the value includes the whole subtree */
+                yp_op = lysc_is_userordered(elem->schema) ? YP_OP_INSERT : YP_OP_CREATE;
+                LYD_TREE_DFS_continue = 1;
+                break;
+            case 'd':
+                /* "delete" */
+                yp_op = YP_OP_DELETE;
+                LYD_TREE_DFS_continue = 1;
+                break;
+            case 'r':
+                /* "replace", changed value or moved user-ordered instance */
+                yp_op = lysc_is_userordered(elem->schema) ? YP_OP_MOVE : YP_OP_REPLACE;
+                break;
+            default:
+                /* "none" */
+                assert(!strcmp(op, "none"));
+                goto next_iter;
+            }
+
+            /* append a new edit */
+            rc = yang_push_notif_change_edit_append(ly_yp, yp_op, elem, NULL, prev, prev, yp_data, NULL);
+            if (rc != SR_ERR_OK) {
+                goto cleanup;
+            }
+            ++edit_count;
+
+next_iter:
+            LYD_TREE_DFS_END(root, elem);
+        }
+    }
+
+    if (!edit_count) {
+        /* only nodes without any change */
+        goto cleanup;
+    }
+
+    /* send the notification */
+    rc = sub_ntf_send_notif(ncs, nc_sub_id, np_gettimespec(), &ly_ntf, 1);
+
+cleanup:
+    if (rc == SR_ERR_OK) {
+        /* the data sent are the base for the next delta */
+        lyd_free_siblings(yp_data->last_data);
+        yp_data->last_data = data;
+        ++yp_data->update_count;
+    } else {
+        /* the changes were not sent, the next update must be a full one */
+        lyd_free_siblings(data);
+        yp_data->update_count = 0;
+    }
+
+    lyd_free_siblings(diff);
+    lyd_free_tree(ly_ntf);
+    return rc;
+}
+
+/**
+ * @brief Timer callback for stopping yang-push subscriptions.
+ *
+ * The argument is the subscription ID so that nothing of the subscription is accessed before it is found.
+ */
+static void
+yang_push_stop_timer_cb(void *cb_arg)
+{
+    struct np2srv_sub_ntf *sub;
+    struct yang_push_data *yp_data;
+
+    /* WRITE LOCK */
+    sub = sub_ntf_find_lock((uintptr_t)cb_arg, 1);
+    if (!sub) {
+        return;
+    }
+    yp_data = sub->data;
+
+    /* terminate the subscription */
+    sub_ntf_terminate_sub(sub, yp_data->cb_arg.ncs);
+
+    /* UNLOCK */
+    sub_ntf_unlock();
+}
+
+/**
+ * @brief Find a periodic subscription group.
+ * sub-ntf lock held.
+ *
+ * @param[in] id Group ID.
+ * @return Found group, NULL if it no longer exists.
+ */
+static struct yang_push_group *
+yang_push_group_find_id(uint32_t id)
+{
+    uint32_t i;
+
+    for (i = 0; i < yp_groups.count; ++i) {
+        if (yp_groups.groups[i]->id == id) {
+            return yp_groups.groups[i];
+        }
+    }
+
+    return NULL;
 }
 
 /**
- * @brief Send a push-update yang-push notification.
+ * @brief Send push-update notifications to all the subscriptions of a periodic subscription group
+ * based on a single data retrieval.
+ * sub-ntf READ lock held.
  *
- * @param[in] ncs NETCONF session.
- * @param[in] yp_data yang-push data with the datastore, filter, and counters.
- * @param[in] nc_sub_id NC sub ID of the subscription.
+ * @param[in] group Periodic subscription group.
  * @return Sysrepo error value.
  */
 static int
-yang_push_notif_update_send(struct nc_session *ncs, struct yang_push_data *yp_data, uint32_t nc_sub_id)
+yang_push_group_update_send(struct yang_push_group *group)
 {
-    struct np2_user_sess *user_sess;
-    struct lyd_node *data = NULL, *ly_ntf = NULL;
-    char buf[11];
-    int rc = SR_ERR_OK;
-
-    /* get user session from NETCONF session */
-    user_sess = nc_session_get_data(ncs);
-    ATOMIC_INC_RELAXED(user_sess->ref_count);
-
-    /* switch to the datastore */
-    sr_session_switch_ds(user_sess->sess, yp_data->datastore);
-
-    /* get the data from sysrepo */
-    rc = sr_get_data(user_sess->sess, yp_data->xpath ? yp_data->xpath : "/*", 0, np2srv.sr_timeout, 0, &data);
+    struct yang_push_data *yp_data;
+    struct lyd_node *data = NULL, *user_data = NULL, *member_data = NULL;
+    const char **users = NULL, *user;
+    char *user_xml = NULL;
+    uint32_t i, j, user_count = 0;
+    int r, rc = SR_ERR_OK;
+
+    /* get the data from sysrepo, once for all the subscriptions */
+    rc = sr_get_data(group->sess, group->xpath ? group->xpath : "/*", 0, np2srv.sr_timeout, 0, &data);
     if (rc != SR_ERR_OK) {
         goto cleanup;
     }
 
-    /* NACM filter */
-    ncac_check_data_read_filter(&data, nc_session_get_username(ncs));
-
-    /* create the notification */
-    sprintf(buf, "%" PRIu32, nc_sub_id);
-    if (lyd_new_path(NULL, sr_get_context(np2srv.sr_conn), "/ietf-yang-push:push-update/id", buf, 0, &ly_ntf)) {
-        rc = SR_ERR_LY;
+    if (group->member_count == 1) {
+        /* nothing to share, NACM filter and send the data directly */
+        yp_data = group->members[0];
+        ncac_check_data_read_filter(&data, nc_session_get_username(yp_data->cb_arg.ncs));
+        if (yp_data->full_sync_period) {
+            rc = yang_push_notif_delta_send(yp_data->cb_arg.ncs, yp_data, yp_data->cb_arg.nc_sub_id, data);
+        } else {
+            rc = yang_push_notif_update_send_data(yp_data->cb_arg.ncs, yp_data->cb_arg.nc_sub_id, data, NULL);
+        }
+        data = NULL;
         goto cleanup;
     }
 
-    /* datastore-contents */
-    if (lyd_new_any(ly_ntf, NULL, "datastore-contents", data, 1, LYD_ANYDATA_DATATREE, 0, NULL)) {
-        rc = SR_ERR_LY;
+    /* learn the distinct users, NACM verdicts depend only on them */
+    users = malloc(group->member_count * sizeof *users);
+    if (!users) {
+        EMEM;
+        rc = SR_ERR_NO_MEMORY;
         goto cleanup;
     }
-    data = NULL;
+    for (i = 0; i < group->member_count; ++i) {
+        user = nc_session_get_username(group->members[i]->cb_arg.ncs);
+        for (j = 0; (j < user_count) && strcmp(users[j], user); ++j) {}
+        if (j == user_count) {
+            users[user_count++] = user;
+        }
+    }
 
-    /* send the notification */
-    rc = sub_ntf_send_notif(ncs, nc_sub_id, np_gettimespec(), &ly_ntf, 1);
-    if (rc != SR_ERR_OK) {
-        goto cleanup;
+    /* NACM filter the shared data only once for every user */
+    for (j = 0; j < user_count; ++j) {
+        if (j < user_count - 1) {
+            if (lyd_dup_siblings(data, NULL, LYD_DUP_RECURSIVE, &user_data)) {
+                rc = SR_ERR_LY;
+                goto cleanup;
+            }
+        } else {
+            /* last user, the shared data are not needed anymore */
+            user_data = data;
+            data = NULL;
+        }
+        ncac_check_data_read_filter(&user_data, users[j]);
+
+        /* send the notifications of all the subscriptions of this user */
+        for (i = 0; i < group->member_count; ++i) {
+            yp_data = group->members[i];
+            if (strcmp(nc_session_get_username(yp_data->cb_arg.ncs), users[j])) {
+                continue;
+            }
+
+            if (yp_data->full_sync_period) {
+                /* delta updates keep their own copy of the data */
+                if (user_data && lyd_dup_siblings(user_data, NULL, LYD_DUP_RECURSIVE, &member_data)) {
+                    rc = SR_ERR_LY;
+                    goto cleanup;
+                }
+                r = yang_push_notif_delta_send(yp_data->cb_arg.ncs, yp_data, yp_data->cb_arg.nc_sub_id, member_data);
+                member_data = NULL;
+            } else {
+                /* print the data only once and share the payload */
+                if (!user_xml && user_data && lyd_print_mem(&user_xml, user_data, LYD_XML, LYD_PRINT_WITHSIBLINGS)) {
+                    rc = SR_ERR_LY;
+                    goto cleanup;
+                }
+                r = yang_push_notif_update_send_data(yp_data->cb_arg.ncs, yp_data->cb_arg.nc_sub_id, NULL,
+                        user_xml ? user_xml : "");
+            }
+            if (r != SR_ERR_OK) {
+                rc = r;
+            }
+        }
+
+        lyd_free_siblings(user_data);
+        user_data = NULL;
+        free(user_xml);
+        user_xml = NULL;
     }
 
 cleanup:
     lyd_free_siblings(data);
-    lyd_free_tree(ly_ntf);
-    np_release_user_sess(user_sess);
+    lyd_free_siblings(user_data);
+    free(user_xml);
+    free(users);
     return rc;
 }
 
 /**
- * @brief Timer callback for push-update notification of periodic yang-push subscriptions.
+ * @brief Timer callback for push-update notifications of periodic yang-push subscription groups.
  */
 static void
-yang_push_update_timer_cb(union sigval sval)
+yang_push_group_update_timer_cb(void *cb_arg)
 {
-    struct yang_push_cb_arg *arg = sval.sival_ptr;
+    struct yang_push_group *group;
 
     /* READ LOCK */
-    if (!sub_ntf_find_lock(arg->nc_sub_id, 0)) {
-        return;
-    }
+    sub_ntf_lock(0);
 
-    /* send the push-update notification */
-    yang_push_notif_update_send(arg->ncs, arg->yp_data, arg->nc_sub_id);
+    /* the group may have been removed meanwhile */
+    group = yang_push_group_find_id((uintptr_t)cb_arg);
+
+    /* skip this period if the previous updates are still being sent */
+    if (group && !pthread_mutex_trylock(&group->update_lock)) {
+        /* send the push-update notifications */
+        yang_push_group_update_send(group);
+
+        pthread_mutex_unlock(&group->update_lock);
+    }
 
     /* UNLOCK */
     sub_ntf_unlock();
 }
 
 /**
- * @brief Timer callback for stopping yang-push subscriptions.
+ * @brief Free a periodic subscription group.
+ *
+ * @param[in] group Group to free.
  */
 static void
-yang_push_stop_timer_cb(union sigval sval)
+yang_push_group_free(struct yang_push_group *group)
 {
-    struct yang_push_cb_arg *arg = sval.sival_ptr;
-    struct np2srv_sub_ntf *sub;
+    if (!group) {
+        return;
+    }
 
-    /* WRITE LOCK */
-    sub = sub_ntf_find_lock(arg->nc_sub_id, 1);
-    if (!sub) {
+    np_timer_disarm(&group->update_timer);
+    pthread_mutex_destroy(&group->update_lock);
+    sr_session_stop(group->sess);
+    free(group->xpath);
+    free(group->members);
+    free(group);
+}
+
+/**
+ * @brief Set the originator of the group data retrieval to the first subscription so that the operational
+ * callbacks learn the NETCONF session and user, the same as for a subscription on its own.
+ * sub-ntf WRITE lock held.
+ *
+ * @param[in] group Periodic subscription group with at least one subscription.
+ */
+static void
+yang_push_group_set_orig(struct yang_push_group *group)
+{
+    struct nc_session *ncs = group->members[0]->cb_arg.ncs;
+    uint32_t nc_id;
+    const char *username;
+
+    /* setting the name also discards the previous originator data */
+    sr_session_set_orig_name(group->sess, "netopeer2");
+    nc_id = nc_session_get_id(ncs);
+    sr_session_push_orig_data(group->sess, sizeof nc_id, &nc_id);
+    username = nc_session_get_username(ncs);
+    sr_session_push_orig_data(group->sess, strlen(username) + 1, username);
+}
+
+/**
+ * @brief Learn the first expiration of periodic updates aligned with an anchor time.
+ *
+ * @param[in] anchor_time Anchor time (CLOCK_REALTIME).
+ * @param[in] period_ms Update period.
+ * @return First expiration time (NP_CLOCK_ID), within one period from now.
+ */
+static struct timespec
+yang_push_anchor_first(const struct timespec *anchor_time, uint32_t period_ms)
+{
+    struct timespec first, rt_now, anchor_off, now_off;
+    uint32_t anchor_ms, now_ms;
+
+    /* phase of the anchor and of the current time in the period, both on the real-time clock */
+    clock_gettime(CLOCK_REALTIME, &rt_now);
+    anchor_off = np_modtimespec(anchor_time, period_ms);
+    now_off = np_modtimespec(&rt_now, period_ms);
+    anchor_ms = anchor_off.tv_sec * 1000 + anchor_off.tv_nsec / 1000000;
+    now_ms = now_off.tv_sec * 1000 + now_off.tv_nsec / 1000000;
+
+    /* the next aligned time relative to now on the timer clock */
+    first = np_gettimespec();
+    np_addtimespec(&first, (anchor_ms + period_ms - now_ms) % period_ms);
+    return first;
+}
+
+/**
+ * @brief Add a periodic subscription into a group of subscriptions with the same datastore, filter, period, and
+ * anchor time, create a new group if there is none.
+ * sub-ntf WRITE lock held.
+ *
+ * @param[in] yp_data yang-push data of the subscription.
+ * @return Sysrepo error value.
+ */
+static int
+yang_push_group_join(struct yang_push_data *yp_data)
+{
+    struct yang_push_group *group = NULL, *new_group = NULL;
+    struct timespec first;
+    uint32_t i;
+    void *mem;
+    int rc = SR_ERR_OK;
+
+    assert(yp_data->periodic && !yp_data->group);
+
+    if (yp_data->anchor_time.tv_sec) {
+        /* without an anchor time, every subscription has its own start */
+        for (i = 0; i < yp_groups.count; ++i) {
+            group = yp_groups.groups[i];
+            if ((group->datastore == yp_data->datastore) && (group->period_ms == yp_data->period_ms) &&
+                    !memcmp(&group->anchor_time, &yp_data->anchor_time, sizeof group->anchor_time) &&
+                    ((!group->xpath && !yp_data->xpath) ||
+                    (group->xpath && yp_data->xpath && !strcmp(group->xpath, yp_data->xpath)))) {
+                break;
+            }
+        }
+        if (i == yp_groups.count) {
+            group = NULL;
+        }
+    }
+
+    if (!group) {
+        /* create a new group */
+        group = new_group = calloc(1, sizeof *group);
+        if (!group) {
+            rc = SR_ERR_NO_MEMORY;
+            goto cleanup;
+        }
+        pthread_mutex_init(&group->update_lock, NULL);
+        group->id = ++yp_groups.last_id;
+        group->datastore = yp_data->datastore;
+        if (yp_data->xpath) {
+            group->xpath = strdup(yp_data->xpath);
+            if (!group->xpath) {
+                rc = SR_ERR_NO_MEMORY;
+                goto cleanup;
+            }
+        }
+        group->period_ms = yp_data->period_ms;
+        group->anchor_time = yp_data->anchor_time;
+        np_timer_init(&group->update_timer, yang_push_group_update_timer_cb, (void *)(uintptr_t)group->id);
+
+        /* a separate session for the group data retrieval */
+        rc = sr_session_start(np2srv.sr_conn, group->datastore, &group->sess);
+        if (rc != SR_ERR_OK) {
+            goto cleanup;
+        }
+
+        mem = realloc(yp_groups.groups, (yp_groups.count + 1) * sizeof *yp_groups.groups);
+        if (!mem) {
+            rc = SR_ERR_NO_MEMORY;
+            goto cleanup;
+        }
+        yp_groups.groups = mem;
+        yp_groups.groups[yp_groups.count] = group;
+        ++yp_groups.count;
+    }
+
+    /* add the subscription */
+    mem = realloc(group->members, (group->member_count + 1) * sizeof *group->members);
+    if (!mem) {
+        if (new_group) {
+            --yp_groups.count;
+        }
+        rc = SR_ERR_NO_MEMORY;
+        goto cleanup;
+    }
+    group->members = mem;
+    group->members[group->member_count] = yp_data;
+    ++group->member_count;
+    yp_data->group = group;
+
+    if (new_group) {
+        /* retrieve the data as the first subscription */
+        yang_push_group_set_orig(group);
+
+        /* schedule the periodic updates */
+        if (group->anchor_time.tv_sec) {
+            first = yang_push_anchor_first(&group->anchor_time, group->period_ms);
+        } else {
+            first = np_gettimespec();
+        }
+        np_timer_set(&group->update_timer, first, group->period_ms);
+        new_group = NULL;
+    }
+
+cleanup:
+    yang_push_group_free(new_group);
+    return rc;
+}
+
+/**
+ * @brief Remove a periodic subscription from its group, free the group if empty.
+ * sub-ntf WRITE lock held.
+ *
+ * @param[in] yp_data yang-push data of the subscription.
+ */
+static void
+yang_push_group_leave(struct yang_push_data *yp_data)
+{
+    struct yang_push_group *group = yp_data->group;
+    uint32_t i;
+
+    if (!group) {
         return;
     }
 
-    /* terminate the subscription */
-    sub_ntf_terminate_sub(sub, arg->ncs);
+    /* remove the subscription */
+    for (i = 0; group->members[i] != yp_data; ++i) {}
+    --group->member_count;
+    if (i < group->member_count) {
+        group->members[i] = group->members[group->member_count];
+    }
+    yp_data->group = NULL;
 
-    /* UNLOCK */
-    sub_ntf_unlock();
+    if (group->member_count) {
+        if (!i) {
+            /* the originator has left */
+            yang_push_group_set_orig(group);
+        }
+        return;
+    }
+
+    /* remove the empty group */
+    for (i = 0; yp_groups.groups[i] != group; ++i) {}
+    --yp_groups.count;
+    if (i < yp_groups.count) {
+        yp_groups.groups[i] = yp_groups.groups[yp_groups.count];
+    } else if (!yp_groups.count) {
+        free(yp_groups.groups);
+        yp_groups.groups = NULL;
+    }
+    yang_push_group_free(group);
 }
 
 /**
- * @brief Create a new function timer.
+ * @brief Move a periodic subscription into the group matching its current parameters. The subscription is removed
+ * from its previous group only after it has joined the new one so that it keeps its updates on failure.
+ * sub-ntf WRITE lock held.
  *
- * @param[in] cb Callback to be called.
- * @param[in] arg Argument for @p cb.
- * @param[out] timer_id Created timer ID.
+ * @param[in] yp_data yang-push data of the subscription.
  * @return Sysrepo error value.
  */
 static int
-yang_push_create_timer(void (*cb)(union sigval), void *arg, timer_t *timer_id)
+yang_push_group_rejoin(struct yang_push_data *yp_data)
 {
-    struct sigevent sevp = {0};
+    struct yang_push_group *prev_group = yp_data->group, *group;
+    int rc;
 
-    sevp.sigev_notify = SIGEV_THREAD;
-    sevp.sigev_value.sival_ptr = arg;
-    sevp.sigev_notify_function = cb;
-    if (timer_create(NP_CLOCK_ID, &sevp, timer_id) == -1) {
-        return SR_ERR_SYS;
+    yp_data->group = NULL;
+    rc = yang_push_group_join(yp_data);
+    group = yp_data->group;
+
+    /* leave the previous group, if the new one was joined */
+    yp_data->group = prev_group;
+    if (rc != SR_ERR_OK) {
+        return rc;
     }
+    yang_push_group_leave(yp_data);
+    yp_data->group = group;
 
     return SR_ERR_OK;
 }
@@ -957,9 +2456,8 @@ yang_push_rpc_establish_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rp
     const char *selection_filter_ref = NULL, *datastore_xpath_filter = NULL;
     sr_datastore_t datastore;
     char *xp = NULL;
-    uint32_t i, period, dampening_period, sub_id_count;
+    uint32_t i, period, full_sync_period = 0, dampening_period;
     int rc = SR_ERR_OK, periodic, sync_on_start, excluded_change[YP_OP_OPERATION_COUNT] = {0};
-    struct itimerspec trspec = {0};
     struct timespec anchor_time = {0};
 
     /* get the NETCONF session and user session */
@@ -995,6 +2493,11 @@ yang_push_rpc_establish_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rp
         if (child) {
             ly_time_str2ts(lyd_get_value(child), &anchor_time);
         }
+
+        /* delta-updates */
+        if (!lyd_find_path(node, "netopeer2-yang-push:delta-updates/full-sync-period", 0, &child)) {
+            full_sync_period = ((struct lyd_node_term *)child)->value.uint32;
+        }
     } else if (!lyd_find_path(rpc, "ietf-yang-push:on-change", 0, &node)) {
         periodic = 0;
 
@@ -1045,24 +2548,20 @@ yang_push_rpc_establish_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rp
     yp_data->cb_arg.ncs = ncs;
     yp_data->cb_arg.yp_data = yp_data;
     yp_data->cb_arg.nc_sub_id = sub->nc_sub_id;
+    ATOMIC_STORE_RELAXED(yp_data->patch_id, 1);
+    np_timer_init(&yp_data->stop_timer, yang_push_stop_timer_cb, (void *)(uintptr_t)sub->nc_sub_id);
 
     if (periodic) {
         yp_data->period_ms = period * 10;
         yp_data->anchor_time = anchor_time;
+        yp_data->full_sync_period = full_sync_period;
     } else {
         yp_data->dampening_period_ms = dampening_period * 10;
         yp_data->sync_on_start = sync_on_start;
         memcpy(yp_data->excluded_change, excluded_change, sizeof excluded_change);
 
         pthread_mutex_init(&yp_data->notif_lock, NULL);
-        ATOMIC_STORE_RELAXED(yp_data->patch_id, 1);
-        if (yp_data->dampening_period_ms) {
-            /* create dampening timer */
-            rc = yang_push_create_timer(yang_push_damp_timer_cb, &yp_data->cb_arg, &yp_data->damp_timer);
-            if (rc != SR_ERR_OK) {
-                goto cleanup;
-            }
-        }
+        np_timer_init(&yp_data->damp_timer, yang_push_damp_timer_cb, (void *)(uintptr_t)sub->nc_sub_id);
     }
     if ((selection_filter_ref && !yp_data->selection_filter_ref) ||
             (datastore_subtree_filter && !yp_data->datastore_subtree_filter) ||
@@ -1072,39 +2571,16 @@ yang_push_rpc_establish_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rp
     }
 
     if (sub->stop_time.tv_sec) {
-        /* create stop timer */
-        rc = yang_push_create_timer(yang_push_stop_timer_cb, &yp_data->cb_arg, &yp_data->stop_timer);
-        if (rc != SR_ERR_OK) {
-            goto cleanup;
-        }
-
         /* schedule subscription stop */
-        trspec.it_value = sub->stop_time;
-        if (timer_settime(yp_data->stop_timer, TIMER_ABSTIME, &trspec, NULL) == -1) {
-            rc = SR_ERR_SYS;
-            goto cleanup;
-        }
+        np_timer_set(&yp_data->stop_timer, sub->stop_time, 0);
     }
 
     if (periodic) {
-        /* create update timer */
-        rc = yang_push_create_timer(yang_push_update_timer_cb, &yp_data->cb_arg, &yp_data->update_timer);
+        /* schedule the periodic updates, shared with other subscriptions if possible */
+        rc = yang_push_group_join(yp_data);
         if (rc != SR_ERR_OK) {
             goto cleanup;
         }
-
-        /* schedule the periodic updates */
-        if (yp_data->anchor_time.tv_sec) {
-            trspec.it_value = np_modtimespec(&yp_data->anchor_time, yp_data->period_ms);
-        } else {
-            trspec.it_value = np_gettimespec();
-        }
-        trspec.it_interval.tv_sec = yp_data->period_ms / 1000;
-        trspec.it_interval.tv_nsec = (yp_data->period_ms % 1000) * 1000000;
-        if (timer_settime(yp_data->update_timer, TIMER_ABSTIME, &trspec, NULL) == -1) {
-            rc = SR_ERR_SYS;
-            goto cleanup;
-        }
     } else {
         if (yp_data->sync_on_start) {
             /* send the initial update notification */
@@ -1114,11 +2590,8 @@ yang_push_rpc_establish_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rp
             }
         }
 
-        /* subscribe to sysrepo module data changes */
-        sub_id_count = 0;
-        rc = yang_push_sr_subscribe(user_sess->sess, datastore, yp_data->xpath, &yp_data->cb_arg, ev_sess, &sub->sub_ids,
-                &sub_id_count);
-        ATOMIC_STORE_RELAXED(sub->sub_id_count, sub_id_count);
+        /* subscribe to sysrepo module data changes, shared with other subscriptions */
+        rc = yang_push_sr_subscribe(yp_data, ev_sess);
         if (rc != SR_ERR_OK) {
             goto cleanup;
         }
@@ -1142,11 +2615,10 @@ yang_push_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc,
     struct yang_push_data *yp_data = sub->data;
     sr_datastore_t datastore;
     const char *selection_filter_ref = NULL, *datastore_xpath_filter = NULL;
-    struct itimerspec trspec;
     char *xp = NULL, *datetime = NULL;
     struct timespec anchor_time, next_notif;
-    int rc = SR_ERR_OK;
-    uint32_t i, nc_sub_id, period, dampening_period;
+    int rc = SR_ERR_OK, regroup = 0;
+    uint32_t nc_sub_id, period, full_sync_period, dampening_period;
 
     /* get the user session */
     if ((rc = np_get_user_sess(ev_sess, NULL, &user_sess))) {
@@ -1192,17 +2664,7 @@ yang_push_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc,
             yp_data->period_ms = period * 10;
 
             /* update the period */
-            if (yp_data->anchor_time.tv_sec) {
-                trspec.it_value = np_modtimespec(&yp_data->anchor_time, yp_data->period_ms);
-            } else {
-                trspec.it_value = np_gettimespec();
-            }
-            trspec.it_interval.tv_sec = yp_data->period_ms / 1000;
-            trspec.it_interval.tv_nsec = (yp_data->period_ms % 1000) * 1000000;
-            if (timer_settime(yp_data->update_timer, TIMER_ABSTIME, &trspec, NULL) == -1) {
-                rc = SR_ERR_SYS;
-                goto cleanup;
-            }
+            regroup = 1;
         }
 
         /* anchor-time */
@@ -1213,15 +2675,24 @@ yang_push_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc,
                 yp_data->anchor_time = anchor_time;
 
                 /* update the anchor */
-                trspec.it_value = np_modtimespec(&yp_data->anchor_time, yp_data->period_ms);
-                trspec.it_interval.tv_sec = yp_data->period_ms / 1000;
-                trspec.it_interval.tv_nsec = (yp_data->period_ms % 1000) * 1000000;
-                if (timer_settime(yp_data->update_timer, TIMER_ABSTIME, &trspec, NULL) == -1) {
-                    rc = SR_ERR_SYS;
-                    goto cleanup;
-                }
+                regroup = 1;
             }
         }
+
+        /* delta-updates */
+        if (lyd_find_path(cont, "netopeer2-yang-push:delta-updates/full-sync-period", 0, &node)) {
+            full_sync_period = 0;
+        } else {
+            full_sync_period = ((struct lyd_node_term *)node)->value.uint32;
+        }
+        if (full_sync_period != yp_data->full_sync_period) {
+            yp_data->full_sync_period = full_sync_period;
+
+            /* start with a full update */
+            yp_data->update_count = 0;
+            lyd_free_siblings(yp_data->last_data);
+            yp_data->last_data = NULL;
+        }
     }
 
     /*
@@ -1239,37 +2710,16 @@ yang_push_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc,
         lyd_find_path(cont, "dampening-period", 0, &node);
         dampening_period = ((struct lyd_node_term *)node)->value.uint32;
         if (dampening_period * 10 != yp_data->dampening_period_ms) {
-            if (!yp_data->dampening_period_ms) {
-                /* create dampening timer */
-                rc = yang_push_create_timer(yang_push_damp_timer_cb, &yp_data->cb_arg, &yp_data->damp_timer);
-                if (rc != SR_ERR_OK) {
-                    goto cleanup;
-                }
-            }
-
             yp_data->dampening_period_ms = dampening_period * 10;
 
-            if (!yp_data->dampening_period_ms) {
-                /* delete the dampening timer */
-                timer_delete(yp_data->damp_timer);
-            } else {
-                /* update the dampening timer, if set */
-                if (timer_gettime(yp_data->damp_timer, &trspec) == -1) {
-                    rc = SR_ERR_SYS;
-                    goto cleanup;
-                }
-                if (trspec.it_value.tv_sec || trspec.it_value.tv_nsec) {
-                    /* learn when the next notification is due */
-                    next_notif = yp_data->last_notif;
-                    np_addtimespec(&next_notif, yp_data->dampening_period_ms);
-
-                    /* schedule the notification */
-                    trspec.it_value = next_notif;
-                    if (timer_settime(yp_data->damp_timer, TIMER_ABSTIME, &trspec, NULL) == -1) {
-                        rc = SR_ERR_SYS;
-                        goto cleanup;
-                    }
-                }
+            /* update the dampening timer, if set */
+            if (np_timer_is_pending(&yp_data->damp_timer)) {
+                /* learn when the next notification is due, send the postponed changes right away if not dampened */
+                next_notif = yp_data->last_notif;
+                np_addtimespec(&next_notif, yp_data->dampening_period_ms);
+
+                /* schedule the notification */
+                np_timer_set(&yp_data->damp_timer, next_notif, 0);
             }
         }
     }
@@ -1288,9 +2738,12 @@ yang_push_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc,
         free(yp_data->xpath);
         yp_data->xpath = xp;
         xp = NULL;
+        regroup = 1;
 
-        for (i = 0; i < sub->sub_id_count; ++i) {
-            rc = sr_event_notif_sub_modify_xpath(np2srv.sr_data_sub, sub->sub_ids[i], yp_data->xpath);
+        if (!yp_data->periodic) {
+            /* the filter may select different modules, rejoin the change dispatchers */
+            yang_push_dispatch_leave(yp_data);
+            rc = yang_push_sr_subscribe(yp_data, ev_sess);
             if (rc != SR_ERR_OK) {
                 goto cleanup;
             }
@@ -1316,25 +2769,23 @@ yang_push_rpc_modify_sub(sr_session_ctx_t *ev_sess, const struct lyd_node *rpc,
         goto cleanup;
     }
 
+    if (yp_data->periodic && regroup) {
+        /* the previously sent data may no longer match, start delta updates with a full update */
+        yp_data->update_count = 0;
+
+        /* reschedule the periodic updates */
+        rc = yang_push_group_rejoin(yp_data);
+        if (rc != SR_ERR_OK) {
+            goto cleanup;
+        }
+    }
+
     /*
      * stop
      */
     if (stop.tv_sec && memcmp(&stop, &sub->stop_time, sizeof stop)) {
-        if (!sub->stop_time.tv_sec) {
-            /* create stop timer */
-            rc = yang_push_create_timer(yang_push_stop_timer_cb, &yp_data->cb_arg, &yp_data->stop_timer);
-            if (rc != SR_ERR_OK) {
-                goto cleanup;
-            }
-        }
-
         /* schedule subscription stop */
-        memset(&trspec, 0, sizeof trspec);
-        trspec.it_value = stop;
-        if (timer_settime(yp_data->stop_timer, TIMER_ABSTIME, &trspec, NULL) == -1) {
-            rc = SR_ERR_SYS;
-            goto cleanup;
-        }
+        np_timer_set(&yp_data->stop_timer, stop, 0);
     }
 
 cleanup:
@@ -1405,6 +2856,24 @@ yang_push_notif_modified_append_data(struct lyd_node *ntf, void *data)
                 return SR_ERR_LY;
             }
         }
+
+        if (yp_data->full_sync_period) {
+            /* delta-updates */
+            mod = ly_ctx_get_module_implemented(LYD_CTX(subscription), "netopeer2-yang-push");
+            if (!mod) {
+                EINT;
+                return SR_ERR_INTERNAL;
+            }
+            if (lyd_new_inner(cont, mod, "delta-updates", 0, &cont)) {
+                return SR_ERR_LY;
+            }
+
+            /* full-sync-period */
+            sprintf(buf, "%" PRIu32, yp_data->full_sync_period);
+            if (lyd_new_term(cont, NULL, "full-sync-period", buf, 0, NULL)) {
+                return SR_ERR_LY;
+            }
+        }
     } else {
         /* on-change */
         if (lyd_new_inner(ntf, mod, "on-change", 0, &cont)) {
@@ -1464,7 +2933,6 @@ yang_push_config_filters(sr_session_ctx_t *ev_sess, const struct lyd_node *filte
     struct np2srv_sub_ntf *sub;
     struct nc_session *ncs;
     char *xp;
-    uint32_t i;
 
     if (op == SR_OP_MODIFIED) {
         /* construct the new filter */
@@ -1483,12 +2951,11 @@ yang_push_config_filters(sr_session_ctx_t *ev_sess, const struct lyd_node *filte
             yp_data->xpath = strdup(xp);
 
             if (!yp_data->periodic) {
-                /* modify the filter of the subscription(s) */
-                for (i = 0; i < sub->sub_id_count; ++i) {
-                    r = sr_module_change_sub_modify_xpath(np2srv.sr_data_sub, sub->sub_ids[i], yp_data->xpath);
-                    if (r != SR_ERR_OK) {
-                        rc = r;
-                    }
+                /* rejoin the change dispatchers with the new filter */
+                yang_push_dispatch_leave(yp_data);
+                r = yang_push_sr_subscribe(yp_data, NULL);
+                if (r != SR_ERR_OK) {
+                    rc = r;
                 }
             }
 
@@ -1578,6 +3045,24 @@ yang_push_oper_subscription(struct lyd_node *subscription, void *data)
                 return SR_ERR_LY;
             }
         }
+
+        if (yp_data->full_sync_period) {
+            /* delta-updates */
+            mod = ly_ctx_get_module_implemented(LYD_CTX(subscription), "netopeer2-yang-push");
+            if (!mod) {
+                EINT;
+                return SR_ERR_INTERNAL;
+            }
+            if (lyd_new_inner(cont, mod, "delta-updates", 0, &cont)) {
+                return SR_ERR_LY;
+            }
+
+            /* full-sync-period */
+            sprintf(buf, "%" PRIu32, yp_data->full_sync_period);
+            if (lyd_new_term(cont, NULL, "full-sync-period", buf, 0, NULL)) {
+                return SR_ERR_LY;
+            }
+        }
     } else {
         /* on-change */
         if (lyd_new_inner(subscription, mod, "on-change", 0, &cont)) {
@@ -1614,19 +3099,11 @@ uint32_t
 yang_push_oper_receiver_excluded(struct np2srv_sub_ntf *sub)
 {
     struct yang_push_data *yp_data = sub->data;
-    uint32_t i, excluded_count = 0, filtered_out;
-    int r;
+    uint32_t excluded_count = 0;
 
     if (!yp_data->periodic) {
-        /* excluded-event-records */
-        for (i = 0; i < ATOMIC_LOAD_RELAXED(sub->sub_id_count); ++i) {
-            /* get filter-out count for the subscription */
-            r = sr_module_change_sub_get_info(np2srv.sr_data_sub, sub->sub_ids[i], NULL, NULL, NULL, &filtered_out);
-            if (r != SR_ERR_OK) {
-                return 0;
-            }
-            excluded_count += filtered_out;
-        }
+        /* excluded-event-records, change events filtered out by the dispatchers */
+        excluded_count += ATOMIC_LOAD_RELAXED(yp_data->filtered_out_count);
 
         /* add excluded op */
         excluded_count += ATOMIC_LOAD_RELAXED(yp_data->excluded_op_count);
@@ -1639,17 +3116,28 @@ void
 yang_push_terminate_async(void *data)
 {
     struct yang_push_data *yp_data = data;
-    struct itimerspec tspec = {0};
 
     /* disarm all timers */
     if (yp_data->periodic) {
-        timer_settime(yp_data->update_timer, TIMER_ABSTIME, &tspec, NULL);
+        yang_push_group_leave(yp_data);
     } else {
-        if (yp_data->dampening_period_ms) {
-            timer_settime(yp_data->damp_timer, TIMER_ABSTIME, &tspec, NULL);
-        }
+        /* no more changes will be dispatched */
+        yang_push_dispatch_leave(yp_data);
+        np_timer_disarm(&yp_data->damp_timer);
+    }
+    np_timer_disarm(&yp_data->stop_timer);
+}
+
+void
+yang_push_terminate_wait(void *data)
+{
+    struct yang_push_data *yp_data = data;
+
+    /* the timers are already disarmed, only wait for the callbacks being called now */
+    if (!yp_data->periodic) {
+        np_timer_disarm_sync(&yp_data->damp_timer);
     }
-    timer_settime(yp_data->stop_timer, TIMER_ABSTIME, &tspec, NULL);
+    np_timer_disarm_sync(&yp_data->stop_timer);
 }
 
 void
@@ -1662,16 +3150,18 @@ yang_push_data_destroy(void *data)
         lyd_free_tree(yp_data->datastore_subtree_filter);
         free(yp_data->datastore_xpath_filter);
         if (yp_data->periodic) {
-            timer_delete(yp_data->update_timer);
+            yang_push_group_leave(yp_data);
+            lyd_free_siblings(yp_data->last_data);
         } else {
+            yang_push_dispatch_leave(yp_data);
             pthread_mutex_destroy(&yp_data->notif_lock);
             lyd_free_tree(yp_data->ly_change_ntf);
-            if (yp_data->dampening_period_ms) {
-                timer_delete(yp_data->damp_timer);
-            }
+            yang_push_edit_idx_clear(yp_data);
+            free(yp_data->nacm_cache);
+            np_timer_disarm(&yp_data->damp_timer);
         }
         free(yp_data->xpath);
-        timer_delete(yp_data->stop_timer);
+        np_timer_disarm(&yp_data->stop_timer);
 
         free(yp_data);
     }
@@ -21,8 +21,12 @@
 #include <sysrepo.h>
 
 #include "common.h"
+#include "timer_wheel.h"
 
 struct np2srv_sub_ntf;
+struct yang_push_dispatch;
+struct yang_push_group;
+struct yang_push_nacm_verdict;
 
 /**
  * @brief Operations supported by yang-push.
@@ -36,6 +40,15 @@ enum yang_push_op {
     YP_OP_OPERATION_COUNT   /* count of all the operations */
 };
 
+/**
+ * @brief Index of an on-change yang-push edit by its target.
+ */
+struct yang_push_edit_idx {
+    char *target;
+    struct lyd_node *edit;
+    enum yang_push_op op;
+};
+
 /**
  * @brief yang-push sysrepo change and timer callback argument.
  */
@@ -57,9 +70,12 @@ struct yang_push_data {
             /* parameters */
             uint32_t period_ms;
             struct timespec anchor_time;
+            uint32_t full_sync_period;  /* send delta updates and full update every this many periods, 0 if disabled */
 
             /* internal data */
-            timer_t update_timer;
+            struct yang_push_group *group;
+            struct lyd_node *last_data; /* data sent in the previous delta update */
+            uint32_t update_count;      /* delta updates sent since the last full update */
         };
         struct {
             /* parameters */
@@ -70,18 +86,27 @@ struct yang_push_data {
             /* internal data */
             pthread_mutex_t notif_lock;
             struct lyd_node *ly_change_ntf;
-            ATOMIC_T patch_id;
-            ATOMIC_T edit_id;
+            struct yang_push_edit_idx *edit_idx;    /* edits of ly_change_ntf sorted by target */
+            uint32_t edit_idx_count;
+            int change_denied;          /* some changes in ly_change_ntf were denied by NACM */
+            struct yang_push_nacm_verdict *nacm_cache;  /* NACM read access of the user sorted by schema nodes */
+            uint32_t nacm_cache_count;
+            uint32_t nacm_version;      /* NACM configuration version of nacm_cache */
             struct timespec last_notif;
-            timer_t damp_timer;
+            struct np_timer damp_timer;
+            struct yang_push_dispatch **dispatch;   /* change dispatchers of all the subscribed modules */
+            uint32_t dispatch_count;
             ATOMIC_T excluded_op_count; /* explicitly excluded changes */
+            ATOMIC_T filtered_out_count;    /* change events with no changes selected by the filter */
         };
     };
 
     /* internal data */
     char *xpath;
+    ATOMIC_T patch_id;
+    ATOMIC_T edit_id;
     struct yang_push_cb_arg cb_arg;
-    timer_t stop_timer;
+    struct np_timer stop_timer;
 };
 
 /* for documentation, see subscribed_notifications.h */
@@ -100,6 +125,8 @@ uint32_t yang_push_oper_receiver_excluded(struct np2srv_sub_ntf *sub);
 
 void yang_push_terminate_async(void *data);
 
+void yang_push_terminate_wait(void *data);
+
 void yang_push_data_destroy(void *data);
 
 /*
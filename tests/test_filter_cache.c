@@ -0,0 +1,300 @@
+/**
+ * @file test_filter_cache.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief test the cache of compiled read RPC filters
+ *
+ * @copyright
+ * Copyright 2021 CESNET, z.s.p.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <inttypes.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include <libyang/libyang.h>
+#include <sysrepo.h>
+
+#include "common.h"
+#include "config.h"
+#include "filter_cache.h"
+#include "log.h"
+#include "metrics.h"
+
+struct np2srv np2srv;
+
+/* content-id returned by sysrepo */
+static uint32_t test_content_id = 1;
+
+/* last printed metrics */
+static uint64_t test_entries, test_evictions;
+
+/*
+ * server and library functions the cache uses
+ */
+
+uint32_t
+sr_get_content_id(sr_conn_ctx_t *conn)
+{
+    (void)conn;
+
+    return test_content_id;
+}
+
+LY_ERR
+lyd_print_mem(char **strp, const struct lyd_node *root, LYD_FORMAT format, uint32_t options)
+{
+    (void)strp;
+    (void)root;
+    (void)format;
+    (void)options;
+
+    /* only XPath filters are tested */
+    return LY_EINT;
+}
+
+int
+op_filter_subtree2xpath(const struct lyd_node *node, struct np2_filter *filter)
+{
+    (void)node;
+    (void)filter;
+
+    return -1;
+}
+
+void
+op_filter_erase(struct np2_filter *filter)
+{
+    uint32_t i;
+
+    for (i = 0; i < filter->count; ++i) {
+        free(filter->filters[i].str);
+    }
+    free(filter->filters);
+    filter->filters = NULL;
+    filter->count = 0;
+}
+
+void
+np2log_printf(NC_VERB_LEVEL level, const char *format, ...)
+{
+    (void)level;
+    (void)format;
+}
+
+void
+np_metrics_gauge(struct np_metrics *m, const char *name, const char *help, uint64_t value)
+{
+    (void)m;
+    (void)help;
+
+    if (!strcmp(name, "filter_cache_entries")) {
+        test_entries = value;
+    }
+}
+
+void
+np_metrics_counter(struct np_metrics *m, const char *name, const char *help, uint64_t value)
+{
+    (void)m;
+    (void)help;
+
+    if (!strcmp(name, "filter_cache_evictions")) {
+        test_evictions = value;
+    }
+}
+
+/*
+ * helpers
+ */
+
+static const struct np_filter_plan *
+test_get(const char *xpath)
+{
+    const struct np_filter_plan *plan;
+
+    assert_int_equal(np_filter_plan_get(NULL, xpath, &plan), SR_ERR_OK);
+    assert_non_null(plan);
+    return plan;
+}
+
+static int
+teardown(void **state)
+{
+    (void)state;
+
+    np_filter_cache_destroy();
+    test_content_id = 1;
+    return 0;
+}
+
+/*
+ * tests
+ */
+
+static void
+test_key(void **state)
+{
+    const struct np_filter_plan *plan, *plan2, *plan3;
+    struct lyd_node_any any = {0};
+
+    (void)state;
+
+    plan = test_get("/ietf-interfaces:interfaces/interface[name='eth0']");
+    assert_string_equal(plan->key, "x/ietf-interfaces:interfaces/interface[name='eth0']");
+    assert_int_equal(plan->filter.count, 1);
+    assert_string_equal(plan->filter.filters[0].str, "/ietf-interfaces:interfaces/interface[name='eth0']");
+    assert_int_equal(plan->filter.filters[0].selection, 1);
+
+    /* whole module */
+    assert_int_equal(plan->mod_filter.count, 1);
+    assert_string_equal(plan->mod_filter.filters[0].str, "/ietf-interfaces:*");
+
+    /* the same filter */
+    plan2 = test_get("/ietf-interfaces:interfaces/interface[name='eth0']");
+    if (NP2SRV_FILTER_CACHE_SIZE) {
+        assert_ptr_equal(plan, plan2);
+    }
+    np_filter_plan_release(plan2);
+
+    /* a different filter */
+    plan2 = test_get("/ietf-interfaces:interfaces/interface[name='eth1']");
+    assert_ptr_not_equal(plan, plan2);
+    assert_string_equal(plan2->mod_filter.filters[0].str, "/ietf-interfaces:*");
+
+    /* not a simple path, used as it is */
+    plan3 = test_get("count(/ietf-interfaces:interfaces)");
+    assert_int_equal(plan3->mod_filter.count, 1);
+    assert_string_equal(plan3->mod_filter.filters[0].str, "count(/ietf-interfaces:interfaces)");
+    np_filter_plan_release(plan3);
+
+    /* empty subtree filter selects nothing and differs from any XPath filter */
+    any.value_type = LYD_ANYDATA_STRING;
+    assert_int_equal(np_filter_plan_get(&any, NULL, &plan3), SR_ERR_OK);
+    assert_string_equal(plan3->key, "s");
+    assert_int_equal(plan3->filter.count, 0);
+    assert_int_equal(plan3->mod_filter.count, 0);
+    np_filter_plan_release(plan3);
+
+    np_filter_plan_release(plan);
+    np_filter_plan_release(plan2);
+}
+
+static void
+test_lru(void **state)
+{
+    const struct np_filter_plan *first, *second = NULL, *plan;
+    char xpath[32];
+    uint64_t evictions;
+    uint32_t i;
+
+    (void)state;
+
+    if (NP2SRV_FILTER_CACHE_SIZE < 2) {
+        skip();
+    }
+    np_filter_cache_metrics(NULL);
+    evictions = test_evictions;
+
+    /* fill the cache, keep using the second plan */
+    for (i = 0; i < NP2SRV_FILTER_CACHE_SIZE; ++i) {
+        sprintf(xpath, "/mod:cont/leaf%" PRIu32, i);
+        plan = test_get(xpath);
+        if (i == 1) {
+            second = plan;
+        } else {
+            np_filter_plan_release(plan);
+        }
+    }
+    np_filter_cache_metrics(NULL);
+    assert_int_equal(test_entries, NP2SRV_FILTER_CACHE_SIZE);
+    assert_int_equal(test_evictions, evictions);
+
+    /* make the least recently used plan the most recently used one */
+    first = test_get("/mod:cont/leaf0");
+
+    /* one more plan evicts the least recently used one */
+    np_filter_plan_release(test_get("/mod:cont/new"));
+    np_filter_cache_metrics(NULL);
+    assert_int_equal(test_entries, NP2SRV_FILTER_CACHE_SIZE);
+    assert_int_equal(test_evictions, evictions + 1);
+
+    /* the recently used plan was kept */
+    plan = test_get("/mod:cont/leaf0");
+    assert_ptr_equal(plan, first);
+    np_filter_plan_release(plan);
+    np_filter_plan_release(first);
+
+    /* the evicted plan is compiled again but stays valid for its user */
+    plan = test_get("/mod:cont/leaf1");
+    assert_ptr_not_equal(plan, second);
+    assert_string_equal(plan->key, "x/mod:cont/leaf1");
+    np_filter_plan_release(plan);
+    assert_string_equal(second->key, "x/mod:cont/leaf1");
+    assert_string_equal(second->filter.filters[0].str, "/mod:cont/leaf1");
+    np_filter_plan_release(second);
+}
+
+static void
+test_content_id_flush(void **state)
+{
+    const struct np_filter_plan *plan, *plan2;
+
+    (void)state;
+
+    if (!NP2SRV_FILTER_CACHE_SIZE) {
+        skip();
+    }
+
+    plan = test_get("/mod:cont");
+    plan2 = test_get("/mod:cont");
+    assert_ptr_equal(plan, plan2);
+    np_filter_plan_release(plan2);
+
+    /* the context changed, all the plans are compiled again */
+    ++test_content_id;
+    plan2 = test_get("/mod:cont");
+    assert_ptr_not_equal(plan, plan2);
+    np_filter_cache_metrics(NULL);
+    assert_int_equal(test_entries, 1);
+
+    /* and cached for the new context */
+    np_filter_plan_release(plan);
+    plan = test_get("/mod:cont");
+    assert_ptr_equal(plan, plan2);
+
+    np_filter_plan_release(plan);
+    np_filter_plan_release(plan2);
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test_teardown(test_key, teardown),
+        cmocka_unit_test_teardown(test_lru, teardown),
+        cmocka_unit_test_teardown(test_content_id_flush, teardown),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,161 @@
+/**
+ * @file test_request_xpath.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief test parsing of request XPaths of operational callbacks
+ *
+ * @copyright
+ * Copyright 2021 CESNET, z.s.p.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "request_xpath.h"
+
+#define NCM_PATH "/ietf-netconf-monitoring:netconf-state"
+#define SESSION_PATH "/ietf-netconf-monitoring:netconf-state/sessions/session"
+
+static void
+test_child_name(void **state)
+{
+    const char *name;
+    size_t len;
+
+    (void)state;
+
+    name = np_xpath_child_name(NCM_PATH "/sessions", NCM_PATH, &len);
+    assert_non_null(name);
+    assert_int_equal(8, len);
+    assert_memory_equal("sessions", name, len);
+
+    /* prefixes are ignored and the child may be followed by more nodes */
+    name = np_xpath_child_name("/ietf-netconf-monitoring:netconf-state/ncm:statistics/in-rpcs", NCM_PATH, &len);
+    assert_non_null(name);
+    assert_int_equal(10, len);
+    assert_memory_equal("statistics", name, len);
+
+    /* simple predicates of the child subtree */
+    name = np_xpath_child_name(SESSION_PATH "[session-id='42']/in-rpcs", NCM_PATH, &len);
+    assert_non_null(name);
+    assert_memory_equal("sessions", name, len);
+
+    /* no child */
+    assert_null(np_xpath_child_name(NCM_PATH, NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NULL, NCM_PATH, &len));
+    assert_null(np_xpath_child_name("/ietf-netconf-monitoring:*", NCM_PATH, &len));
+
+    /* different path */
+    assert_null(np_xpath_child_name("/ietf-netconf-monitoring:other/sessions", NCM_PATH, &len));
+}
+
+static void
+test_child_name_complex(void **state)
+{
+    size_t len;
+
+    (void)state;
+
+    /* predicates referring to nodes outside the narrowed subtree */
+    assert_null(np_xpath_child_name(NCM_PATH "[statistics/in-rpcs>0]/sessions", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NCM_PATH "/sessions[../statistics/in-rpcs='1']", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(SESSION_PATH "[session-id=/other/path]", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(SESSION_PATH "[1]", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(SESSION_PATH "[session-id = '1']", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(SESSION_PATH "[in-rpcs>0]", NCM_PATH, &len));
+
+    /* parent and descendant steps, axes, unions, wildcards */
+    assert_null(np_xpath_child_name(SESSION_PATH "[session-id='42']/../session", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NCM_PATH "/sessions/../statistics", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NCM_PATH "//session", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NCM_PATH "/child::sessions", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NCM_PATH "/sessions | " NCM_PATH "/statistics", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NCM_PATH "/sessions/*", NCM_PATH, &len));
+    assert_null(np_xpath_child_name(NCM_PATH "/sessions/.", NCM_PATH, &len));
+}
+
+static void
+test_list_key_value(void **state)
+{
+    const char *value;
+    size_t len;
+
+    (void)state;
+
+    value = np_xpath_list_key_value(SESSION_PATH "[session-id='42']", SESSION_PATH, "session-id", &len);
+    assert_non_null(value);
+    assert_int_equal(2, len);
+    assert_memory_equal("42", value, len);
+
+    /* double quotes, prefixed key, more predicates, and following nodes */
+    value = np_xpath_list_key_value(SESSION_PATH "[ncm:username='a'][ncm:session-id=\"7\"]/in-rpcs", SESSION_PATH,
+            "session-id", &len);
+    assert_non_null(value);
+    assert_int_equal(1, len);
+    assert_memory_equal("7", value, len);
+
+    /* literal with special characters */
+    value = np_xpath_list_key_value("/ietf-subscribed-notifications:streams/stream[name=\"a]'|b\"]",
+            "/ietf-subscribed-notifications:streams/stream", "name", &len);
+    assert_non_null(value);
+    assert_int_equal(5, len);
+    assert_memory_equal("a]'|b", value, len);
+
+    /* no key */
+    assert_null(np_xpath_list_key_value(SESSION_PATH, SESSION_PATH, "session-id", &len));
+    assert_null(np_xpath_list_key_value(SESSION_PATH "[username='a']", SESSION_PATH, "session-id", &len));
+    assert_null(np_xpath_list_key_value(SESSION_PATH "/in-rpcs", SESSION_PATH, "session-id", &len));
+    assert_null(np_xpath_list_key_value(NCM_PATH "/sessions", SESSION_PATH, "session-id", &len));
+}
+
+static void
+test_list_key_value_complex(void **state)
+{
+    size_t len;
+
+    (void)state;
+
+    assert_null(np_xpath_list_key_value(SESSION_PATH "[session-id='42']/../session", SESSION_PATH, "session-id",
+            &len));
+    assert_null(np_xpath_list_key_value(SESSION_PATH "[session-id='42'] | " NCM_PATH, SESSION_PATH, "session-id",
+            &len));
+    assert_null(np_xpath_list_key_value(SESSION_PATH "[session-id=/other/path]", SESSION_PATH, "session-id", &len));
+    assert_null(np_xpath_list_key_value(SESSION_PATH "[session-id='42'][in-rpcs>0]", SESSION_PATH, "session-id",
+            &len));
+    assert_null(np_xpath_list_key_value(SESSION_PATH "[session-id='42]", SESSION_PATH, "session-id", &len));
+    assert_null(np_xpath_list_key_value(NCM_PATH "[statistics/in-rpcs>0]/sessions/session[session-id='42']",
+            SESSION_PATH, "session-id", &len));
+    assert_null(np_xpath_list_key_value(NCM_PATH "/sessions[x='1']/session[session-id='42']", SESSION_PATH,
+            "session-id", &len));
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_child_name),
+        cmocka_unit_test(test_child_name_complex),
+        cmocka_unit_test(test_list_key_value),
+        cmocka_unit_test(test_list_key_value_complex),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
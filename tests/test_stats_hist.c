@@ -0,0 +1,167 @@
+/**
+ * @file test_stats_hist.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief test the latency histograms of RPC statistics
+ *
+ * @copyright
+ * Copyright 2021 CESNET, z.s.p.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "stats_hist.h"
+
+static void
+test_bucket(void **state)
+{
+    (void)state;
+
+    /* linear */
+    assert_int_equal(np_stats_bucket(0), 0);
+    assert_int_equal(np_stats_bucket(1), 1);
+    assert_int_equal(np_stats_bucket(3), 3);
+    assert_int_equal(np_stats_bucket(4), 4);
+    assert_int_equal(np_stats_bucket(7), 7);
+
+    /* sub-buckets of a power of 2 */
+    assert_int_equal(np_stats_bucket(8), 8);
+    assert_int_equal(np_stats_bucket(9), 8);
+    assert_int_equal(np_stats_bucket(10), 9);
+    assert_int_equal(np_stats_bucket(15), 11);
+    assert_int_equal(np_stats_bucket(16), 12);
+    assert_int_equal(np_stats_bucket(1000), np_stats_bucket(1023));
+    assert_int_not_equal(np_stats_bucket(1023), np_stats_bucket(1024));
+
+    /* limits */
+    assert_int_equal(np_stats_bucket(UINT32_MAX), STATS_BUCKETS - 1);
+    assert_int_equal(np_stats_bucket(1U << 31), STATS_BUCKETS - STATS_SUB_COUNT);
+}
+
+static void
+test_bucket_low(void **state)
+{
+    uint32_t i, low, high;
+
+    (void)state;
+
+    assert_int_equal(np_stats_bucket_low(0), 0);
+    assert_int_equal(np_stats_bucket_low(8), 8);
+    assert_int_equal(np_stats_bucket_low(9), 10);
+    assert_int_equal(np_stats_bucket_low(STATS_BUCKETS - 1), 7U << 29);
+
+    for (i = 0; i < STATS_BUCKETS; ++i) {
+        /* the bounds belong to the bucket */
+        low = np_stats_bucket_low(i);
+        high = (i < STATS_BUCKETS - 1) ? np_stats_bucket_low(i + 1) - 1 : UINT32_MAX;
+        assert_true(low <= high);
+        assert_int_equal(np_stats_bucket(low), i);
+        assert_int_equal(np_stats_bucket(high), i);
+
+        /* the buckets are contiguous */
+        if (i) {
+            assert_int_equal(np_stats_bucket(low - 1), i - 1);
+        }
+
+        /* relative precision given by the sub-buckets */
+        if (low >= STATS_SUB_COUNT) {
+            assert_true((uint64_t)(high - low + 1) * STATS_SUB_COUNT <= low);
+        }
+    }
+}
+
+static void
+test_add(void **state)
+{
+    struct np_stats_hist hist = {0}, hist2 = {0};
+
+    (void)state;
+
+    np_stats_hist_add(&hist, 5);
+    np_stats_hist_add(&hist, 9);
+    np_stats_hist_add(&hist, 8);
+    assert_int_equal(hist.count, 3);
+    assert_int_equal(hist.sum, 22);
+    assert_int_equal(hist.max, 9);
+    assert_int_equal(hist.buckets[5], 1);
+    assert_int_equal(hist.buckets[8], 2);
+
+    /* merge */
+    np_stats_hist_add(&hist2, UINT32_MAX);
+    np_stats_hist_merge(&hist, &hist2);
+    assert_int_equal(hist.count, 4);
+    assert_int_equal(hist.sum, 22 + (uint64_t)UINT32_MAX);
+    assert_int_equal(hist.max, UINT32_MAX);
+    assert_int_equal(hist.buckets[8], 2);
+    assert_int_equal(hist.buckets[STATS_BUCKETS - 1], 1);
+
+    /* merging an empty histogram changes nothing */
+    memset(&hist2, 0, sizeof hist2);
+    np_stats_hist_merge(&hist, &hist2);
+    assert_int_equal(hist.count, 4);
+    assert_int_equal(hist.max, UINT32_MAX);
+}
+
+static void
+test_percentile(void **state)
+{
+    struct np_stats_hist hist = {0};
+    uint32_t i;
+
+    (void)state;
+
+    /* empty */
+    assert_int_equal(np_stats_hist_percentile(&hist, 50), 0);
+
+    for (i = 1; i <= 100; ++i) {
+        np_stats_hist_add(&hist, i);
+    }
+
+    /* highest value of the bucket with the percentile, 48 - 55 */
+    assert_int_equal(np_stats_hist_percentile(&hist, 50), 55);
+
+    /* 80 - 95 */
+    assert_int_equal(np_stats_hist_percentile(&hist, 90), 95);
+
+    /* 96 - 111, limited by the maximum */
+    assert_int_equal(np_stats_hist_percentile(&hist, 99), 100);
+    assert_int_equal(np_stats_hist_percentile(&hist, 100), 100);
+
+    /* the last bucket */
+    memset(&hist, 0, sizeof hist);
+    np_stats_hist_add(&hist, UINT32_MAX - 1);
+    assert_int_equal(np_stats_hist_percentile(&hist, 50), UINT32_MAX - 1);
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_bucket),
+        cmocka_unit_test(test_bucket_low),
+        cmocka_unit_test(test_add),
+        cmocka_unit_test(test_percentile),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,215 @@
+/**
+ * @file test_strbuf.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief test the growable string buffer
+ *
+ * @copyright
+ * Copyright 2021 CESNET, z.s.p.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cmocka.h>
+
+#include "log.h"
+#include "strbuf.h"
+
+/*
+ * server functions the string buffer uses
+ */
+
+void
+np2log_printf(NC_VERB_LEVEL level, const char *format, ...)
+{
+    (void)level;
+    (void)format;
+}
+
+static void
+test_empty(void **state)
+{
+    struct np_strbuf sbuf = {0};
+
+    (void)state;
+
+    /* nothing allocated until needed */
+    np_strbuf_truncate(&sbuf, 0);
+    assert_null(sbuf.buf);
+    assert_int_equal(sbuf.len, 0);
+
+    /* empty strings still allocate a terminated buffer */
+    assert_int_equal(np_strbuf_append(&sbuf, ""), 0);
+    assert_non_null(sbuf.buf);
+    assert_string_equal(sbuf.buf, "");
+    assert_int_equal(sbuf.len, 0);
+    assert_int_equal(sbuf.size, 64);
+
+    assert_int_equal(np_strbuf_printf(&sbuf, "%s", ""), 0);
+    assert_string_equal(sbuf.buf, "");
+    assert_int_equal(sbuf.len, 0);
+    free(sbuf.buf);
+
+    /* printf into no buffer */
+    memset(&sbuf, 0, sizeof sbuf);
+    assert_int_equal(np_strbuf_printf(&sbuf, "%d", 42), 0);
+    assert_string_equal(sbuf.buf, "42");
+    assert_int_equal(sbuf.len, 2);
+    free(sbuf.buf);
+}
+
+static void
+test_reserve(void **state)
+{
+    struct np_strbuf sbuf = {0};
+
+    (void)state;
+
+    /* the terminating zero always fits */
+    assert_int_equal(np_strbuf_reserve(&sbuf, 63), 0);
+    assert_int_equal(sbuf.size, 64);
+    assert_int_equal(np_strbuf_reserve(&sbuf, 64), 0);
+    assert_int_equal(sbuf.size, 128);
+
+    /* enough space, not enlarged */
+    assert_int_equal(np_strbuf_reserve(&sbuf, 100), 0);
+    assert_int_equal(sbuf.size, 128);
+
+    /* doubled as many times as needed */
+    assert_int_equal(np_strbuf_reserve(&sbuf, 1000), 0);
+    assert_int_equal(sbuf.size, 1024);
+    assert_int_equal(sbuf.len, 0);
+    free(sbuf.buf);
+}
+
+static void
+test_growth(void **state)
+{
+    struct np_strbuf sbuf = {0};
+    char str[64], expected[1001];
+    uint32_t i;
+
+    (void)state;
+
+    memset(str, 'a', 63);
+    str[63] = '\0';
+
+    /* exactly filling the buffer except for the terminating zero */
+    assert_int_equal(np_strbuf_append(&sbuf, str), 0);
+    assert_int_equal(sbuf.len, 63);
+    assert_int_equal(sbuf.size, 64);
+
+    /* one more character */
+    assert_int_equal(np_strbuf_append(&sbuf, "b"), 0);
+    assert_int_equal(sbuf.len, 64);
+    assert_int_equal(sbuf.size, 128);
+    assert_int_equal(strlen(sbuf.buf), 64);
+    assert_int_equal(sbuf.buf[62], 'a');
+    assert_int_equal(sbuf.buf[63], 'b');
+    assert_int_equal(sbuf.buf[64], '\0');
+    free(sbuf.buf);
+
+    /* many small appends */
+    memset(&sbuf, 0, sizeof sbuf);
+    for (i = 0; i < 1000; ++i) {
+        assert_int_equal(np_strbuf_printf(&sbuf, "%c", 'a' + (i % 26)), 0);
+        expected[i] = 'a' + (i % 26);
+    }
+    expected[1000] = '\0';
+    assert_int_equal(sbuf.len, 1000);
+    assert_int_equal(sbuf.size, 1024);
+    assert_string_equal(sbuf.buf, expected);
+    free(sbuf.buf);
+}
+
+static void
+test_printf(void **state)
+{
+    struct np_strbuf sbuf = {0};
+    char str[201];
+
+    (void)state;
+
+    memset(str, 'x', 200);
+    str[200] = '\0';
+
+    assert_int_equal(np_strbuf_printf(&sbuf, "/%s:%s", "mod", "cont"), 0);
+    assert_string_equal(sbuf.buf, "/mod:cont");
+
+    /* does not fit, printed again into the enlarged buffer */
+    assert_int_equal(np_strbuf_printf(&sbuf, "[%s='%s']", "key", str), 0);
+    assert_int_equal(sbuf.len, 9 + 8 + 200);
+    assert_int_equal(sbuf.size, 256);
+    assert_int_equal(strncmp(sbuf.buf, "/mod:cont[key='xxx", 18), 0);
+    assert_string_equal(sbuf.buf + sbuf.len - 3, "x']");
+
+    /* exactly fits */
+    memset(str, 'y', 256 - 1 - sbuf.len);
+    str[256 - 1 - sbuf.len] = '\0';
+    assert_int_equal(np_strbuf_printf(&sbuf, "%s", str), 0);
+    assert_int_equal(sbuf.len, 255);
+    assert_int_equal(sbuf.size, 256);
+    assert_int_equal(sbuf.buf[255], '\0');
+    free(sbuf.buf);
+}
+
+static void
+test_truncate(void **state)
+{
+    struct np_strbuf sbuf = {0};
+    size_t len;
+
+    (void)state;
+
+    assert_int_equal(np_strbuf_append(&sbuf, "/mod:cont"), 0);
+    len = sbuf.len;
+    assert_int_equal(np_strbuf_append(&sbuf, "/list[key='1']"), 0);
+
+    /* back to a previous length, the buffer is kept */
+    np_strbuf_truncate(&sbuf, len);
+    assert_string_equal(sbuf.buf, "/mod:cont");
+    assert_int_equal(sbuf.len, len);
+    assert_int_equal(sbuf.size, 64);
+
+    /* appending after truncation */
+    assert_int_equal(np_strbuf_append(&sbuf, "/leaf"), 0);
+    assert_string_equal(sbuf.buf, "/mod:cont/leaf");
+
+    /* to nothing */
+    np_strbuf_truncate(&sbuf, 0);
+    assert_string_equal(sbuf.buf, "");
+    assert_int_equal(sbuf.len, 0);
+    free(sbuf.buf);
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_empty),
+        cmocka_unit_test(test_reserve),
+        cmocka_unit_test(test_growth),
+        cmocka_unit_test(test_printf),
+        cmocka_unit_test(test_truncate),
+    };
+
+    return cmocka_run_group_tests(tests, NULL, NULL);
+}
@@ -0,0 +1,357 @@
+/**
+ * @file test_timer_wheel.c
+ * @author Michal Vasko <mvasko@cesnet.cz>
+ * @brief test the central timer wheel
+ *
+ * @copyright
+ * Copyright 2021 CESNET, z.s.p.o.
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <setjmp.h>
+#include <stdarg.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <cmocka.h>
+
+#include "common.h"
+#include "log.h"
+#include "metrics.h"
+#include "timer_wheel.h"
+
+/* maximum time to wait for an expiration */
+#define TEST_WAIT_MS 2000
+
+struct test_cb_data {
+    pthread_mutex_t lock;
+    uint32_t count;
+    uint32_t sleep_ms;
+    int started;
+    int done;
+};
+
+/*
+ * server functions the timer wheel uses
+ */
+
+struct timespec
+np_gettimespec(void)
+{
+    struct timespec ts;
+
+    clock_gettime(NP_CLOCK_ID, &ts);
+    return ts;
+}
+
+void
+np_addtimespec(struct timespec *ts, uint32_t msec)
+{
+    ts->tv_sec += msec / 1000;
+    ts->tv_nsec += (msec % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ++ts->tv_sec;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+void
+np2log_printf(NC_VERB_LEVEL level, const char *format, ...)
+{
+    (void)level;
+    (void)format;
+}
+
+void
+np_metrics_counter(struct np_metrics *m, const char *name, const char *help, uint64_t value)
+{
+    (void)m;
+    (void)name;
+    (void)help;
+    (void)value;
+}
+
+void
+np_metrics_gauge(struct np_metrics *m, const char *name, const char *help, uint64_t value)
+{
+    (void)m;
+    (void)name;
+    (void)help;
+    (void)value;
+}
+
+/*
+ * helpers
+ */
+
+static void
+test_sleep(uint32_t msec)
+{
+    struct timespec ts = {.tv_sec = msec / 1000, .tv_nsec = (msec % 1000) * 1000000L};
+
+    nanosleep(&ts, NULL);
+}
+
+static int64_t
+test_diff_ms(const struct timespec *ts1, const struct timespec *ts2)
+{
+    return ((int64_t)ts2->tv_sec - ts1->tv_sec) * 1000 + ((int64_t)ts2->tv_nsec - ts1->tv_nsec) / 1000000;
+}
+
+static struct timespec
+test_ts_in(int32_t msec)
+{
+    struct timespec ts = np_gettimespec();
+
+    if (msec >= 0) {
+        np_addtimespec(&ts, msec);
+    } else {
+        ts.tv_sec -= (-msec) / 1000 + 1;
+        np_addtimespec(&ts, 1000 - (-msec) % 1000);
+    }
+    return ts;
+}
+
+static void
+test_cb(void *arg)
+{
+    struct test_cb_data *data = arg;
+    uint32_t sleep_ms;
+
+    pthread_mutex_lock(&data->lock);
+    ++data->count;
+    data->started = 1;
+    sleep_ms = data->sleep_ms;
+    pthread_mutex_unlock(&data->lock);
+
+    if (sleep_ms) {
+        test_sleep(sleep_ms);
+    }
+
+    pthread_mutex_lock(&data->lock);
+    data->done = 1;
+    pthread_mutex_unlock(&data->lock);
+}
+
+static uint32_t
+test_count(struct test_cb_data *data)
+{
+    uint32_t count;
+
+    pthread_mutex_lock(&data->lock);
+    count = data->count;
+    pthread_mutex_unlock(&data->lock);
+
+    return count;
+}
+
+static int
+test_wait_count(struct test_cb_data *data, uint32_t count)
+{
+    uint32_t i;
+
+    for (i = 0; i < TEST_WAIT_MS / 5; ++i) {
+        if (test_count(data) >= count) {
+            return 0;
+        }
+        test_sleep(5);
+    }
+
+    return 1;
+}
+
+/*
+ * tests
+ */
+
+static int
+setup(void **state)
+{
+    (void)state;
+
+    return np2srv_timer_wheel_init();
+}
+
+static int
+teardown(void **state)
+{
+    (void)state;
+
+    np2srv_timer_wheel_destroy();
+    return 0;
+}
+
+static void
+test_arm(void **state)
+{
+    struct test_cb_data data = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    struct np_timer tmr;
+
+    (void)state;
+
+    np_timer_init(&tmr, test_cb, &data);
+    assert_false(np_timer_is_pending(&tmr));
+
+    /* one-shot */
+    np_timer_set(&tmr, test_ts_in(20), 0);
+    assert_true(np_timer_is_pending(&tmr));
+    assert_int_equal(test_wait_count(&data, 1), 0);
+
+    /* not called again */
+    test_sleep(100);
+    assert_int_equal(test_count(&data), 1);
+    assert_false(np_timer_is_pending(&tmr));
+}
+
+static void
+test_disarm(void **state)
+{
+    struct test_cb_data data = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    struct np_timer tmr;
+
+    (void)state;
+
+    np_timer_init(&tmr, test_cb, &data);
+
+    np_timer_set(&tmr, test_ts_in(50), 0);
+    np_timer_disarm(&tmr);
+    assert_false(np_timer_is_pending(&tmr));
+
+    test_sleep(150);
+    assert_int_equal(test_count(&data), 0);
+
+    /* periodic */
+    np_timer_set(&tmr, test_ts_in(10), 20);
+    assert_int_equal(test_wait_count(&data, 3), 0);
+    np_timer_disarm_sync(&tmr);
+    assert_false(np_timer_is_pending(&tmr));
+
+    data.count = 0;
+    test_sleep(100);
+    assert_int_equal(test_count(&data), 0);
+}
+
+static void
+test_rearm(void **state)
+{
+    struct test_cb_data data = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    struct np_timer tmr;
+    struct timespec start;
+
+    (void)state;
+
+    np_timer_init(&tmr, test_cb, &data);
+
+    /* re-arming moves the expiration sooner */
+    start = np_gettimespec();
+    np_timer_set(&tmr, test_ts_in(10000), 0);
+    np_timer_set(&tmr, test_ts_in(20), 0);
+    assert_int_equal(test_wait_count(&data, 1), 0);
+    assert_true(test_diff_ms(&start, &tmr.expire) < 10000);
+
+    /* and later */
+    np_timer_set(&tmr, test_ts_in(20), 0);
+    np_timer_set(&tmr, test_ts_in(300), 0);
+    test_sleep(150);
+    assert_int_equal(test_count(&data), 1);
+    assert_int_equal(test_wait_count(&data, 2), 0);
+
+    np_timer_disarm_sync(&tmr);
+    assert_int_equal(test_count(&data), 2);
+}
+
+static void
+test_missed_periods(void **state)
+{
+    struct test_cb_data data = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    struct np_timer tmr;
+    struct timespec first, now;
+    int64_t diff;
+
+    (void)state;
+
+    np_timer_init(&tmr, test_cb, &data);
+
+    /* the first expiration is long in the past, it expires once right away */
+    first = test_ts_in(-1050);
+    np_timer_set(&tmr, first, 100);
+    assert_int_equal(test_wait_count(&data, 1), 0);
+    np_timer_disarm_sync(&tmr);
+    now = np_gettimespec();
+    assert_int_equal(test_count(&data), 1);
+
+    /* the next expiration is aligned to the period and none of the missed ones are left */
+    diff = test_diff_ms(&first, &tmr.expire);
+    assert_int_equal(diff % 100, 0);
+    assert_true(diff >= 1100);
+    assert_true(test_diff_ms(&now, &tmr.expire) <= 100);
+
+    /* period in the future is not skipped */
+    data.count = 0;
+    first = test_ts_in(30);
+    np_timer_set(&tmr, first, 100);
+    assert_int_equal(test_wait_count(&data, 1), 0);
+    np_timer_disarm_sync(&tmr);
+    assert_int_equal(test_diff_ms(&first, &tmr.expire), 100);
+}
+
+static void
+test_disarm_sync(void **state)
+{
+    struct test_cb_data data = {.lock = PTHREAD_MUTEX_INITIALIZER};
+    struct np_timer tmr;
+    uint32_t i;
+
+    (void)state;
+
+    np_timer_init(&tmr, test_cb, &data);
+    data.sleep_ms = 200;
+
+    /* wait for the callback to start */
+    np_timer_set(&tmr, test_ts_in(0), 0);
+    for (i = 0; i < TEST_WAIT_MS / 5; ++i) {
+        pthread_mutex_lock(&data.lock);
+        if (data.started) {
+            pthread_mutex_unlock(&data.lock);
+            break;
+        }
+        pthread_mutex_unlock(&data.lock);
+        test_sleep(5);
+    }
+    assert_int_not_equal(i, TEST_WAIT_MS / 5);
+
+    /* the running callback must have finished once disarmed */
+    np_timer_disarm_sync(&tmr);
+    assert_true(data.done);
+}
+
+int
+main(void)
+{
+    const struct CMUnitTest tests[] = {
+        cmocka_unit_test(test_arm),
+        cmocka_unit_test(test_disarm),
+        cmocka_unit_test(test_rearm),
+        cmocka_unit_test(test_missed_periods),
+        cmocka_unit_test(test_disarm_sync),
+    };
+
+    return cmocka_run_group_tests(tests, setup, teardown);
+}